@@ -0,0 +1,194 @@
+; --------------------------------------------------------------------------
+; basic.s: Inner loop of a tokenised interpreter in the style of EhBASIC
+; 17.10.2026 github.com/SMDHuman
+; --------------------------------------------------------------------------
+; Runs the token program of
+;   10 S=0:I=0
+;   20 S=S+I:I=I+1
+;   30 IF I<1000 GOTO 20
+; from RAM. As in EhBASIC the tokens are read by a CHRGET routine copied to
+; zero page that increments the operand of its own LDA, and handlers are
+; dispatched through a table of addresses pushed for an RTS.
+  .include "harness.s"
+
+PROGRAM = $0300    ; Token program in RAM
+txtptr  = $C7      ; Operand of the LDA in chrget
+chrget  = $C0
+slo     = $80      ; Expression stack, X is its next free entry
+shi     = $A0
+STACK   = $1F
+vlo     = $60      ; Variables
+vhi     = $70
+target  = $50
+VAR_S   = 0
+VAR_I   = 1
+SUM     = 40748    ; 0 + 1 + ... + 999, modulo 65536
+
+; Tokens
+T_END   = 0
+T_LIT   = 1        ; 16 bit value follows
+T_LOAD  = 2        ; Variable number follows
+T_STORE = 3        ; Variable number follows
+T_ADD   = 4
+T_SUB   = 5
+T_LT    = 6
+T_JNZ   = 7        ; Token address - 1 follows
+
+bench:
+  ldx #chrget_end-chrget_rom-1
+copy_chrget:
+  lda chrget_rom,x
+  sta chrget,x
+  dex
+  bpl copy_chrget
+  ldx #program_end-program-1
+copy_program:
+  lda program,x
+  sta PROGRAM,x
+  dex
+  bpl copy_program
+  lda #<(PROGRAM-1)
+  sta txtptr
+  lda #>(PROGRAM-1)
+  sta txtptr+1
+  ldx #STACK
+  jsr exec
+  cpx #STACK       ; Balanced expression stack
+  bne wrong
+  lda vlo+VAR_S
+  cmp #<SUM
+  bne wrong
+  lda vhi+VAR_S
+  cmp #>SUM
+  bne wrong
+  lda vlo+VAR_I
+  cmp #<1000
+  bne wrong
+  lda vhi+VAR_I
+  cmp #>1000
+  bne wrong
+  rts
+wrong:
+  jmp fail
+
+; Fetch the next token and run its handler, T_END returns to the caller
+exec:
+  jsr chrget
+  asl a
+  tay
+  lda handlers+1,y
+  pha
+  lda handlers,y
+  pha
+  rts
+
+handlers:
+  .word t_end-1, t_lit-1, t_load-1, t_store-1
+  .word t_add-1, t_sub-1, t_lt-1, t_jnz-1
+
+t_end:
+  rts
+
+t_lit:
+  jsr chrget
+  sta slo,x
+  jsr chrget
+  sta shi,x
+  dex
+  jmp exec
+
+t_load:
+  jsr chrget
+  tay
+  lda vlo,y
+  sta slo,x
+  lda vhi,y
+  sta shi,x
+  dex
+  jmp exec
+
+t_store:
+  jsr chrget
+  tay
+  inx
+  lda slo,x
+  sta vlo,y
+  lda shi,x
+  sta vhi,y
+  jmp exec
+
+t_add:
+  inx
+  clc
+  lda slo+1,x
+  adc slo,x
+  sta slo+1,x
+  lda shi+1,x
+  adc shi,x
+  sta shi+1,x
+  jmp exec
+
+t_sub:
+  inx
+  sec
+  lda slo+1,x
+  sbc slo,x
+  sta slo+1,x
+  lda shi+1,x
+  sbc shi,x
+  sta shi+1,x
+  jmp exec
+
+t_lt:
+  inx              ; 1 if below, else 0, unsigned
+  lda slo+1,x
+  cmp slo,x
+  lda shi+1,x
+  sbc shi,x
+  lda #0
+  sta shi+1,x
+  rol a
+  eor #1
+  sta slo+1,x
+  jmp exec
+
+t_jnz:
+  jsr chrget
+  sta target
+  jsr chrget
+  inx
+  ldy slo,x
+  bne t_jnz_taken
+  ldy shi,x
+  bne t_jnz_taken
+  jmp exec
+t_jnz_taken:
+  sta txtptr+1
+  lda target
+  sta txtptr
+  jmp exec
+
+; Copied to chrget, the LDA operand is txtptr
+chrget_rom:
+  .byte $E6, txtptr    ; inc txtptr
+  .byte $D0, $02       ; bne chrgot
+  .byte $E6, txtptr+1  ; inc txtptr+1
+  .byte $AD, $FF, $FF  ; chrgot: lda $FFFF
+  .byte $60            ; rts
+chrget_end:
+
+; Copied to PROGRAM
+program:
+  .byte T_LIT, 0, 0, T_STORE, VAR_S    ; 10 S=0:I=0
+  .byte T_LIT, 0, 0, T_STORE, VAR_I
+line_20:
+  .byte T_LOAD, VAR_S, T_LOAD, VAR_I   ; 20 S=S+I:I=I+1
+  .byte T_ADD, T_STORE, VAR_S
+  .byte T_LOAD, VAR_I, T_LIT, 1, 0
+  .byte T_ADD, T_STORE, VAR_I
+  .byte T_LOAD, VAR_I, T_LIT           ; 30 IF I<1000 GOTO 20
+  .byte <1000, >1000
+  .byte T_LT, T_JNZ
+  .word PROGRAM+line_20-program-1
+  .byte T_END
+program_end:
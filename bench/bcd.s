@@ -0,0 +1,88 @@
+; --------------------------------------------------------------------------
+; bcd.s: Decimal mode sums over 0 to 9999
+; 17.10.2026 github.com/SMDHuman
+; --------------------------------------------------------------------------
+; Adds 0 + 1 + ... + 9999 in 8 digit BCD with ADC, then subtracts the same
+; numbers again with SBC, counting i up and down in decimal too.
+  .include "harness.s"
+
+i   = $10          ; 4 digits, little endian
+sum = $12          ; 8 digits, little endian
+
+bench:
+  sed
+  lda #0
+  sta i
+  sta i+1
+  sta sum
+  sta sum+1
+  sta sum+2
+  sta sum+3
+add:
+  clc              ; sum += i
+  lda sum
+  adc i
+  sta sum
+  lda sum+1
+  adc i+1
+  sta sum+1
+  lda sum+2
+  adc #0
+  sta sum+2
+  lda sum+3
+  adc #0
+  sta sum+3
+  clc              ; i += 1, until it wraps to 0000
+  lda i
+  adc #1
+  sta i
+  lda i+1
+  adc #0
+  sta i+1
+  bcc add
+  lda sum          ; 49995000
+  bne wrong
+  lda sum+1
+  cmp #$50
+  bne wrong
+  lda sum+2
+  cmp #$99
+  bne wrong
+  lda sum+3
+  cmp #$49
+  bne wrong
+  lda #$99         ; i = 9999
+  sta i
+  sta i+1
+sub:
+  sec              ; sum -= i
+  lda sum
+  sbc i
+  sta sum
+  lda sum+1
+  sbc i+1
+  sta sum+1
+  lda sum+2
+  sbc #0
+  sta sum+2
+  lda sum+3
+  sbc #0
+  sta sum+3
+  sec              ; i -= 1, until it wraps below 0000
+  lda i
+  sbc #1
+  sta i
+  lda i+1
+  sbc #0
+  sta i+1
+  bcs sub
+  cld
+  lda sum
+  ora sum+1
+  ora sum+2
+  ora sum+3
+  bne wrong
+  rts
+wrong:
+  cld
+  jmp fail
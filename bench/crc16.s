@@ -0,0 +1,48 @@
+; --------------------------------------------------------------------------
+; crc16.s: Bitwise CRC-16/CCITT-FALSE of 1 KiB
+; 17.10.2026 github.com/SMDHuman
+; --------------------------------------------------------------------------
+; Shift and rotate chains on zero page with a data dependent branch per bit.
+  .include "harness.s"
+  .include "crcdata.s"
+
+CRC16 = $CC8D      ; Of the test data, poly $1021, init $FFFF
+crc   = $14
+
+bench:
+  jsr fill_data
+  lda #$FF
+  sta crc
+  sta crc+1
+crc_byte:
+  lda (ptr),y      ; crc ^= byte << 8
+  eor crc+1
+  sta crc+1
+  ldx #8
+crc_bit:
+  asl crc
+  rol crc+1
+  bcc crc_next
+  lda crc+1        ; crc ^= $1021 when the top bit was set
+  eor #$10
+  sta crc+1
+  lda crc
+  eor #$21
+  sta crc
+crc_next:
+  dex
+  bne crc_bit
+  iny
+  bne crc_byte
+  inc ptr+1
+  dec pages
+  bne crc_byte
+  lda crc
+  cmp #<CRC16
+  bne wrong
+  lda crc+1
+  cmp #>CRC16
+  bne wrong
+  rts
+wrong:
+  jmp fail
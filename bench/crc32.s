@@ -0,0 +1,60 @@
+; --------------------------------------------------------------------------
+; crc32.s: Bitwise CRC-32 of 1 KiB, as zlib computes it
+; 17.10.2026 github.com/SMDHuman
+; --------------------------------------------------------------------------
+; Like crc16.s but 32 bits wide, shifting right through four bytes.
+  .include "harness.s"
+  .include "crcdata.s"
+
+crc = $14          ; Little endian
+
+bench:
+  jsr fill_data
+  lda #$FF
+  sta crc
+  sta crc+1
+  sta crc+2
+  sta crc+3
+crc_byte:
+  lda (ptr),y      ; crc ^= byte
+  eor crc
+  sta crc
+  ldx #8
+crc_bit:
+  lsr crc+3
+  ror crc+2
+  ror crc+1
+  ror crc
+  bcc crc_next
+  lda crc+3        ; crc ^= $EDB88320 when the low bit was set
+  eor #$ED
+  sta crc+3
+  lda crc+2
+  eor #$B8
+  sta crc+2
+  lda crc+1
+  eor #$83
+  sta crc+1
+  lda crc
+  eor #$20
+  sta crc
+crc_next:
+  dex
+  bne crc_bit
+  iny
+  bne crc_byte
+  inc ptr+1
+  dec pages
+  bne crc_byte
+  ldx #3           ; Compare with the expected crc, still inverted
+check:
+  lda crc,x
+  cmp expected,x
+  bne wrong
+  dex
+  bpl check
+  rts
+wrong:
+  jmp fail
+expected:          ; ~$5D3DE8ED, the CRC-32 of the test data
+  .byte $12, $17, $C2, $A2
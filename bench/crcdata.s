@@ -0,0 +1,32 @@
+; --------------------------------------------------------------------------
+; crcdata.s: Test data of the CRC benchmarks
+; 17.10.2026 github.com/SMDHuman
+; --------------------------------------------------------------------------
+; fill_data writes DATA_PAGES pages of (i * 7 + 3) & $FF at DATA.
+DATA       = $2000
+DATA_PAGES = 4
+ptr        = $10
+pages      = $12
+
+fill_data:
+  lda #<DATA
+  sta ptr
+  lda #>DATA
+  sta ptr+1
+  ldx #DATA_PAGES
+  ldy #0
+  lda #3
+fill_byte:
+  sta (ptr),y
+  clc
+  adc #7
+  iny
+  bne fill_byte
+  inc ptr+1
+  dex
+  bne fill_byte
+  lda #>DATA       ; ptr back at the start for the CRC loop
+  sta ptr+1
+  lda #DATA_PAGES
+  sta pages
+  rts
@@ -0,0 +1,1560 @@
+; --------------------------------------------------------------------------
+; functional.s: Self checking test of the 6502 instructions
+; 17.10.2026 github.com/SMDHuman
+; --------------------------------------------------------------------------
+; In the manner of Klaus Dormann's functional test: every check branches to
+; itself when it fails, so a failed run stops in a trap right at the check
+; that went wrong. Covers the arithmetic and its flags, logic, shifts,
+; compares, BIT, every addressing mode, the stack, jumps, branches and
+; decimal mode of the NMOS 6502, JMP ($xxFF) page wrap included.
+  .include "harness.s"
+
+zp   = $30         ; Scratch operands
+ptr  = $40         ; Pointers for the indirect modes
+DATA = $0200       ; Scratch operands in absolute memory
+REPEAT = 64        ; Passes through the test per run
+reps = $3F
+
+bench:
+  lda #REPEAT
+  sta reps
+bench_pass:
+  jsr test
+  dec reps
+  bne bench_pass
+  rts
+
+test:
+  cld
+  cli
+
+; ADC, binary
+  ; $00 + $00 + 0 = $00
+  clc
+  lda #$00
+  adc #$00
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$C3
+  cmp #$02
+  bne *
+  ; $01 + $01 + 1 = $03
+  sec
+  lda #$01
+  adc #$01
+  php
+  cmp #$03
+  bne *
+  pla
+  and #$C3
+  cmp #$00
+  bne *
+  ; $7F + $01 + 0 = $80
+  clc
+  lda #$7F
+  adc #$01
+  php
+  cmp #$80
+  bne *
+  pla
+  and #$C3
+  cmp #$C0
+  bne *
+  ; $80 + $80 + 0 = $00
+  clc
+  lda #$80
+  adc #$80
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$C3
+  cmp #$43
+  bne *
+  ; $FF + $01 + 0 = $00
+  clc
+  lda #$FF
+  adc #$01
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$C3
+  cmp #$03
+  bne *
+  ; $FF + $FF + 1 = $FF
+  sec
+  lda #$FF
+  adc #$FF
+  php
+  cmp #$FF
+  bne *
+  pla
+  and #$C3
+  cmp #$81
+  bne *
+  ; $50 + $50 + 0 = $A0
+  clc
+  lda #$50
+  adc #$50
+  php
+  cmp #$A0
+  bne *
+  pla
+  and #$C3
+  cmp #$C0
+  bne *
+  ; $D0 + $90 + 1 = $61
+  sec
+  lda #$D0
+  adc #$90
+  php
+  cmp #$61
+  bne *
+  pla
+  and #$C3
+  cmp #$41
+  bne *
+  ; $3F + $40 + 1 = $80
+  sec
+  lda #$3F
+  adc #$40
+  php
+  cmp #$80
+  bne *
+  pla
+  and #$C3
+  cmp #$C0
+  bne *
+  ; $01 + $FE + 1 = $00
+  sec
+  lda #$01
+  adc #$FE
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$C3
+  cmp #$03
+  bne *
+
+; ADC with the operand in memory
+  lda #$7F
+  sta zp
+  sta DATA
+  lda #$01
+  clc
+  adc zp
+  php
+  cmp #$80
+  bne *
+  pla
+  and #$C3
+  cmp #$C0
+  bne *
+  clc
+  lda #$01
+  adc DATA
+  php
+  cmp #$80
+  bne *
+  pla
+  and #$C3
+  cmp #$C0
+  bne *
+
+; SBC, binary
+  ; $00 - $00 - 0 = $00
+  sec
+  lda #$00
+  sbc #$00
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$C3
+  cmp #$03
+  bne *
+  ; $00 - $01 - 0 = $FF
+  sec
+  lda #$00
+  sbc #$01
+  php
+  cmp #$FF
+  bne *
+  pla
+  and #$C3
+  cmp #$80
+  bne *
+  ; $80 - $01 - 0 = $7F
+  sec
+  lda #$80
+  sbc #$01
+  php
+  cmp #$7F
+  bne *
+  pla
+  and #$C3
+  cmp #$41
+  bne *
+  ; $7F - $FF - 0 = $80
+  sec
+  lda #$7F
+  sbc #$FF
+  php
+  cmp #$80
+  bne *
+  pla
+  and #$C3
+  cmp #$C0
+  bne *
+  ; $50 - $B0 - 0 = $A0
+  sec
+  lda #$50
+  sbc #$B0
+  php
+  cmp #$A0
+  bne *
+  pla
+  and #$C3
+  cmp #$C0
+  bne *
+  ; $50 - $30 - 1 = $1F
+  clc
+  lda #$50
+  sbc #$30
+  php
+  cmp #$1F
+  bne *
+  pla
+  and #$C3
+  cmp #$01
+  bne *
+  ; $FF - $FF - 1 = $FF
+  clc
+  lda #$FF
+  sbc #$FF
+  php
+  cmp #$FF
+  bne *
+  pla
+  and #$C3
+  cmp #$80
+  bne *
+  ; $01 - $01 - 0 = $00
+  sec
+  lda #$01
+  sbc #$01
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$C3
+  cmp #$03
+  bne *
+  ; $C0 - $40 - 0 = $80
+  sec
+  lda #$C0
+  sbc #$40
+  php
+  cmp #$80
+  bne *
+  pla
+  and #$C3
+  cmp #$81
+  bne *
+
+; AND, ORA, EOR
+  lda #$F0
+  and #$0F
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+  lda #$AA
+  and #$FF
+  php
+  cmp #$AA
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  lda #$81
+  and #$81
+  php
+  cmp #$81
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  lda #$00
+  and #$00
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+  lda #$F0
+  ora #$0F
+  php
+  cmp #$FF
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  lda #$AA
+  ora #$FF
+  php
+  cmp #$FF
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  lda #$81
+  ora #$81
+  php
+  cmp #$81
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  lda #$00
+  ora #$00
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+  lda #$F0
+  eor #$0F
+  php
+  cmp #$FF
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  lda #$AA
+  eor #$FF
+  php
+  cmp #$55
+  bne *
+  pla
+  and #$82
+  cmp #$00
+  bne *
+  lda #$81
+  eor #$81
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+  lda #$00
+  eor #$00
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+
+; Shifts and rotates of A
+  clc
+  lda #$81
+  asl a
+  php
+  cmp #$02
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  sec
+  lda #$81
+  asl a
+  php
+  cmp #$02
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  sec
+  lda #$40
+  asl a
+  php
+  cmp #$80
+  bne *
+  pla
+  and #$83
+  cmp #$80
+  bne *
+  clc
+  lda #$01
+  asl a
+  php
+  cmp #$02
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  clc
+  lda #$00
+  asl a
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$83
+  cmp #$02
+  bne *
+  clc
+  lda #$81
+  lsr a
+  php
+  cmp #$40
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  sec
+  lda #$81
+  lsr a
+  php
+  cmp #$40
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  sec
+  lda #$40
+  lsr a
+  php
+  cmp #$20
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  clc
+  lda #$01
+  lsr a
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$83
+  cmp #$03
+  bne *
+  clc
+  lda #$00
+  lsr a
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$83
+  cmp #$02
+  bne *
+  clc
+  lda #$81
+  rol a
+  php
+  cmp #$02
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  sec
+  lda #$81
+  rol a
+  php
+  cmp #$03
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  sec
+  lda #$40
+  rol a
+  php
+  cmp #$81
+  bne *
+  pla
+  and #$83
+  cmp #$80
+  bne *
+  clc
+  lda #$01
+  rol a
+  php
+  cmp #$02
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  clc
+  lda #$00
+  rol a
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$83
+  cmp #$02
+  bne *
+  clc
+  lda #$81
+  ror a
+  php
+  cmp #$40
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  sec
+  lda #$81
+  ror a
+  php
+  cmp #$C0
+  bne *
+  pla
+  and #$83
+  cmp #$81
+  bne *
+  sec
+  lda #$40
+  ror a
+  php
+  cmp #$A0
+  bne *
+  pla
+  and #$83
+  cmp #$80
+  bne *
+  clc
+  lda #$01
+  ror a
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$83
+  cmp #$03
+  bne *
+  clc
+  lda #$00
+  ror a
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$83
+  cmp #$02
+  bne *
+
+; Shifts and rotates in memory, zero page and absolute,X
+  lda #$81
+  sta zp
+  sec
+  asl zp
+  php
+  lda zp
+  cmp #$02
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  ldx #3
+  lda #$81
+  sta DATA,x
+  sec
+  asl DATA,x
+  php
+  lda DATA+3
+  cmp #$02
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  lda #$02
+  sta zp
+  clc
+  asl zp
+  php
+  lda zp
+  cmp #$04
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  ldx #3
+  lda #$02
+  sta DATA,x
+  clc
+  asl DATA,x
+  php
+  lda DATA+3
+  cmp #$04
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  lda #$81
+  sta zp
+  sec
+  lsr zp
+  php
+  lda zp
+  cmp #$40
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  ldx #3
+  lda #$81
+  sta DATA,x
+  sec
+  lsr DATA,x
+  php
+  lda DATA+3
+  cmp #$40
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  lda #$02
+  sta zp
+  clc
+  lsr zp
+  php
+  lda zp
+  cmp #$01
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  ldx #3
+  lda #$02
+  sta DATA,x
+  clc
+  lsr DATA,x
+  php
+  lda DATA+3
+  cmp #$01
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  lda #$81
+  sta zp
+  sec
+  rol zp
+  php
+  lda zp
+  cmp #$03
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  ldx #3
+  lda #$81
+  sta DATA,x
+  sec
+  rol DATA,x
+  php
+  lda DATA+3
+  cmp #$03
+  bne *
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  lda #$02
+  sta zp
+  clc
+  rol zp
+  php
+  lda zp
+  cmp #$04
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  ldx #3
+  lda #$02
+  sta DATA,x
+  clc
+  rol DATA,x
+  php
+  lda DATA+3
+  cmp #$04
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  lda #$81
+  sta zp
+  sec
+  ror zp
+  php
+  lda zp
+  cmp #$C0
+  bne *
+  pla
+  and #$83
+  cmp #$81
+  bne *
+  ldx #3
+  lda #$81
+  sta DATA,x
+  sec
+  ror DATA,x
+  php
+  lda DATA+3
+  cmp #$C0
+  bne *
+  pla
+  and #$83
+  cmp #$81
+  bne *
+  lda #$02
+  sta zp
+  clc
+  ror zp
+  php
+  lda zp
+  cmp #$01
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  ldx #3
+  lda #$02
+  sta DATA,x
+  clc
+  ror DATA,x
+  php
+  lda DATA+3
+  cmp #$01
+  bne *
+  pla
+  and #$83
+  cmp #$00
+  bne *
+
+; INC and DEC in memory
+  lda #$7F
+  sta zp
+  inc zp
+  php
+  lda zp
+  cmp #$80
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  lda #$FF
+  sta zp
+  inc zp
+  php
+  lda zp
+  cmp #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+  lda #$00
+  sta zp
+  inc zp
+  php
+  lda zp
+  cmp #$01
+  bne *
+  pla
+  and #$82
+  cmp #$00
+  bne *
+  lda #$01
+  sta zp
+  inc zp
+  php
+  lda zp
+  cmp #$02
+  bne *
+  pla
+  and #$82
+  cmp #$00
+  bne *
+  ldx #$10
+  lda #$FF
+  sta DATA+$10
+  inc DATA,x
+  lda DATA+$10
+  cmp #$00
+  bne *
+  lda #$7F
+  sta zp
+  dec zp
+  php
+  lda zp
+  cmp #$7E
+  bne *
+  pla
+  and #$82
+  cmp #$00
+  bne *
+  lda #$FF
+  sta zp
+  dec zp
+  php
+  lda zp
+  cmp #$FE
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  lda #$00
+  sta zp
+  dec zp
+  php
+  lda zp
+  cmp #$FF
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  lda #$01
+  sta zp
+  dec zp
+  php
+  lda zp
+  cmp #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+  ldx #$10
+  lda #$FF
+  sta DATA+$10
+  dec DATA,x
+  lda DATA+$10
+  cmp #$FE
+  bne *
+
+; INX, DEX, INY, DEY and the transfers
+  ldx #$FF
+  inx
+  php
+  cpx #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+  ldx #$00
+  inx
+  php
+  cpx #$01
+  bne *
+  pla
+  and #$82
+  cmp #$00
+  bne *
+  ldx #$80
+  inx
+  php
+  cpx #$81
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  ldx #$FF
+  dex
+  php
+  cpx #$FE
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  ldx #$00
+  dex
+  php
+  cpx #$FF
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  ldx #$80
+  dex
+  php
+  cpx #$7F
+  bne *
+  pla
+  and #$82
+  cmp #$00
+  bne *
+  ldy #$FF
+  iny
+  php
+  cpy #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+  ldy #$00
+  iny
+  php
+  cpy #$01
+  bne *
+  pla
+  and #$82
+  cmp #$00
+  bne *
+  ldy #$80
+  iny
+  php
+  cpy #$81
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  ldy #$FF
+  dey
+  php
+  cpy #$FE
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  ldy #$00
+  dey
+  php
+  cpy #$FF
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  ldy #$80
+  dey
+  php
+  cpy #$7F
+  bne *
+  pla
+  and #$82
+  cmp #$00
+  bne *
+  lda #$80
+  tax
+  php
+  cpx #$80
+  bne *
+  pla
+  and #$82
+  cmp #$80
+  bne *
+  ldy #$00
+  tya
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$82
+  cmp #$02
+  bne *
+  ldx #$42
+  txa
+  tay
+  cpy #$42
+  bne *
+
+; CMP, CPX, CPY
+  lda #$10
+  cmp #$10
+  php
+  pla
+  and #$83
+  cmp #$03
+  bne *
+  ldx #$10
+  cpx #$10
+  php
+  pla
+  and #$83
+  cmp #$03
+  bne *
+  ldy #$10
+  cpy #$10
+  php
+  pla
+  and #$83
+  cmp #$03
+  bne *
+  lda #$10
+  cmp #$20
+  php
+  pla
+  and #$83
+  cmp #$80
+  bne *
+  ldx #$10
+  cpx #$20
+  php
+  pla
+  and #$83
+  cmp #$80
+  bne *
+  ldy #$10
+  cpy #$20
+  php
+  pla
+  and #$83
+  cmp #$80
+  bne *
+  lda #$20
+  cmp #$10
+  php
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  ldx #$20
+  cpx #$10
+  php
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  ldy #$20
+  cpy #$10
+  php
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  lda #$00
+  cmp #$FF
+  php
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  ldx #$00
+  cpx #$FF
+  php
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  ldy #$00
+  cpy #$FF
+  php
+  pla
+  and #$83
+  cmp #$00
+  bne *
+  lda #$FF
+  cmp #$00
+  php
+  pla
+  and #$83
+  cmp #$81
+  bne *
+  ldx #$FF
+  cpx #$00
+  php
+  pla
+  and #$83
+  cmp #$81
+  bne *
+  ldy #$FF
+  cpy #$00
+  php
+  pla
+  and #$83
+  cmp #$81
+  bne *
+  lda #$80
+  cmp #$01
+  php
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  ldx #$80
+  cpx #$01
+  php
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  ldy #$80
+  cpy #$01
+  php
+  pla
+  and #$83
+  cmp #$01
+  bne *
+  lda #$40
+  sta zp
+  sta DATA
+  lda #$40
+  cmp zp
+  bne *
+  cmp DATA
+  bne *
+  ldx #$40
+  cpx zp
+  bne *
+  cpx DATA
+  bne *
+  ldy #$40
+  cpy zp
+  bne *
+  cpy DATA
+  bne *
+
+; BIT
+  lda #$C0
+  sta zp
+  sta DATA
+  lda #$FF
+  bit zp
+  php
+  pla
+  and #$C2
+  cmp #$C0
+  bne *
+  lda #$FF
+  bit DATA
+  php
+  pla
+  and #$C2
+  cmp #$C0
+  bne *
+  lda #$40
+  sta zp
+  sta DATA
+  lda #$01
+  bit zp
+  php
+  pla
+  and #$C2
+  cmp #$42
+  bne *
+  lda #$01
+  bit DATA
+  php
+  pla
+  and #$C2
+  cmp #$42
+  bne *
+  lda #$80
+  sta zp
+  sta DATA
+  lda #$3F
+  bit zp
+  php
+  pla
+  and #$C2
+  cmp #$82
+  bne *
+  lda #$3F
+  bit DATA
+  php
+  pla
+  and #$C2
+  cmp #$82
+  bne *
+  lda #$0F
+  sta zp
+  sta DATA
+  lda #$0F
+  bit zp
+  php
+  pla
+  and #$C2
+  cmp #$00
+  bne *
+  lda #$0F
+  bit DATA
+  php
+  pla
+  and #$C2
+  cmp #$00
+  bne *
+
+; Addressing modes, loads of values stored through other modes
+  lda #$11          ; zp,X wraps around in page zero
+  sta $08
+  ldx #$10
+  lda $F8,x
+  cmp #$11
+  bne *
+  lda #$22          ; absolute,X and absolute,Y across a page
+  sta DATA+$105
+  ldx #$0A
+  lda DATA+$FB,x
+  cmp #$22
+  bne *
+  ldy #$0A
+  lda DATA+$FB,y
+  cmp #$22
+  bne *
+  lda #<(DATA+$100) ; (zp,X)
+  sta ptr+2
+  lda #>(DATA+$100)
+  sta ptr+3
+  lda #$33
+  ldx #2
+  sta (ptr,x)
+  lda DATA+$100
+  cmp #$33
+  bne *
+  lda #0
+  lda (ptr,x)
+  cmp #$33
+  bne *
+  lda #<(DATA+$F0)  ; (zp),Y across a page
+  sta ptr
+  lda #>(DATA+$F0)
+  sta ptr+1
+  ldy #$15
+  lda (ptr),y
+  cmp #$22
+  bne *
+  lda #$44
+  sta (ptr),y
+  lda DATA+$105
+  cmp #$44
+  bne *
+  ldy #$55          ; LDX zp,Y, STX zp,Y, STY zp,X, LDY absolute,X
+  ldx #$01
+  sty zp,x
+  ldy #0
+  ldx zp+1
+  cpx #$55
+  bne *
+  ldy #$02
+  stx zp,y
+  ldy zp+2
+  cpy #$55
+  bne *
+  ldx #$02
+  ldy DATA+$103,x
+  cpy #$44
+  bne *
+
+; Stack
+  tsx               ; PHA and PLA are last in, first out
+  stx zp
+  lda #$12
+  pha
+  lda #$34
+  pha
+  tsx
+  inx
+  inx
+  cpx zp
+  bne *
+  lda $0100,x
+  cmp #$12
+  bne *
+  pla
+  cmp #$34
+  bne *
+  pla
+  cmp #$12
+  bne *
+  tsx
+  cpx zp
+  bne *
+  lda #$FF          ; PLP restores all flags, PHP pushes B and bit 5 set
+  pha
+  plp
+  php
+  pla
+  cmp #$FF
+  bne *
+  lda #$00
+  pha
+  plp
+  php
+  pla
+  cmp #$30
+  bne *
+  cld               ; The $FF above set D and I
+  cli
+  ldx zp            ; TXS sets no flags
+  lda #$00
+  txs
+  bne *
+
+; JSR pushes the address of its last byte, RTS returns after it
+  jsr subroutine
+return:
+  cmp #$5A
+  bne *
+  jmp jumps
+subroutine:
+  tsx
+  lda $0101,x
+  cmp #<(return-1)
+  bne *
+  lda $0102,x
+  cmp #>(return-1)
+  bne *
+  lda #$5A
+  rts
+
+; JMP (indirect), reading the high byte from the start of the page when the
+; pointer is the last byte of one
+jumps:
+  lda #<jump_target
+  sta DATA+$10
+  lda #>jump_target
+  sta DATA+$11
+  jmp (DATA+$10)
+  jmp *
+jump_target:
+  lda #<jump_wrap
+  sta DATA+$FF
+  lda #>jump_wrap
+  sta DATA
+  lda #$FF
+  sta DATA+$100
+  jmp (DATA+$FF)
+  jmp *
+jump_wrap:
+
+; Branches, each taken and not taken. A wrong one lands on itself.
+  lda #$00          ; Z set, N clear
+  bne *
+  bmi *
+  beq branch_1
+  jmp *
+branch_1:
+  bpl branch_2
+  jmp *
+branch_2:
+  lda #$80          ; Z clear, N set
+  beq *
+  bpl *
+  bne branch_3
+  jmp *
+branch_3:
+  bmi branch_4
+  jmp *
+branch_4:
+  clc
+  bcs *
+  bcc branch_5
+  jmp *
+branch_5:
+  sec
+  bcc *
+  bcs branch_6
+  jmp *
+branch_6:
+  clv
+  bvs *
+  bvc branch_7
+  jmp *
+branch_7:
+  lda #$40          ; BIT copies bit 6 into V
+  sta zp
+  bit zp
+  bvc *
+  bvs branch_8
+  jmp *
+branch_8:
+  ldx #3            ; Backwards
+branch_back:
+  dex
+  bne branch_back
+  cpx #0
+  bne *
+
+; Decimal mode
+  sed
+  ; 09 + 01 + 0 = 10
+  clc
+  lda #$09
+  adc #$01
+  php
+  cmp #$10
+  bne *
+  pla
+  and #$01
+  cmp #$00
+  bne *
+  ; 58 + 46 + 1 = 05
+  sec
+  lda #$58
+  adc #$46
+  php
+  cmp #$05
+  bne *
+  pla
+  and #$01
+  cmp #$01
+  bne *
+  ; 99 + 01 + 0 = 00
+  clc
+  lda #$99
+  adc #$01
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$01
+  cmp #$01
+  bne *
+  ; 50 + 49 + 1 = 00
+  sec
+  lda #$50
+  adc #$49
+  php
+  cmp #$00
+  bne *
+  pla
+  and #$01
+  cmp #$01
+  bne *
+  ; 12 + 34 + 0 = 46
+  clc
+  lda #$12
+  adc #$34
+  php
+  cmp #$46
+  bne *
+  pla
+  and #$01
+  cmp #$00
+  bne *
+  ; 10 - 01 - 0 = 09
+  sec
+  lda #$10
+  sbc #$01
+  php
+  cmp #$09
+  bne *
+  pla
+  and #$01
+  cmp #$01
+  bne *
+  ; 00 - 01 - 0 = 99
+  sec
+  lda #$00
+  sbc #$01
+  php
+  cmp #$99
+  bne *
+  pla
+  and #$01
+  cmp #$00
+  bne *
+  ; 46 - 12 - 0 = 34
+  sec
+  lda #$46
+  sbc #$12
+  php
+  cmp #$34
+  bne *
+  pla
+  and #$01
+  cmp #$01
+  bne *
+  ; 40 - 13 - 1 = 26
+  clc
+  lda #$40
+  sbc #$13
+  php
+  cmp #$26
+  bne *
+  pla
+  and #$01
+  cmp #$01
+  bne *
+  ; 32 - 02 - 1 = 29
+  clc
+  lda #$32
+  sbc #$02
+  php
+  cmp #$29
+  bne *
+  pla
+  and #$01
+  cmp #$01
+  bne *
+  cld
+
+; Flag instructions
+  sec
+  sei
+  sed
+  lda #$7F
+  adc #$00          ; Decimal $7F + 0 + 1 sets V
+  php
+  pla
+  and #$4D
+  cmp #$4C          ; V D I set, C clear
+  bne *
+  clc
+  cli
+  cld
+  clv
+  php
+  pla
+  and #$4D
+  bne *
+  rts
@@ -0,0 +1,41 @@
+; --------------------------------------------------------------------------
+; harness.s: Start code shared by the benchmark programs
+; 17.10.2026 github.com/SMDHuman
+; --------------------------------------------------------------------------
+; Every program is loaded at $8000 with the reset vector pointing there and
+; provides a "bench" subroutine that does one run of its workload and checks
+; the result itself, jumping to "fail" on a wrong one. The harness repeats it
+; count times, 0 repeats forever as wanted when it runs on the board, then
+; reports through status and stops in a JMP * trap.
+count  = $00 ; Runs left, 16 bit, written by the host runner
+status = $02 ; 0 while running, 1 passed, $FF failed
+
+  .org $8000
+start:
+  ldx #$FF
+  txs
+  cld
+  lda #0
+  sta status
+run:
+  jsr bench
+  lda count
+  ora count+1
+  beq run          ; Repeat forever
+  lda count
+  bne count_low
+  dec count+1
+count_low:
+  dec count
+  lda count
+  ora count+1
+  bne run
+  lda #1
+  sta status
+pass:
+  jmp pass
+fail:
+  lda #$FF
+  sta status
+fail_trap:
+  jmp fail_trap
@@ -0,0 +1,88 @@
+; --------------------------------------------------------------------------
+; memcpy.s: memset and memcpy of 4 KiB blocks
+; 17.10.2026 github.com/SMDHuman
+; --------------------------------------------------------------------------
+; The usual page loops, through (zp),Y pointers and absolute,X addressing.
+  .include "harness.s"
+
+SRC   = $2000
+DST   = $4000
+PAGES = 16
+src   = $10
+dst   = $12
+pages = $14
+value = $15
+
+bench:
+  lda #>SRC        ; memset(SRC, $A5, 4096)
+  ldx #$A5
+  jsr memset
+  lda #>DST        ; memset(DST, 0, 4096)
+  ldx #0
+  jsr memset
+  jsr memcpy       ; memcpy(DST, SRC, 4096)
+  ldx #0           ; Page at a time with absolute,X, one byte in each
+copy_abs:          ; page of SRC changes on the way
+  lda SRC,x
+  eor #$FF
+  sta SRC+$100,x
+  inx
+  bne copy_abs
+  ldx #0           ; Check the copy, and the changed page
+check:
+  lda DST,x
+  cmp #$A5
+  bne wrong
+  lda DST+$F00,x
+  cmp #$A5
+  bne wrong
+  lda SRC+$100,x
+  cmp #$5A
+  bne wrong
+  inx
+  bne check
+  rts
+wrong:
+  jmp fail
+
+; Fill PAGES pages from page A with X
+memset:
+  sta dst+1
+  stx value
+  lda #0
+  sta dst
+  lda #PAGES
+  sta pages
+  lda value
+  ldy #0
+memset_byte:
+  sta (dst),y
+  iny
+  bne memset_byte
+  inc dst+1
+  dec pages
+  bne memset_byte
+  rts
+
+; Copy PAGES pages from SRC to DST
+memcpy:
+  lda #<SRC
+  sta src
+  lda #>SRC
+  sta src+1
+  lda #<DST
+  sta dst
+  lda #>DST
+  sta dst+1
+  ldx #PAGES
+  ldy #0
+memcpy_byte:
+  lda (src),y
+  sta (dst),y
+  iny
+  bne memcpy_byte
+  inc src+1
+  inc dst+1
+  dex
+  bne memcpy_byte
+  rts
@@ -0,0 +1,79 @@
+; --------------------------------------------------------------------------
+; sieve.s: Sieve of Eratosthenes over the numbers below 8192
+; 17.10.2026 github.com/SMDHuman
+; --------------------------------------------------------------------------
+; Byte flags, 16 bit pointer arithmetic and (zp),Y stores in a tight loop.
+  .include "harness.s"
+
+FLAGS  = $2000     ; One byte per number, 8192 bytes
+SIZE   = 8192
+PRIMES = 1028      ; Primes below SIZE
+ptr    = $10
+num    = $12
+primes = $14
+
+bench:
+  lda #<FLAGS      ; Every number is a prime candidate
+  sta ptr
+  lda #>FLAGS
+  sta ptr+1
+  ldx #>SIZE
+  ldy #0
+  lda #1
+fill:
+  sta (ptr),y
+  iny
+  bne fill
+  inc ptr+1
+  dex
+  bne fill
+  lda #0
+  sta primes
+  sta primes+1
+  sta num+1
+  lda #2
+  sta num
+next:
+  clc              ; ptr = FLAGS + num
+  lda #<FLAGS
+  adc num
+  sta ptr
+  lda #>FLAGS
+  adc num+1
+  sta ptr+1
+  ldy #0
+  lda (ptr),y
+  beq skip
+  inc primes
+  bne mark
+  inc primes+1
+mark:
+  clc              ; Clear every multiple of num
+  lda ptr
+  adc num
+  sta ptr
+  lda ptr+1
+  adc num+1
+  sta ptr+1
+  cmp #>(FLAGS+SIZE)
+  bcs skip
+  lda #0
+  sta (ptr),y
+  jmp mark
+skip:
+  inc num
+  bne test
+  inc num+1
+test:
+  lda num+1
+  cmp #>SIZE
+  bcc next
+  lda primes
+  cmp #<PRIMES
+  bne wrong
+  lda primes+1
+  cmp #>PRIMES
+  bne wrong
+  rts
+wrong:
+  jmp fail
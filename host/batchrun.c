@@ -0,0 +1,468 @@
+//-----------------------------------------------------------------------------
+// batchrun.c: Runs many ROM jobs in parallel, one machine per thread
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "fake6502.h"
+#include "fakemem.h"
+#include "fake6522.h"
+#include "host_run.h"
+
+#ifndef FAKEMEM_THREAD_LOCAL
+#error "batchrun needs the memory map per thread, build with FAKEMEM_THREAD_LOCAL"
+#endif
+
+//-----------------------------------------------------------------------------
+#define BATCH_MAX_BYTES 16  // Pokes or expected bytes per job
+#define BATCH_PATH 256
+
+typedef struct {
+  uint16_t address;
+  uint8_t value;
+} batch_byte_t;
+
+typedef struct {
+  // What to run
+  char name[64];
+  char rom[BATCH_PATH];
+  char data[BATCH_PATH];   // Input file loaded at data_address, if set
+  uint16_t load_address;
+  uint16_t data_address;
+  int32_t start;           // Start pc, -1 for the reset vector
+  int32_t pass;            // Trap the run must end in, -1 for any
+  uint64_t max_instructions;
+  uint64_t max_cycles;
+  batch_byte_t pokes[BATCH_MAX_BYTES];
+  batch_byte_t expects[BATCH_MAX_BYTES];
+  uint8_t npokes;
+  uint8_t nexpects;
+  // How it went
+  uint8_t passed;
+  host_run_stop_t reason;
+  uint16_t pc;
+  host_run_stats_t stats;
+  char error[BATCH_PATH + 64]; // Room for a full path and the message
+} batch_job_t;
+
+// Jobs of one worker. It takes from the tail, the others steal from the head
+typedef struct {
+  pthread_mutex_t lock;
+  uint32_t *jobs;
+  uint32_t head;
+  uint32_t tail;
+} batch_deque_t;
+
+typedef struct {
+  pthread_t thread;
+  uint32_t index;
+  uint32_t ran;
+  uint32_t stolen;
+} batch_worker_t;
+
+static batch_job_t *jobs;
+static uint32_t njobs;
+static batch_deque_t *deques;
+static batch_worker_t *workers;
+static uint32_t nworkers;
+
+//-----------------------------------------------------------------------------
+static void usage(void){
+  fprintf(stderr,
+    "usage: batchrun [options] [rom.bin...]\n"
+    "  -f FILE        jobs, one per line: rom.bin [key=value...], keys are\n"
+    "                 name load start data=FILE@ADDR poke=ADDR:VALUE\n"
+    "                 expect=ADDR:VALUE pass=ADDR cycles instructions\n"
+    "  -j N           worker threads (default: all cores)\n"
+    "  -a ADDR        load address (default 0x8000)\n"
+    "  -w ADDR:VALUE  poke a byte before the run, repeatable\n"
+    "  -e ADDR:VALUE  byte the run must leave behind, repeatable\n"
+    "  -p ADDR        trap the run must end in\n"
+    "  -c N / -n N    cycle / instruction limit (default 1e9 instructions)\n"
+    "  -J             JSON output\n"
+    "  -q             print failed jobs only\n"
+    "The options apply to every job, a job file can override them.\n");
+}
+
+//-----------------------------------------------------------------------------
+static int parse_byte(const char *text, batch_byte_t *byte){
+  char *end;
+  unsigned long address = strtoul(text, &end, 0);
+  if(*end != ':' || address > 0xFFFF) return -1;
+  unsigned long value = strtoul(end + 1, &end, 0);
+  if(*end != 0 || value > 0xFF) return -1;
+  byte->address = address;
+  byte->value = value;
+  return 0;
+}
+
+static int add_byte(batch_byte_t *bytes, uint8_t *count, const char *text){
+  if(*count == BATCH_MAX_BYTES || parse_byte(text, &bytes[*count]) != 0) return -1;
+  (*count)++;
+  return 0;
+}
+
+// Name of a job from its ROM, the file name without directory and extension
+static void job_name(batch_job_t *job){
+  const char *base = strrchr(job->rom, '/');
+  base = base ? base + 1 : job->rom;
+  size_t len = strcspn(base, ".");
+  if(len >= sizeof(job->name)) len = sizeof(job->name) - 1;
+  memcpy(job->name, base, len);
+  job->name[len] = 0;
+}
+
+// Relative paths of a job file are relative to its directory
+static void job_path(char *out, const char *dir, const char *path){
+  if(path[0] == '/' || dir[0] == 0){
+    snprintf(out, BATCH_PATH, "%s", path);
+  } else {
+    snprintf(out, BATCH_PATH, "%s/%s", dir, path);
+  }
+}
+
+static batch_job_t *new_job(const batch_job_t *defaults){
+  static uint32_t capacity;
+  if(njobs == capacity){
+    capacity = capacity ? capacity * 2 : 64;
+    jobs = realloc(jobs, capacity * sizeof(batch_job_t));
+    if(jobs == NULL){
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+  }
+  jobs[njobs] = *defaults;
+  return &jobs[njobs++];
+}
+
+//-----------------------------------------------------------------------------
+static int read_jobs(const char *path, const batch_job_t *defaults){
+  FILE *f = fopen(path, "r");
+  if(f == NULL){
+    perror(path);
+    return -1;
+  }
+  char dir[BATCH_PATH];
+  snprintf(dir, sizeof(dir), "%s", path);
+  char *slash = strrchr(dir, '/');
+  if(slash != NULL){
+    *slash = 0;
+  } else {
+    dir[0] = 0;
+  }
+  char line[1024];
+  int number = 0;
+  while(fgets(line, sizeof(line), f) != NULL){
+    number++;
+    char *comment = strchr(line, '#');
+    if(comment != NULL) *comment = 0;
+    char *save;
+    char *word = strtok_r(line, " \t\r\n", &save);
+    if(word == NULL) continue;
+    batch_job_t *job = new_job(defaults);
+    job_path(job->rom, dir, word);
+    job_name(job);
+    while((word = strtok_r(NULL, " \t\r\n", &save)) != NULL){
+      char *value = strchr(word, '=');
+      int bad = value == NULL;
+      if(!bad){
+        *value++ = 0;
+        if(!strcmp(word, "name")){
+          snprintf(job->name, sizeof(job->name), "%s", value);
+        } else if(!strcmp(word, "load")){
+          job->load_address = strtoul(value, NULL, 0);
+        } else if(!strcmp(word, "start")){
+          job->start = strtoul(value, NULL, 0) & 0xFFFF;
+        } else if(!strcmp(word, "pass")){
+          job->pass = strtoul(value, NULL, 0) & 0xFFFF;
+        } else if(!strcmp(word, "cycles")){
+          job->max_cycles = strtoull(value, NULL, 0);
+        } else if(!strcmp(word, "instructions")){
+          job->max_instructions = strtoull(value, NULL, 0);
+        } else if(!strcmp(word, "poke")){
+          bad = add_byte(job->pokes, &job->npokes, value);
+        } else if(!strcmp(word, "expect")){
+          bad = add_byte(job->expects, &job->nexpects, value);
+        } else if(!strcmp(word, "data")){
+          char *at = strrchr(value, '@');
+          bad = at == NULL;
+          if(!bad){
+            *at = 0;
+            job_path(job->data, dir, value);
+            job->data_address = strtoul(at + 1, NULL, 0);
+          }
+        } else {
+          bad = 1;
+        }
+      }
+      if(bad){
+        fprintf(stderr, "%s:%d: bad option '%s'\n", path, number, word);
+        fclose(f);
+        return -1;
+      }
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Copy a file into the memory map of this thread
+static int load(batch_job_t *job, const char *path, uint16_t address){
+  uint32_t size;
+  uint8_t *data = host_run_read_file(path, &size);
+  if(data == NULL){
+    snprintf(job->error, sizeof(job->error), "can't read %s", path);
+    return -1;
+  }
+  if(size > 0x10000u - address){
+    snprintf(job->error, sizeof(job->error), "%s doesn't fit at $%04X", path, address);
+    free(data);
+    return -1;
+  }
+  memcpy(&fakemem[address], data, size);
+  free(data);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// CPU time of the calling thread
+static double thread_seconds(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//-----------------------------------------------------------------------------
+// One job on the machine of this thread, from a fresh memory map and 6522
+static void run_job(batch_job_t *job, cpu6502_t *cpu){
+  static const fake6522_state_t via_reset;
+  fakemem_init(job->load_address);
+  fake6522_set_state(&via_reset);
+  if(load(job, job->rom, job->load_address) != 0) return;
+  if(job->data[0] && load(job, job->data, job->data_address) != 0) return;
+  for(int i = 0; i < job->npokes; i++){
+    fakemem[job->pokes[i].address] = job->pokes[i].value;
+  }
+  cpu6502_bus_t bus = { NULL, fakemem_read, fakemem_write, fakemem };
+  cpu6502_init(cpu, &bus);
+  cpu6502_invalidate(cpu, 0, 0x10000);
+  reset6502(cpu);
+  if(job->start >= 0){
+    cpu->pc = job->start;
+  }
+  cpu->idledetect = 1;
+
+  double start = thread_seconds();
+  job->reason = host_run(cpu, job->max_instructions, job->max_cycles, &job->stats);
+  // With more jobs than cores the wall time of a job includes the others
+  job->stats.seconds = thread_seconds() - start;
+  job->pc = cpu->pc;
+  if(job->reason != HOST_RUN_TRAP){
+    snprintf(job->error, sizeof(job->error), "%s at $%04X", host_run_reason(job->reason), job->pc);
+    return;
+  }
+  if(job->pass >= 0 && job->pc != job->pass){
+    snprintf(job->error, sizeof(job->error), "trap at $%04X, not $%04X", job->pc, job->pass);
+    return;
+  }
+  for(int i = 0; i < job->nexpects; i++){
+    batch_byte_t *e = &job->expects[i];
+    if(fakemem[e->address] != e->value){
+      snprintf(job->error, sizeof(job->error), "$%04X is $%02X, not $%02X (trap at $%04X)",
+               e->address, fakemem[e->address], e->value, job->pc);
+      return;
+    }
+  }
+  job->passed = 1;
+}
+
+//-----------------------------------------------------------------------------
+static int pop(batch_deque_t *d, uint32_t *job){
+  int found = 0;
+  pthread_mutex_lock(&d->lock);
+  if(d->tail > d->head){
+    *job = d->jobs[--d->tail];
+    found = 1;
+  }
+  pthread_mutex_unlock(&d->lock);
+  return found;
+}
+
+static int steal(batch_deque_t *d, uint32_t *job){
+  int found = 0;
+  pthread_mutex_lock(&d->lock);
+  if(d->tail > d->head){
+    *job = d->jobs[d->head++];
+    found = 1;
+  }
+  pthread_mutex_unlock(&d->lock);
+  return found;
+}
+
+// Runs its own jobs, then steals from the others until every deque is empty.
+// No job makes new ones, so an empty round means the batch is done.
+static void *worker(void *arg){
+  batch_worker_t *w = arg;
+  cpu6502_t *cpu = malloc(sizeof(cpu6502_t));
+  if(cpu == NULL) return NULL;
+  while(1){
+    uint32_t job;
+    int found = pop(&deques[w->index], &job);
+    for(uint32_t i = 1; !found && i < nworkers; i++){
+      found = steal(&deques[(w->index + i) % nworkers], &job);
+      w->stolen += found;
+    }
+    if(!found) break;
+    run_job(&jobs[job], cpu);
+    w->ran++;
+  }
+  free(cpu);
+  return NULL;
+}
+
+//-----------------------------------------------------------------------------
+static void print_text(int quiet, double wall, double emulated, uint64_t instructions,
+                       uint64_t cycles, uint32_t failed, uint32_t stolen){
+  for(uint32_t i = 0; i < njobs; i++){
+    batch_job_t *job = &jobs[i];
+    if(!job->passed){
+      printf("FAIL %s: %s\n", job->name, job->error);
+    } else if(!quiet){
+      printf("PASS %s: %llu instructions, %llu cycles, %.3f s, %.1f Mips\n", job->name,
+             (unsigned long long)job->stats.instructions, (unsigned long long)job->stats.cycles,
+             job->stats.seconds,
+             job->stats.seconds > 0 ? job->stats.instructions / job->stats.seconds / 1e6 : 0.0);
+    }
+  }
+  printf("%u jobs: %u passed, %u failed\n", njobs, njobs - failed, failed);
+  printf("%llu instructions, %llu cycles\n", (unsigned long long)instructions,
+         (unsigned long long)cycles);
+  printf("%.3f s on %u threads for %.3f s of emulation (%.1fx), %.1f Mips, %u jobs stolen\n",
+         wall, nworkers, emulated, wall > 0 ? emulated / wall : 0.0,
+         wall > 0 ? instructions / wall / 1e6 : 0.0, stolen);
+}
+
+static void print_json(double wall, double emulated, uint64_t instructions, uint64_t cycles,
+                       uint32_t failed, uint32_t stolen){
+  printf("{\n  \"engine\": \"%s\",\n  \"threads\": %u,\n  \"jobs\": [", FAKE6502_ENGINE, nworkers);
+  for(uint32_t i = 0; i < njobs; i++){
+    batch_job_t *job = &jobs[i];
+    double seconds = job->stats.seconds > 0 ? job->stats.seconds : 1e-9;
+    printf("%s\n    {\"name\": \"%s\", \"passed\": %s, \"error\": \"%s\", \"pc\": %u, "
+           "\"instructions\": %llu, \"cycles\": %llu, \"seconds\": %.6f, "
+           "\"instructions_per_second\": %.0f, \"cycles_per_second\": %.0f}",
+           i ? "," : "", job->name, job->passed ? "true" : "false", job->error, job->pc,
+           (unsigned long long)job->stats.instructions, (unsigned long long)job->stats.cycles,
+           job->stats.seconds, job->stats.instructions / seconds, job->stats.cycles / seconds);
+  }
+  printf("\n  ],\n  \"passed\": %u,\n  \"failed\": %u,\n  \"instructions\": %llu,\n"
+         "  \"cycles\": %llu,\n  \"seconds\": %.6f,\n  \"emulated_seconds\": %.6f,\n"
+         "  \"instructions_per_second\": %.0f,\n  \"stolen\": %u\n}\n",
+         njobs - failed, failed, (unsigned long long)instructions, (unsigned long long)cycles,
+         wall, emulated, wall > 0 ? instructions / wall : 0.0, stolen);
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv){
+  batch_job_t defaults = {
+    .load_address = 0x8000,
+    .start = -1,
+    .pass = -1,
+    .max_instructions = 1000000000ULL,
+  };
+  const char *job_files[16];
+  int njob_files = 0;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  int json = 0, quiet = 0;
+  int opt;
+  while((opt = getopt(argc, argv, "f:j:a:w:e:p:c:n:Jqh")) != -1){
+    int bad = 0;
+    switch(opt){
+      case 'f':
+        bad = njob_files == 16;
+        if(!bad) job_files[njob_files++] = optarg;
+      break;
+      case 'j': threads = atol(optarg); break;
+      case 'a': defaults.load_address = strtoul(optarg, NULL, 0); break;
+      case 'w': bad = add_byte(defaults.pokes, &defaults.npokes, optarg); break;
+      case 'e': bad = add_byte(defaults.expects, &defaults.nexpects, optarg); break;
+      case 'p': defaults.pass = strtoul(optarg, NULL, 0) & 0xFFFF; break;
+      case 'c': defaults.max_cycles = strtoull(optarg, NULL, 0); break;
+      case 'n': defaults.max_instructions = strtoull(optarg, NULL, 0); break;
+      case 'J': json = 1; break;
+      case 'q': quiet = 1; break;
+      default:
+        usage();
+        return opt == 'h' ? 0 : 1;
+    }
+    if(bad){
+      fprintf(stderr, "bad value '%s' of -%c\n", optarg, opt);
+      return 1;
+    }
+  }
+  for(int i = 0; i < njob_files; i++){
+    if(read_jobs(job_files[i], &defaults) != 0) return 1;
+  }
+  for(int i = optind; i < argc; i++){
+    batch_job_t *job = new_job(&defaults);
+    snprintf(job->rom, sizeof(job->rom), "%s", argv[i]);
+    job_name(job);
+  }
+  if(njobs == 0){
+    usage();
+    return 1;
+  }
+  if(threads < 1) threads = 1;
+  nworkers = (uint32_t)threads < njobs ? (uint32_t)threads : njobs;
+
+  // Jobs dealt round robin, neighbours in a job file tend to be alike
+  deques = calloc(nworkers, sizeof(batch_deque_t));
+  workers = calloc(nworkers, sizeof(batch_worker_t));
+  for(uint32_t i = 0; i < nworkers; i++){
+    batch_deque_t *d = &deques[i];
+    pthread_mutex_init(&d->lock, NULL);
+    d->jobs = malloc((njobs / nworkers + 1) * sizeof(uint32_t));
+    d->tail = (njobs - i + nworkers - 1) / nworkers;
+    for(uint32_t k = 0; k < d->tail; k++){
+      d->jobs[k] = i + (d->tail - 1 - k) * nworkers; // First job at the tail
+    }
+  }
+
+  double start = host_run_seconds();
+  for(uint32_t i = 0; i < nworkers; i++){
+    workers[i].index = i;
+    if(pthread_create(&workers[i].thread, NULL, worker, &workers[i]) != 0){
+      fprintf(stderr, "can't start worker %u\n", i);
+      return 1;
+    }
+  }
+  uint32_t stolen = 0;
+  for(uint32_t i = 0; i < nworkers; i++){
+    pthread_join(workers[i].thread, NULL);
+    stolen += workers[i].stolen;
+  }
+  double wall = host_run_seconds() - start;
+
+  uint32_t failed = 0;
+  uint64_t instructions = 0, cycles = 0;
+  double emulated = 0;
+  for(uint32_t i = 0; i < njobs; i++){
+    failed += !jobs[i].passed;
+    instructions += jobs[i].stats.instructions;
+    cycles += jobs[i].stats.cycles;
+    emulated += jobs[i].stats.seconds;
+  }
+  if(json){
+    print_json(wall, emulated, instructions, cycles, failed, stolen);
+  } else {
+    print_text(quiet, wall, emulated, instructions, cycles, failed, stolen);
+  }
+  return failed ? 2 : 0;
+}
@@ -0,0 +1,121 @@
+//-----------------------------------------------------------------------------
+// benchrun.c: Runs the benchmark programs of bench/ and reports JSON
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fake6502.h"
+#include "fakemem.h"
+#include "host_run.h"
+
+//-----------------------------------------------------------------------------
+// Zero page interface of bench/harness.s
+#define BENCH_COUNT 0x00  // Runs of the workload, 16 bit
+#define BENCH_STATUS 0x02 // 1 once all runs passed
+#define BENCH_PASSED 1
+// A program that neither passes nor fails by then is stuck
+#define BENCH_MAX_INSTRUCTIONS 4000000000ULL
+
+static cpu6502_t cpu;
+
+//-----------------------------------------------------------------------------
+static void usage(void){
+  fprintf(stderr,
+    "usage: benchrun [options] program.bin...\n"
+    "  -a ADDR  load address of the programs (default 0x8000)\n"
+    "  -n N     workload runs per measurement (default 10)\n"
+    "  -r N     measurements per program, the fastest counts (default 3)\n");
+}
+
+//-----------------------------------------------------------------------------
+// Name of a benchmark, its file name without directory and extension
+static void bench_name(const char *path, char *name, size_t size){
+  const char *base = strrchr(path, '/');
+  base = base ? base + 1 : path;
+  size_t len = strcspn(base, ".");
+  if(len >= size) len = size - 1;
+  memcpy(name, base, len);
+  name[len] = 0;
+}
+
+//-----------------------------------------------------------------------------
+// One measurement: the program from reset until its harness stops
+static int bench_run(const uint8_t *code, uint32_t size, uint16_t load_address, uint16_t runs,
+                     host_run_stats_t *stats){
+  fakemem_init(load_address);
+  memcpy(&fakemem[load_address], code, size);
+  fakemem[BENCH_COUNT] = runs & 0xFF;
+  fakemem[BENCH_COUNT + 1] = runs >> 8;
+  cpu6502_invalidate(&cpu, 0, 0x10000);
+  reset6502(&cpu);
+  cpu.idledetect = 1;
+  host_run_stop_t reason = host_run(&cpu, BENCH_MAX_INSTRUCTIONS, 0, stats);
+  return reason == HOST_RUN_TRAP && fakemem[BENCH_STATUS] == BENCH_PASSED;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv){
+  uint32_t load_address = 0x8000;
+  uint32_t runs = 10;
+  int measurements = 3;
+  int opt;
+  while((opt = getopt(argc, argv, "a:n:r:h")) != -1){
+    switch(opt){
+      case 'a': load_address = strtoul(optarg, NULL, 0) & 0xFFFF; break;
+      case 'n': runs = strtoul(optarg, NULL, 0); break;
+      case 'r': measurements = atoi(optarg); break;
+      default:
+        usage();
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+  if(optind == argc || runs == 0 || runs > 0xFFFF || measurements < 1){
+    usage();
+    return 1;
+  }
+
+  cpu6502_bus_t bus = { NULL, fakemem_read, fakemem_write, fakemem };
+  cpu6502_init(&cpu, &bus);
+  int failed = 0;
+  printf("{\n  \"engine\": \"%s\",\n  \"runs\": %u,\n  \"benchmarks\": [", FAKE6502_ENGINE, runs);
+  for(int i = optind; i < argc; i++){
+    char name[64];
+    bench_name(argv[i], name, sizeof(name));
+    uint32_t size;
+    uint8_t *code = host_run_read_file(argv[i], &size);
+    if(code == NULL) return 1;
+    if(size > 0x10000 - load_address){
+      fprintf(stderr, "%s: %u bytes don't fit at $%04X\n", argv[i], size, load_address);
+      return 1;
+    }
+    // Every measurement runs the same instructions, the fastest one has the
+    // least noise from the host
+    host_run_stats_t best, stats;
+    int passed = 1;
+    for(int m = 0; m < measurements; m++){
+      passed &= bench_run(code, size, load_address, runs, &stats);
+      if(m == 0 || stats.seconds < best.seconds){
+        best = stats;
+      }
+    }
+    free(code);
+    if(!passed){
+      fprintf(stderr, "%s: failed, stopped at $%04X\n", name, cpu.pc);
+      failed++;
+    }
+    double seconds = best.seconds > 0 ? best.seconds : 1e-9;
+    printf("%s\n    {\"name\": \"%s\", \"passed\": %s, \"instructions\": %llu, \"cycles\": %llu, "
+           "\"seconds\": %.6f, \"instructions_per_second\": %.0f, \"cycles_per_second\": %.0f, "
+           "\"ns_per_instruction\": %.3f}",
+           i == optind ? "" : ",", name, passed ? "true" : "false",
+           (unsigned long long)best.instructions, (unsigned long long)best.cycles, best.seconds,
+           best.instructions / seconds, best.cycles / seconds,
+           best.instructions ? seconds * 1e9 / best.instructions : 0.0);
+  }
+  printf("\n  ]\n}\n");
+  return failed ? 2 : 0;
+}
@@ -0,0 +1,37 @@
+//-----------------------------------------------------------------------------
+// diff_ref.c: Reference engine of diffrun, the legacy core under other names
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+// The options of the engine under test don't apply to the reference
+#undef FAKE6502_FAST
+#undef FAKE6502_PROFILE
+#undef FAKE6502_CALLGRAPH
+#undef FAKE6502_TRACE
+#undef FAKE6502_DIRECT_LOW_PAGES
+#ifndef FAKE6502_LEGACY_CORE
+#define FAKE6502_LEGACY_CORE
+#endif
+
+// Every external symbol of fake6502.c
+#define cpu6502_init ref6502_init
+#define run6502 ref6502_run
+#define exec6502 ref6502_exec
+#define step6502 ref6502_step
+#define reset6502 ref6502_reset
+#define nmi6502 ref6502_nmi
+#define cpu6502_irq_assert ref6502_irq_assert
+#define cpu6502_irq_deassert ref6502_irq_deassert
+#define cpu6502_request_stop ref6502_request_stop
+#define cpu6502_cancel_stop ref6502_cancel_stop
+#define cpu6502_request_sample ref6502_request_sample
+#define cpu6502_set_breakpoint ref6502_set_breakpoint
+#define cpu6502_clear_breakpoints ref6502_clear_breakpoints
+#define cpu6502_invalidate ref6502_invalidate
+#define cpu6502_skip_idle ref6502_skip_idle
+#define hookexternal ref6502_hookexternal
+#define push16 ref6502_push16
+#define push8 ref6502_push8
+#define pull16 ref6502_pull16
+#define pull8 ref6502_pull8
+
+#include "fake6502.c"
@@ -0,0 +1,22 @@
+//-----------------------------------------------------------------------------
+// diff_ref.h: Reference engine of diffrun, the legacy core under other names
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#ifndef DIFF_REF_H
+#define DIFF_REF_H
+
+#include "fake6502.h"
+
+//-----------------------------------------------------------------------------
+// fake6502.c built a second time with FAKE6502_LEGACY_CORE, so it links next
+// to the engine under test. Both share cpu6502_t, its layout doesn't depend
+// on the build options.
+void ref6502_init(cpu6502_t *cpu, const cpu6502_bus_t *bus);
+cpu6502_stop_t ref6502_run(cpu6502_t *cpu, uint32_t budget);
+void ref6502_reset(cpu6502_t *cpu);
+void ref6502_nmi(cpu6502_t *cpu);
+void ref6502_irq_assert(cpu6502_t *cpu, uint32_t source);
+void ref6502_irq_deassert(cpu6502_t *cpu, uint32_t source);
+void ref6502_invalidate(cpu6502_t *cpu, uint16_t address, uint32_t length);
+
+#endif
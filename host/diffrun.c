@@ -0,0 +1,437 @@
+//-----------------------------------------------------------------------------
+// diffrun.c: Lockstep differential runner of the reference and built engine
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fake6502.h"
+#include "diff_ref.h"
+#include "host_run.h"
+
+//-----------------------------------------------------------------------------
+// Both engines run the same number of instructions per block, then their
+// state and the writes of the block are compared. After a difference both go
+// back to the start of the block and repeat it one instruction at a time to
+// find the first one that differs.
+#define DIFF_BLOCK 1000
+#define DIFF_TRACE 16              // Instructions shown before a difference
+#define DIFF_WRITES_PER_INSTRUCTION 8 // More than any instruction makes
+#define DIFF_IRQ_SOURCE CPU6502_IRQ_SOURCE(0)
+#define DIFF_LOW_PAGES 0x200 // Zero page and stack
+
+typedef struct {
+  cpu6502_stop_t (*run)(cpu6502_t *cpu, uint32_t budget);
+  void (*init)(cpu6502_t *cpu, const cpu6502_bus_t *bus);
+  void (*reset)(cpu6502_t *cpu);
+  void (*nmi)(cpu6502_t *cpu);
+  void (*irq_assert)(cpu6502_t *cpu, uint32_t source);
+  void (*irq_deassert)(cpu6502_t *cpu, uint32_t source);
+  void (*invalidate)(cpu6502_t *cpu, uint16_t address, uint32_t length);
+} diff_engine_t;
+
+typedef struct {
+  uint16_t address;
+  uint8_t value;
+} diff_write_t;
+
+// One machine, flat 64 KiB of RAM that logs every write
+typedef struct {
+  const char *name;
+  const diff_engine_t *engine;
+  cpu6502_t cpu;
+  uint8_t memory[0x10000];
+  diff_write_t *writes;
+  uint32_t nwrites;
+  uint32_t capacity;
+  cpu6502_stop_t reason;
+  // Start of the current block
+  cpu6502_t saved_cpu;
+  uint8_t saved_memory[0x10000];
+} diff_machine_t;
+
+// State before one instruction, for the trace
+typedef struct {
+  uint32_t instructions;
+  uint16_t pc;
+  uint8_t opcode, a, x, y, sp, status;
+  uint32_t ticks;
+} diff_step_t;
+
+static const diff_engine_t reference = {
+  ref6502_run, ref6502_init, ref6502_reset, ref6502_nmi, ref6502_irq_assert, ref6502_irq_deassert,
+  ref6502_invalidate
+};
+static const diff_engine_t engine = {
+  run6502, cpu6502_init, reset6502, nmi6502, cpu6502_irq_assert, cpu6502_irq_deassert,
+  cpu6502_invalidate
+};
+
+static diff_machine_t *ref, *opt;
+static diff_step_t trace[DIFF_TRACE];
+static uint32_t ntrace;
+
+//-----------------------------------------------------------------------------
+static void usage(void){
+  fprintf(stderr,
+    "usage: diffrun [options] rom.bin\n"
+    "       diffrun [options] -z SEED\n"
+    "  -a ADDR  load address of the binary (default 0x8000)\n"
+    "  -s ADDR  start address (default: the reset vector)\n"
+    "  -n N     instructions to run, per program when fuzzing (default 1e8, 1e5)\n"
+    "  -b N     instructions per compared block, 1 compares every one (default %d)\n"
+    "  -i N     pulse the IRQ line every N instructions\n"
+    "  -m N     NMI every N instructions\n"
+    "  -z SEED  fuzz with random programs instead of a binary\n"
+    "  -N N     random programs to run (default 100)\n", DIFF_BLOCK);
+}
+
+//-----------------------------------------------------------------------------
+static uint8_t diff_read(void *ctx, uint16_t address){
+  diff_machine_t *m = ctx;
+  return m->memory[address];
+}
+
+static void diff_write(void *ctx, uint16_t address, uint8_t value){
+  diff_machine_t *m = ctx;
+  m->memory[address] = value;
+#ifdef FAKE6502_DIRECT_LOW_PAGES
+  // The engine writes these straight into memory, compared as such
+  if(address < DIFF_LOW_PAGES) return;
+#endif
+  if(m->nwrites < m->capacity){
+    m->writes[m->nwrites] = (diff_write_t){ address, value };
+  }
+  m->nwrites++; // Counted on past the end, a difference in itself
+}
+
+static diff_machine_t *new_machine(const char *name, const diff_engine_t *e, uint32_t block){
+  diff_machine_t *m = calloc(1, sizeof(diff_machine_t));
+  if(m == NULL) return NULL;
+  m->name = name;
+  m->engine = e;
+  m->capacity = block * DIFF_WRITES_PER_INSTRUCTION + 16;
+  m->writes = malloc(m->capacity * sizeof(diff_write_t));
+  if(m->writes == NULL) return NULL;
+  cpu6502_bus_t bus = { m, diff_read, diff_write, m->memory };
+  e->init(&m->cpu, &bus);
+  return m;
+}
+
+// Fresh start on the program in the memory of the reference
+static void load(diff_machine_t *m){
+  if(m != ref){
+    memcpy(m->memory, ref->memory, 0x10000);
+  }
+  m->engine->invalidate(&m->cpu, 0, 0x10000);
+  m->engine->reset(&m->cpu);
+  m->cpu.instructions = 0;
+  m->cpu.clockticks6502 = 0;
+}
+
+//-----------------------------------------------------------------------------
+static uint64_t rng;
+
+static uint64_t random64(void){
+  // xorshift64*
+  rng ^= rng >> 12;
+  rng ^= rng << 25;
+  rng ^= rng >> 27;
+  return rng * 0x2545F4914F6CDD1DULL;
+}
+
+// Random bytes everywhere, vectors included, and random registers. Anything
+// the 6502 can run is a fair test, WAI and self modifying code too.
+static void random_program(uint64_t seed){
+  rng = seed * 0x9E3779B97F4A7C15ULL + 1;
+  for(uint32_t i = 0; i < 0x10000; i += 8){
+    uint64_t r = random64();
+    memcpy(&ref->memory[i], &r, 8);
+  }
+  load(ref);
+  load(opt);
+  uint64_t r = random64();
+  ref->cpu.a = opt->cpu.a = r;
+  ref->cpu.x = opt->cpu.x = r >> 8;
+  ref->cpu.y = opt->cpu.y = r >> 16;
+  ref->cpu.sp = opt->cpu.sp = r >> 24;
+  ref->cpu.status = opt->cpu.status = (r >> 32) | FLAG_CONSTANT;
+}
+
+//-----------------------------------------------------------------------------
+static void save(diff_machine_t *m){
+  m->saved_cpu = m->cpu;
+  memcpy(m->saved_memory, m->memory, 0x10000);
+}
+
+static void restore(diff_machine_t *m){
+  m->cpu = m->saved_cpu;
+  memcpy(m->memory, m->saved_memory, 0x10000);
+}
+
+static void record_step(void){
+  diff_step_t *s = &trace[ntrace++ % DIFF_TRACE];
+  cpu6502_t *c = &ref->cpu;
+  *s = (diff_step_t){ c->instructions, c->pc, ref->memory[c->pc], c->a, c->x, c->y, c->sp,
+                      c->status, c->clockticks6502 };
+}
+
+//-----------------------------------------------------------------------------
+// The engine under test decides how many instructions a budget runs, a
+// superinstruction may take two of a budget of one. The reference then runs
+// just as many. Returns the instructions run.
+static uint32_t step_both(uint32_t budget){
+  ref->nwrites = 0;
+  opt->nwrites = 0;
+  uint32_t before = opt->cpu.instructions;
+  opt->reason = opt->engine->run(&opt->cpu, budget);
+  uint32_t count = opt->cpu.instructions - before;
+  ref->reason = ref->engine->run(&ref->cpu, count ? count : budget);
+  return count;
+}
+
+static int same_writes(void){
+  if(ref->nwrites != opt->nwrites) return 0;
+  uint32_t n = ref->nwrites < ref->capacity ? ref->nwrites : ref->capacity;
+  return memcmp(ref->writes, opt->writes, n * sizeof(diff_write_t)) == 0;
+}
+
+static int same_state(void){
+  cpu6502_t *r = &ref->cpu, *o = &opt->cpu;
+  return r->pc == o->pc && r->a == o->a && r->x == o->x && r->y == o->y && r->sp == o->sp &&
+         r->status == o->status && r->instructions == o->instructions &&
+         r->waiting == o->waiting &&
+#ifndef FAKE6502_FAST
+         r->clockticks6502 == o->clockticks6502 &&
+#endif
+#ifdef FAKE6502_DIRECT_LOW_PAGES
+         memcmp(ref->memory, opt->memory, DIFF_LOW_PAGES) == 0 &&
+#endif
+         same_writes();
+}
+
+//-----------------------------------------------------------------------------
+static void print_writes(const diff_machine_t *m){
+  printf("  writes of %-9s:", m->name);
+  for(uint32_t i = 0; i < m->nwrites && i < m->capacity; i++){
+    printf(" $%04X=$%02X", m->writes[i].address, m->writes[i].value);
+  }
+  printf("%s\n", m->nwrites ? "" : " none");
+}
+
+static void print_field(const char *name, uint32_t r, uint32_t o){
+  if(r != o){
+    printf("  %-12s reference $%02X, %s $%02X\n", name, r, FAKE6502_ENGINE, o);
+  }
+}
+
+static void print_divergence(void){
+  printf("trace of the reference, oldest first:\n");
+  printf("  instruction  pc    op  a  x  y  sp p  ticks\n");
+  uint32_t first = ntrace > DIFF_TRACE ? ntrace - DIFF_TRACE : 0;
+  for(uint32_t i = first; i < ntrace; i++){
+    diff_step_t *s = &trace[i % DIFF_TRACE];
+    printf("  %11u $%04X %02X  %02X %02X %02X %02X %02X %u\n", s->instructions, s->pc,
+           s->opcode, s->a, s->x, s->y, s->sp, s->status, s->ticks);
+  }
+  cpu6502_t *r = &ref->cpu, *o = &opt->cpu;
+  printf("after the last one:\n");
+  print_field("pc", r->pc, o->pc);
+  print_field("a", r->a, o->a);
+  print_field("x", r->x, o->x);
+  print_field("y", r->y, o->y);
+  print_field("sp", r->sp, o->sp);
+  print_field("status", r->status, o->status);
+  print_field("instructions", r->instructions, o->instructions);
+  print_field("waiting", r->waiting, o->waiting);
+#ifndef FAKE6502_FAST
+  print_field("clockticks", r->clockticks6502, o->clockticks6502);
+#endif
+  if(!same_writes()){
+    print_writes(ref);
+    print_writes(opt);
+  }
+#ifdef FAKE6502_DIRECT_LOW_PAGES
+  for(uint32_t i = 0; i < DIFF_LOW_PAGES; i++){
+    if(ref->memory[i] != opt->memory[i]){
+      printf("  memory $%04X reference $%02X, %s $%02X\n", i, ref->memory[i], FAKE6502_ENGINE,
+             opt->memory[i]);
+    }
+  }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Back to the start of the block, then one instruction at a time up to the
+// one that differs
+static void find_divergence(uint32_t block){
+  restore(ref);
+  restore(opt);
+  for(uint32_t done = 0; done < block; ){
+    record_step();
+    uint32_t count = step_both(1);
+    if(!same_state()) break;
+    if(count == 0) break; // Waiting, the block stopped here as well
+    done += count;
+  }
+  print_divergence();
+}
+
+// Interrupt inputs due before the next block, run as a block of their own so
+// the line can drop as soon as the interrupt was taken
+static int inputs(uint64_t done, uint64_t last, uint32_t irq_period, uint32_t nmi_period,
+                  uint32_t *count){
+  int irq = irq_period && done / irq_period != last / irq_period;
+  int nmi = nmi_period && done / nmi_period != last / nmi_period;
+  // A WAI nobody would wake, an NMI always gets through
+  nmi |= ref->cpu.waiting && opt->cpu.waiting;
+  if(!irq && !nmi) return 0;
+  if(irq){
+    ref->engine->irq_assert(&ref->cpu, DIFF_IRQ_SOURCE);
+    opt->engine->irq_assert(&opt->cpu, DIFF_IRQ_SOURCE);
+  }
+  if(nmi){
+    ref->engine->nmi(&ref->cpu);
+    opt->engine->nmi(&opt->cpu);
+  }
+  record_step();
+  *count = step_both(1);
+  ref->engine->irq_deassert(&ref->cpu, DIFF_IRQ_SOURCE);
+  opt->engine->irq_deassert(&opt->cpu, DIFF_IRQ_SOURCE);
+  return 1;
+}
+
+//-----------------------------------------------------------------------------
+// Lockstep run of both machines as they are now. Returns 0 without a
+// difference, and the instructions run.
+static int lockstep(uint64_t limit, uint32_t block, uint32_t irq_period, uint32_t nmi_period,
+                    uint64_t *done){
+  uint64_t last = 0;
+  *done = 0;
+  ntrace = 0;
+  while(*done < limit){
+    uint32_t count;
+    if(inputs(*done, last, irq_period, nmi_period, &count)){
+      last = *done;
+      if(!same_state()){
+        print_divergence();
+        return -1;
+      }
+      *done += count;
+      continue;
+    }
+    last = *done;
+    uint32_t budget = limit - *done < block ? limit - *done : block;
+    if(block > 1){
+      save(ref);
+      save(opt);
+    } else {
+      record_step();
+    }
+    count = step_both(budget);
+    if(!same_state()){
+      if(block > 1){
+        find_divergence(budget);
+      } else {
+        print_divergence();
+      }
+      return -1;
+    }
+    *done += count;
+    if(count == 0 && !(ref->cpu.waiting && opt->cpu.waiting)){
+      printf("both engines stopped without progress at $%04X\n", ref->cpu.pc);
+      return 0;
+    }
+    if(block > 1 && host_run_trapped(&ref->cpu)) return 0;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv){
+  uint32_t load_address = 0x8000;
+  long start_address = -1;
+  uint64_t limit = 0;
+  uint32_t block = DIFF_BLOCK;
+  uint32_t irq_period = 0, nmi_period = 0;
+  int fuzz = 0;
+  uint64_t seed = 0;
+  uint32_t programs = 100;
+  int opt_char;
+  while((opt_char = getopt(argc, argv, "a:s:n:b:i:m:z:N:h")) != -1){
+    switch(opt_char){
+      case 'a': load_address = strtoul(optarg, NULL, 0) & 0xFFFF; break;
+      case 's': start_address = strtoul(optarg, NULL, 0) & 0xFFFF; break;
+      case 'n': limit = strtoull(optarg, NULL, 0); break;
+      case 'b': block = strtoul(optarg, NULL, 0); break;
+      case 'i': irq_period = strtoul(optarg, NULL, 0); break;
+      case 'm': nmi_period = strtoul(optarg, NULL, 0); break;
+      case 'z': fuzz = 1; seed = strtoull(optarg, NULL, 0); break;
+      case 'N': programs = strtoul(optarg, NULL, 0); break;
+      default:
+        usage();
+        return opt_char == 'h' ? 0 : 1;
+    }
+  }
+  if(block == 0 || (fuzz ? optind != argc : optind != argc - 1)){
+    usage();
+    return 1;
+  }
+  ref = new_machine("reference", &reference, block);
+  opt = new_machine(FAKE6502_ENGINE, &engine, block);
+  if(ref == NULL || opt == NULL){
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  printf("reference legacy against %s, blocks of %u instructions\n", FAKE6502_ENGINE, block);
+
+  uint64_t total = 0;
+  double start = host_run_seconds();
+  if(fuzz){
+    if(limit == 0) limit = 100000;
+    for(uint32_t p = 0; p < programs; p++){
+      uint64_t done;
+      random_program(seed + p);
+      int res = lockstep(limit, block, irq_period, nmi_period, &done);
+      total += done;
+      if(res != 0){
+        printf("random program %llu differs after %llu instructions, rerun it with -z %llu -N 1\n",
+               (unsigned long long)(seed + p), (unsigned long long)done,
+               (unsigned long long)(seed + p));
+        return 2;
+      }
+    }
+    printf("%u random programs, ", programs);
+  } else {
+    if(limit == 0) limit = 100000000;
+    uint32_t size;
+    uint8_t *rom = host_run_read_file(argv[optind], &size);
+    if(rom == NULL) return 1;
+    if(size > 0x10000 - load_address){
+      fprintf(stderr, "%s: %u bytes don't fit at $%04X\n", argv[optind], size, load_address);
+      return 1;
+    }
+    memcpy(&ref->memory[load_address], rom, size);
+    free(rom);
+    ref->memory[0xFFFC] = load_address & 0xFF; // Reset vector as fakemem_init() sets it
+    ref->memory[0xFFFD] = load_address >> 8;
+    load(ref);
+    load(opt);
+    if(start_address >= 0){
+      ref->cpu.pc = opt->cpu.pc = start_address;
+    }
+    int res = lockstep(limit, block, irq_period, nmi_period, &total);
+    if(res != 0){
+      printf("%s differs after %llu instructions\n", argv[optind], (unsigned long long)total);
+      return 2;
+    }
+    printf("stopped at $%04X, ", ref->cpu.pc);
+  }
+  double seconds = host_run_seconds() - start;
+  printf("%llu instructions without a difference in %.3f s, %.2f Mips in lockstep\n",
+         (unsigned long long)total, seconds, seconds > 0 ? total / seconds / 1e6 : 0.0);
+  return 0;
+}
@@ -0,0 +1,40 @@
+//-----------------------------------------------------------------------------
+// host_devices.c: Stand-ins for the devices of the board in the host build
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include "fake6522.h"
+#include "fakemem.h"
+
+//-----------------------------------------------------------------------------
+// No pins, an output bit reads back as written and an input bit as 0. Per
+// thread like the memory map when that is.
+static FAKEMEM_STORAGE fake6522_state_t via_state;
+
+//-----------------------------------------------------------------------------
+void fake6522_write(uint16_t addr, uint8_t byte) {
+  switch(addr & 0xFF) {
+    case 0x00: via_state.orb = byte; break;
+    case 0x01: via_state.ora = byte; break;
+    case 0x02: via_state.ddrb = byte; break;
+    case 0x03: via_state.ddra = byte; break;
+  }
+}
+//-----------------------------------------------------------------------------
+uint8_t fake6522_read(uint16_t addr) {
+  switch(addr & 0xFF) {
+    case 0x00: return via_state.orb & via_state.ddrb;
+    case 0x01: return via_state.ora & via_state.ddra;
+    default: return 0;
+  }
+}
+//-----------------------------------------------------------------------------
+void fake6522_set_change_callback(void (*callback)(void)) {
+}
+//-----------------------------------------------------------------------------
+void fake6522_get_state(fake6522_state_t *state) {
+  *state = via_state;
+}
+//-----------------------------------------------------------------------------
+void fake6522_set_state(const fake6522_state_t *state) {
+  via_state = *state;
+}
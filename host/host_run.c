@@ -0,0 +1,106 @@
+//-----------------------------------------------------------------------------
+// host_run.c: Running 6502 programs to completion on the host
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include "host_run.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+//-----------------------------------------------------------------------------
+double host_run_seconds(void){
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//-----------------------------------------------------------------------------
+uint8_t *host_run_read_file(const char *path, uint32_t *size){
+  FILE *f = fopen(path, "rb");
+  if(f == NULL){
+    perror(path);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  long len = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  uint8_t *data = malloc(len > 0 ? len : 1);
+  if(data == NULL || fread(data, 1, len, f) != (size_t)len){
+    fprintf(stderr, "%s: read failed\n", path);
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  *size = len;
+  return data;
+}
+
+//-----------------------------------------------------------------------------
+static uint8_t host_run_read(const cpu6502_t *cpu, uint16_t address){
+  return cpu->bus.read(cpu->bus.ctx, address);
+}
+int host_run_trapped(const cpu6502_t *cpu){
+  static const uint8_t branch_flag[8] = {
+    FLAG_SIGN, FLAG_SIGN, FLAG_OVERFLOW, FLAG_OVERFLOW,
+    FLAG_CARRY, FLAG_CARRY, FLAG_ZERO, FLAG_ZERO
+  };
+  uint16_t pc = cpu->pc;
+  uint8_t opcode = host_run_read(cpu, pc);
+  if(opcode == 0x4C){
+    return (host_run_read(cpu, pc + 1) | (host_run_read(cpu, pc + 2) << 8)) == pc;
+  }
+  if((opcode & 0x1F) == 0x10 && host_run_read(cpu, pc + 1) == 0xFE){
+    // Taken when the flag of the branch is set for odd rows, clear for even
+    uint8_t set = (cpu->status & branch_flag[opcode >> 5]) != 0;
+    return set == ((opcode >> 5) & 1);
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+host_run_stop_t host_run(cpu6502_t *cpu, uint64_t max_instructions, uint64_t max_cycles,
+                         host_run_stats_t *stats){
+  uint32_t last_ticks = cpu->clockticks6502;
+  stats->instructions = 0;
+  stats->cycles = 0;
+  stats->seconds = 0;
+#ifdef FAKE6502_FAST
+  if(max_cycles) return HOST_RUN_NO_CYCLES; // Would never be reached
+#endif
+  while(1){
+    if(max_instructions && stats->instructions >= max_instructions) return HOST_RUN_INSTRUCTIONS;
+    if(max_cycles && stats->cycles >= max_cycles) return HOST_RUN_CYCLES;
+    uint64_t budget = HOST_RUN_SLICE;
+    if(max_instructions && max_instructions - stats->instructions < budget){
+      budget = max_instructions - stats->instructions;
+    }
+    if(max_cycles && (max_cycles - stats->cycles) / 8 < budget){
+      // No instruction takes more than 8 ticks, so this can't overshoot
+      budget = (max_cycles - stats->cycles) / 8 ? (max_cycles - stats->cycles) / 8 : 1;
+    }
+    uint32_t before = cpu->instructions;
+    double start = host_run_seconds();
+    cpu6502_stop_t reason = run6502(cpu, budget);
+    stats->seconds += host_run_seconds() - start;
+    stats->instructions += cpu->instructions - before;
+    stats->cycles += cpu->clockticks6502 - last_ticks;
+    last_ticks = cpu->clockticks6502;
+    if(reason == CPU6502_STOP_BREAKPOINT) return HOST_RUN_BREAKPOINT;
+    if(reason == CPU6502_STOP_WAIT) return HOST_RUN_WAIT;
+    if(host_run_trapped(cpu)) return HOST_RUN_TRAP;
+  }
+}
+
+//-----------------------------------------------------------------------------
+const char *host_run_reason(host_run_stop_t reason){
+  switch(reason){
+    case HOST_RUN_TRAP: return "trap";
+    case HOST_RUN_BREAKPOINT: return "breakpoint";
+    case HOST_RUN_WAIT: return "WAI, no interrupt source";
+    case HOST_RUN_INSTRUCTIONS: return "instruction limit";
+    case HOST_RUN_CYCLES: return "cycle limit";
+    case HOST_RUN_NO_CYCLES: return "cycle limit, but FAKE6502_FAST counts no cycles";
+  }
+  return "?";
+}
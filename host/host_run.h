@@ -0,0 +1,42 @@
+//-----------------------------------------------------------------------------
+// host_run.h: Running 6502 programs to completion on the host
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#ifndef HOST_RUN_H
+#define HOST_RUN_H
+
+#include <stdint.h>
+#include "fake6502.h"
+
+//-----------------------------------------------------------------------------
+// Instructions per run6502() call, the limits are checked in between
+#define HOST_RUN_SLICE 100000
+
+typedef enum {
+  HOST_RUN_TRAP = 0,     // JMP or branch to itself, how test programs end
+  HOST_RUN_BREAKPOINT,
+  HOST_RUN_WAIT,         // WAI with nothing to wake it
+  HOST_RUN_INSTRUCTIONS, // Instruction limit reached
+  HOST_RUN_CYCLES,       // Cycle limit reached
+  HOST_RUN_NO_CYCLES,    // Cycle limit asked of a build that counts none
+} host_run_stop_t;
+
+typedef struct {
+  uint64_t instructions;
+  uint64_t cycles;
+  double seconds;        // Host time spent in run6502()
+} host_run_stats_t;
+
+// Run until a trap, breakpoint or limit, a limit of 0 is none. A
+// FAKE6502_FAST build counts no cycles and runs nothing with a cycle limit.
+host_run_stop_t host_run(cpu6502_t *cpu, uint64_t max_instructions, uint64_t max_cycles,
+                         host_run_stats_t *stats);
+// True when the instruction at pc jumps or branches to itself. Read through
+// the bus of cpu, so code in a bank window is seen as the CPU sees it.
+int host_run_trapped(const cpu6502_t *cpu);
+const char *host_run_reason(host_run_stop_t reason);
+double host_run_seconds(void);
+// Contents of a file in a malloc()ed buffer, NULL after printing an error
+uint8_t *host_run_read_file(const char *path, uint32_t *size);
+
+#endif
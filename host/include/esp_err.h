@@ -0,0 +1,14 @@
+//-----------------------------------------------------------------------------
+// esp_err.h: The part of ESP-IDF's esp_err.h the shared headers use, so the
+// host build can read snapshot.h and friends
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+#endif
@@ -0,0 +1,388 @@
+//-----------------------------------------------------------------------------
+// romrun.c: Headless runner of 6502 binaries on the host build of the core
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fake6502.h"
+#include "fakemem.h"
+#include "fakebank.h"
+#include "fake6522.h"
+#include "replay.h"
+#include "snapshot.h"
+#include "host_run.h"
+
+//-----------------------------------------------------------------------------
+// Log of a run checked with -k
+#define ROMRUN_REPLAY_BYTES (1024 * 1024)
+
+static cpu6502_t cpu;
+static replay_t replay;
+static fakebank_t bank;
+
+//-----------------------------------------------------------------------------
+static void usage(void){
+  fprintf(stderr,
+    "usage: romrun [options] rom.bin\n"
+    "       romrun [-b N] [-x FILE] -r recording.bin\n"
+    "  -a ADDR  load address of the binary (default 0x8000)\n"
+    "  -s ADDR  start address (default: the reset vector)\n"
+    "  -t ADDR  stop when pc reaches ADDR, up to 4 times\n"
+    "  -c N     stop after N cycles\n"
+    "  -n N     stop after N instructions\n"
+    "  -x FILE  extended memory behind the bank windows of the board, checks\n"
+    "           that a switch at $2000 keeps the decoded code at the end\n"
+    "  -k N     record the run, step back N instructions as the stopped board\n"
+    "           does and check that running forward again ends the same\n"
+    "  -r FILE  play a recording saved by 'bitboard6502.py recording'\n"
+    "  -b N     stop N instructions before the end of the recording\n");
+}
+
+//-----------------------------------------------------------------------------
+static void print_state(const char *reason, const host_run_stats_t *stats){
+  printf("stop: %s at $%04X\n", reason, cpu.pc);
+  printf("pc $%04X a $%02X x $%02X y $%02X sp $%02X status $%02X\n",
+         cpu.pc, cpu.a, cpu.x, cpu.y, cpu.sp, cpu.status);
+  printf("instructions %llu\n", (unsigned long long)stats->instructions);
+  printf("cycles %llu\n", (unsigned long long)stats->cycles);
+  printf("time %.6f s\n", stats->seconds);
+  if(stats->seconds > 0){
+    printf("%.2f Mips, %.2f MHz emulated\n", stats->instructions / stats->seconds / 1e6,
+           stats->cycles / stats->seconds / 1e6);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// The bank windows of the board on the extended memory in path
+static int attach_extended(const char *path){
+  static const fakebank_window_t windows[] = FAKEBANK_BOARD_WINDOWS;
+  uint32_t size;
+  uint8_t *memory = host_run_read_file(path, &size);
+  if(memory == NULL) return -1;
+  if(fakebank_init(&bank, &cpu, memory, size, FAKEBANK_BOARD_REGISTERS, windows,
+                   sizeof(windows) / sizeof(windows[0])) != 0){
+    fprintf(stderr, "the bank registers don't fit in the memory map\n");
+    return -1;
+  }
+  return 0;
+}
+
+// Decoded instructions in the cache
+static uint32_t count_decoded(void){
+  uint32_t count = 0;
+  for(uint32_t i = 0; i < FAKE6502_DCACHE_ENTRIES; i++){
+    if(cpu.dcache[i].length != 0) count++;
+  }
+  return count;
+}
+
+// A switch of the window at $2000 changes no cached code, the code decoded
+// by the run has to survive it
+static int check_bank_switch(void){
+  uint32_t before = count_decoded();
+  fakebank_select(&bank, 0, bank.selected[0]);
+  uint32_t after = count_decoded();
+  if(after != before){
+    fprintf(stderr, "switching the $%04X window dropped %u of %u decoded instructions\n",
+            bank.windows[0].start, before - after, before);
+    return 1;
+  }
+  printf("switching the $%04X window kept %u decoded instructions\n",
+         bank.windows[0].start, after);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Stands in for the devices of the board, while a recording plays their
+// reads come from the log
+static uint8_t recorded_read(void *ctx, uint16_t address){
+  return 0xFF;
+}
+
+// fakemem only asks the log for devices that have a read handler, every run
+// of recorded addresses without one here gets a placeholder device
+static int map_recorded_reads(const uint8_t *events, uint32_t size){
+  static uint8_t recorded[0x10000];
+  for(uint32_t offset = 0; offset + sizeof(replay_event_t) <= size; ){
+    replay_event_t e;
+    memcpy(&e, events + offset, sizeof(e));
+    if(e.kind == REPLAY_EVENT_READ){
+      const fakemem_device_t *device = fakemem_device_at(e.address);
+      recorded[e.address] = device == NULL || device->read == NULL;
+    }
+    offset += sizeof(e);
+    if(e.kind == REPLAY_EVENT_WRITE){
+      offset += (e.count + 3) & ~3;
+    }
+  }
+  for(uint32_t start = 0; start < 0x10000; start++){
+    if(!recorded[start]) continue;
+    uint32_t end = start;
+    while(end < 0x10000 && recorded[end]) end++;
+    fakemem_device_t device = { start, end - start, recorded_read, NULL, NULL, NULL, NULL };
+    if(fakemem_add_device(&device) != 0){
+      fprintf(stderr, "reads at $%04X don't fit in the memory map\n", start);
+      return -1;
+    }
+    start = end;
+  }
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// Machine from the checkpoint of a recording, then the log played to its end
+static int run_recording(const char *path, const char *extended, uint32_t back){
+  uint32_t size;
+  uint8_t *data = host_run_read_file(path, &size);
+  if(data == NULL) return 1;
+  snapshot_header_t image;
+  snapshot_machine_t machine;
+  replay_header_t header;
+  uint32_t image_size = sizeof(image) + sizeof(machine) + 0x10000;
+  if(size >= sizeof(image)){
+    memcpy(&image, data, sizeof(image));
+  }
+  if(size < image_size + sizeof(header) || image.magic != SNAPSHOT_MAGIC ||
+     image.version != SNAPSHOT_VERSION || image.size != sizeof(machine) + 0x10000){
+    fprintf(stderr, "%s: not a recording of this snapshot version\n", path);
+    return 1;
+  }
+  memcpy(&machine, data + sizeof(image), sizeof(machine));
+  memcpy(fakemem, data + sizeof(image) + sizeof(machine), 0x10000);
+  fakemem_map_init();
+  if(extended != NULL){
+    if(attach_extended(extended) != 0) return 1;
+    for(int i = 0; i < bank.nwindows; i++){
+      fakebank_select(&bank, i, machine.banks[i]);
+    }
+  } else {
+    for(int i = 0; i < FAKEBANK_MAX_WINDOWS; i++){
+      if(machine.banks[i] != 0){
+        fprintf(stderr, "%s: the checkpoint shows extended memory, give it with -x\n", path);
+        return 1;
+      }
+    }
+  }
+  memcpy(&header, data + image_size, sizeof(header));
+  if(size - image_size - sizeof(header) < header.size){
+    fprintf(stderr, "%s: events cut short\n", path);
+    return 1;
+  }
+
+  cpu.clockticks6502 = machine.clockticks;
+  cpu.clockgoal6502 = machine.clockgoal;
+  cpu.instructions = machine.instructions;
+  cpu.pc = machine.pc;
+  cpu.sp = machine.sp;
+  cpu.a = machine.a;
+  cpu.x = machine.x;
+  cpu.y = machine.y;
+  cpu.status = machine.status;
+  cpu.waiting = machine.waiting;
+  if(machine.nmi){
+    nmi6502(&cpu);
+  }
+  cpu6502_invalidate(&cpu, 0, 0x10000);
+  fake6522_set_state(&machine.via);
+
+  uint8_t *events = malloc(header.size + 4);
+  replay_init(&replay, &cpu, fakemem, events, header.size + 4);
+  if(events == NULL || replay_load(&replay, &header, data + image_size + sizeof(header)) != 0){
+    fprintf(stderr, "%s: bad replay log\n", path);
+    return 1;
+  }
+  if(map_recorded_reads(events, header.size) != 0) return 1;
+  fakemem_replay = &replay;
+  uint32_t length = header.end - header.start;
+  if(back > length){
+    fprintf(stderr, "the recording covers only %u instructions\n", length);
+    return 1;
+  }
+  printf("recording of %u instructions, %u bytes of events\n", length, header.size);
+
+  uint32_t ticks = cpu.clockticks6502;
+  host_run_stats_t stats = { .instructions = length - back };
+  double start = host_run_seconds();
+  int res = replay_play(&replay, header.end - back);
+  stats.seconds = host_run_seconds() - start;
+  stats.cycles = cpu.clockticks6502 - ticks;
+  if(res < 0){
+    fprintf(stderr, "the run didn't follow the log\n");
+    return 1;
+  }
+  if(res > 0){
+    printf("diverged on %d reads\n", res);
+  }
+  print_state(back ? "stepped back" : "end of recording", &stats);
+  free(events);
+  free(data);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+// The machine as it was at a checkpoint, the way snapshot_restore() puts it
+// back, stop requests and interrupt lines stay as they are
+static void restore_machine(const cpu6502_t *saved, const uint8_t *memory,
+                            const fake6522_state_t *via){
+  memcpy(fakemem, memory, 0x10000);
+  cpu.clockticks6502 = saved->clockticks6502;
+  cpu.clockgoal6502 = saved->clockgoal6502;
+  cpu.instructions = saved->instructions;
+  cpu.pc = saved->pc;
+  cpu.sp = saved->sp;
+  cpu.a = saved->a;
+  cpu.x = saved->x;
+  cpu.y = saved->y;
+  cpu.status = saved->status;
+  cpu.waiting = saved->waiting;
+  cpu6502_invalidate(&cpu, 0, 0x10000);
+  fake6522_set_state(via);
+}
+
+// Record the run from a checkpoint, then step back count instructions the
+// way CMD_REPLAY_STEP_BACK does on the stopped board, with the stop request
+// of CMD_STOP_EMU still pending. Running forward again must end where the
+// run stopped.
+static int check_step_back(uint32_t count, uint64_t max_instructions, uint64_t max_cycles){
+  static uint8_t checkpoint[0x10000], stopped[0x10000];
+  static uint32_t events[ROMRUN_REPLAY_BYTES / sizeof(uint32_t)];
+  static cpu6502_t start, end;
+  fake6522_state_t via;
+  start = cpu;
+  fake6522_get_state(&via);
+  memcpy(checkpoint, fakemem, sizeof(checkpoint));
+  replay_init(&replay, &cpu, fakemem, (uint8_t *)events, sizeof(events));
+  fakemem_replay = &replay;
+  replay_record_start(&replay);
+
+  host_run_stats_t stats;
+  host_run_stop_t reason = host_run(&cpu, max_instructions, max_cycles, &stats);
+  print_state(host_run_reason(reason), &stats);
+  end = cpu;
+  memcpy(stopped, fakemem, sizeof(stopped));
+  uint32_t target = cpu.instructions - count;
+  if(count > cpu.instructions - replay.start ||
+     target - replay.start > replay_end(&replay) - replay.start){
+    fprintf(stderr, "the log doesn't reach %u instructions back\n", count);
+    return 1;
+  }
+
+  cpu6502_request_stop(&cpu); // No slice runs to take it
+  replay_close(&replay);
+  uint32_t used = replay.used;
+  restore_machine(&start, checkpoint, &via);
+  int res = replay_play(&replay, target);
+  if(res < 0 || cpu.instructions != target){
+    fprintf(stderr, "step back failed at %u instructions, %u of %u bytes of log left\n",
+            cpu.instructions, replay.used, used);
+    return 1;
+  }
+  while(cpu.instructions != end.instructions){
+    uint32_t before = cpu.instructions;
+    cpu6502_stop_t stop = run6502(&cpu, end.instructions - cpu.instructions);
+    if(cpu.instructions == before && stop == CPU6502_STOP_WAIT){
+      break;
+    }
+  }
+  if(cpu.instructions != end.instructions || cpu.pc != end.pc || cpu.a != end.a ||
+     cpu.x != end.x || cpu.y != end.y || cpu.sp != end.sp || cpu.status != end.status ||
+     cpu.clockticks6502 != end.clockticks6502 || memcmp(fakemem, stopped, sizeof(stopped))){
+    fprintf(stderr, "stepped back %u instructions, forward again ends at $%04X after %u\n",
+            count, cpu.pc, cpu.instructions);
+    return 1;
+  }
+  printf("stepped back %u instructions and forward again to the same state\n", count);
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+int main(int argc, char **argv){
+  uint32_t load_address = 0x8000;
+  long start_address = -1;
+  uint64_t max_cycles = 0, max_instructions = 0;
+  const char *recording = NULL;
+  const char *extended = NULL;
+  uint32_t back = 0;
+  long step_back = -1;
+  uint16_t breakpoints[CPU6502_MAX_BREAKPOINTS];
+  int nbreakpoints = 0;
+
+  int opt;
+  while((opt = getopt(argc, argv, "a:s:t:c:n:r:b:x:k:h")) != -1){
+    switch(opt){
+      case 'a': load_address = strtoul(optarg, NULL, 0) & 0xFFFF; break;
+      case 's': start_address = strtoul(optarg, NULL, 0) & 0xFFFF; break;
+      case 't':
+        if(nbreakpoints == CPU6502_MAX_BREAKPOINTS){
+          fprintf(stderr, "at most %d stop addresses\n", CPU6502_MAX_BREAKPOINTS);
+          return 1;
+        }
+        breakpoints[nbreakpoints++] = strtoul(optarg, NULL, 0);
+      break;
+      case 'c': max_cycles = strtoull(optarg, NULL, 0); break;
+      case 'n': max_instructions = strtoull(optarg, NULL, 0); break;
+      case 'r': recording = optarg; break;
+      case 'b': back = strtoul(optarg, NULL, 0); break;
+      case 'x': extended = optarg; break;
+      case 'k': step_back = strtoul(optarg, NULL, 0); break;
+      default:
+        usage();
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+
+#ifdef FAKE6502_FAST
+  if(max_cycles){
+    fprintf(stderr, "-c: a FAKE6502_FAST build counts no cycles\n");
+    return 1;
+  }
+#endif
+  cpu6502_bus_t bus = { NULL, fakemem_read, fakemem_write, fakemem };
+  cpu6502_init(&cpu, &bus);
+  if(recording != NULL){
+    return run_recording(recording, extended, back);
+  }
+  if(optind != argc - 1){
+    usage();
+    return 1;
+  }
+
+  uint32_t size;
+  uint8_t *rom = host_run_read_file(argv[optind], &size);
+  if(rom == NULL) return 1;
+  if(size > 0x10000 - load_address){
+    fprintf(stderr, "%s: %u bytes don't fit at $%04X\n", argv[optind], size, load_address);
+    return 1;
+  }
+  // Same start as the board: empty memory with the reset vector at the
+  // program, unless the binary brings its own vectors
+  fakemem_init(load_address);
+  memcpy(&fakemem[load_address], rom, size);
+  free(rom);
+  if(extended != NULL && attach_extended(extended) != 0){
+    return 1;
+  }
+  reset6502(&cpu);
+  if(start_address >= 0){
+    cpu.pc = start_address;
+  }
+  for(int i = 0; i < nbreakpoints; i++){
+    cpu6502_set_breakpoint(&cpu, breakpoints[i]);
+  }
+  cpu.idledetect = 1; // Ends the run at a trap right away
+  if(step_back >= 0){
+    return check_step_back(step_back, max_instructions, max_cycles);
+  }
+
+  host_run_stats_t stats;
+  host_run_stop_t reason = host_run(&cpu, max_instructions, max_cycles, &stats);
+  print_state(host_run_reason(reason), &stats);
+  if(extended != NULL){
+    return check_bank_switch();
+  }
+  return 0;
+}
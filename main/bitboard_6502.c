@@ -1,18 +1,29 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_sntp.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
 #include "driver/gpio.h"
 
+#include "bitboard_6502.h"
 #include "fake6502.h"
 #include "fakemem.h"
+#include "fakebank.h"
+#include "fake6522.h"
 #include "info_display.h"
 #include "command_handler.h"
+#include "pc_sampler.h"
+#include "snapshot.h"
+#include "replay.h"
 #include "p_slip.h"
 
 //-----------------------------------------------------------------------------
@@ -20,17 +31,76 @@
 // Memory map
 // 0x0000 - 0x00FF: Zero Page
 // 0x0100 - 0x01FF: Stack
-// 0x6000 - 0x6FFF: 6522 Peripheral (Fake 6522)
-// 0x7000 - 0x70FF: Callable Memory (Custom emulator functions)
+// 0x2000 - 0x2FFF: Bank window 0, 4 KiB
+// 0x3000 - 0x3FFF: Bank window 1, 4 KiB
+// 0x6000 - 0x60FF: 6522 Peripheral (Fake 6522)
 // 0x8000 - 0xFFFF: ROM
+// 0xA000 - 0xDFFF: Bank window 2, 16 KiB
+// 0xF000 - 0xF0FF: Custom emulator functions, devices of fakemem
 
 // Custom Emulator Functions
-// 0x7000 : -w : led
-// 0x7001 : -w : Delay 
+// 0xF000 : -w : led
+// 0xF001 : -w : Delay 
+// 0xF010 - 0xF012 : rw : Block shown in bank window 0 - 2, 0 for the RAM
+
+// Extended memory
+// The bank windows show blocks of PSRAM, or of internal RAM without it, in
+// place of their RAM. Only the RAM is part of snapshots and recordings.
+
+// Interrupts
+// IRQ : GPIO 13 button, asserted while held
+
+// Boot
+// A snapshot saved with SNAPSHOT_FLAG_BOOT is resumed instead of a reset
+
+// Replay
+// A recording logs the inputs from a checkpoint in the replay partition. When
+// the log is nearly full a new checkpoint is taken and the log restarts, the
+// emulation pauses for the flash write meanwhile.
 
 //-----------------------------------------------------------------------------
 const uint16_t EXEC_START = 0x8000;
+// Instructions executed per run6502() call of the main loop
+#define EXEC_SLICE_INSTRUCTIONS 20000
+// The main loop gives up the core at least this often
+#define EXEC_YIELD_MS 1000
+// Longest sleep in an idle 6502 loop, inputs that can't wake us are polled
+#define EXEC_IDLE_MAX_MS 10
+// Nominal 6502 clock used to credit the cycles slept away in an idle loop
+#define EXEC_IDLE_CLOCK_HZ 1000000
+// Input log of a replay recording, a new checkpoint is taken past the limit
+#define EMU_REPLAY_BYTES (16 * 1024)
+#define EMU_REPLAY_LIMIT (EMU_REPLAY_BYTES / 4 * 3)
+// Extended memory behind the bank windows, the smaller one when there is no
+// PSRAM
+#define EMU_BANK_PSRAM_BYTES (2 * 1024 * 1024)
+#define EMU_BANK_SRAM_BYTES (64 * 1024)
+static const fakebank_window_t emu_bank_windows[] = FAKEBANK_BOARD_WINDOWS;
+fakebank_t emu_bank;
 uint8_t fake6502_running_status;
+cpu6502_t cpu6502;
+static TaskHandle_t emu_task_handle;
+static SemaphoreHandle_t emu_call_lock; // One emu_call() at a time
+static esp_err_t (*volatile emu_call_fn)(void *arg);
+static void *emu_call_arg;
+static esp_err_t emu_call_result;
+static uint32_t emu_replay_buffer[EMU_REPLAY_BYTES / sizeof(uint32_t)];
+static volatile uint8_t emu_replay_hold;
+replay_t emu_replay;
+volatile uint8_t emu_perf_log;
+uint8_t io_led_state;
+#ifdef FAKE6502_PROFILE
+static cpu6502_profile_t cpu6502_profile; // Read out by CMD_GET_PROFILE
+#endif
+#ifdef FAKE6502_CALLGRAPH
+static cpu6502_callgraph_t cpu6502_callgraph; // Read out by CMD_GET_CALLGRAPH
+#endif
+#ifdef FAKE6502_TRACE
+// Ring of the last instructions, about 4 bytes each, read by CMD_GET_TRACE
+#define EMU_TRACE_BYTES (64 * CPU6502_TRACE_CHUNK)
+static uint8_t cpu6502_trace_buffer[EMU_TRACE_BYTES];
+static cpu6502_trace_t cpu6502_trace = { cpu6502_trace_buffer, EMU_TRACE_BYTES };
+#endif
 
 //-----------------------------------------------------------------------------
 void io_init(){
@@ -48,13 +118,31 @@ void io_init(){
 
 }
 //-----------------------------------------------------------------------------
+static esp_err_t emu_reset_call(void *arg) {
+  replay_stop(&emu_replay); // A reset isn't logged, the recording ends
+  reset6502(&cpu6502); // Reset the CPU state
+  cpu6502.status = FLAG_CONSTANT;
+  return ESP_OK;
+}
 void io_task(void *pvParameters) {
+  int button_irq = 0;
   while(1) {
+    // Drive the IRQ line from the GPIO 13 button, stepping back only plays
+    // the logged interrupts
+    int button = gpio_get_level(GPIO_NUM_13);
+    if(button != button_irq && emu_replay.mode != REPLAY_PLAY) {
+      if(button) {
+        cpu6502_irq_assert(&cpu6502, IRQ_SOURCE_BUTTON);
+        emu_wake();
+      } else {
+        cpu6502_irq_deassert(&cpu6502, IRQ_SOURCE_BUTTON);
+      }
+      button_irq = button;
+    }
     // Check if GPIO 0 button is pressed
     if(!gpio_get_level(GPIO_NUM_0)) {
       //printf("Resetting 6502 CPU...\n");
-      reset6502(); // Reset the CPU state
-      *fake6502_status = FLAG_CONSTANT;
+      emu_call(emu_reset_call, NULL); // Between slices, a slice writes its registers back
       while(!gpio_get_level(GPIO_NUM_0)){
         vTaskDelay(pdMS_TO_TICKS(250)); 
       }
@@ -63,7 +151,8 @@ void io_task(void *pvParameters) {
   }
 }
 //-----------------------------------------------------------------------------
-void io_write(uint16_t addr, uint8_t byte) {
+void io_write(void *ctx, uint16_t addr, uint8_t byte) {
+  io_led_state = byte;
   // Handle IO write operations
   if(byte == 0x01) {
     gpio_set_level(GPIO_NUM_45, 1); // Set GPIO 45 high
@@ -71,37 +160,274 @@ void io_write(uint16_t addr, uint8_t byte) {
     gpio_set_level(GPIO_NUM_45, 0); // Set GPIO 45 low
   }
 }
-void delay_write(uint16_t addr, uint8_t byte){
+static void delay_write(void *ctx, uint16_t addr, uint8_t byte){
+  if(emu_replay.mode == REPLAY_PLAY) return; // Only timing, nothing to repeat
   vTaskDelay(pdMS_TO_TICKS(byte));
 }
 
+//-----------------------------------------------------------------------------
+void emu_wake(void) {
+  if(emu_task_handle) xTaskNotifyGive(emu_task_handle);
+}
+static void IRAM_ATTR emu_wake_from_isr(void) {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(emu_task_handle, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+esp_err_t emu_call(esp_err_t (*fn)(void *arg), void *arg) {
+  xSemaphoreTake(emu_call_lock, portMAX_DELAY);
+  emu_call_arg = arg;
+  emu_call_fn = fn;
+  emu_wake(); // The main loop may sleep in WAI or an idle loop
+  while(emu_call_fn != NULL) {
+    vTaskDelay(1);
+  }
+  esp_err_t res = emu_call_result;
+  xSemaphoreGive(emu_call_lock);
+  return res;
+}
+
+//-----------------------------------------------------------------------------
+static esp_err_t emu_snapshot_save(void *arg) {
+  return snapshot_save(SNAPSHOT_PARTITION, &cpu6502, *(uint16_t *)arg);
+}
+static esp_err_t emu_snapshot_restore(void *arg) {
+  replay_stop(&emu_replay); // The log doesn't lead to the restored state
+  return snapshot_restore(SNAPSHOT_PARTITION, &cpu6502, 0);
+}
+esp_err_t emu_snapshot(uint8_t op, uint16_t flags) {
+  return emu_call(op == EMU_SNAPSHOT_SAVE ? emu_snapshot_save : emu_snapshot_restore, &flags);
+}
+
+//-----------------------------------------------------------------------------
+static esp_err_t emu_set_breakpoint_call(void *arg) {
+  return cpu6502_set_breakpoint(&cpu6502, *(uint16_t *)arg) == 0 ? ESP_OK : ESP_ERR_NO_MEM;
+}
+esp_err_t emu_set_breakpoint(uint16_t address) {
+  return emu_call(emu_set_breakpoint_call, &address);
+}
+static esp_err_t emu_clear_breakpoints_call(void *arg) {
+  cpu6502_clear_breakpoints(&cpu6502);
+  return ESP_OK;
+}
+esp_err_t emu_clear_breakpoints(void) {
+  return emu_call(emu_clear_breakpoints_call, NULL);
+}
+typedef struct {
+  void *counters;
+  uint32_t size;
+} emu_clear_counters_t;
+static esp_err_t emu_clear_counters_call(void *arg) {
+  emu_clear_counters_t *clear = arg;
+  memset(clear->counters, 0, clear->size);
+  return ESP_OK;
+}
+esp_err_t emu_clear_counters(void *counters, uint32_t size) {
+  emu_clear_counters_t clear = { counters, size };
+  return emu_call(emu_clear_counters_call, &clear);
+}
+static esp_err_t emu_freeze_trace_call(void *arg) {
+  ((cpu6502_trace_t *)arg)->frozen = 1;
+  return ESP_OK;
+}
+esp_err_t emu_freeze_trace(cpu6502_trace_t *trace) {
+  return emu_call(emu_freeze_trace_call, trace);
+}
+
+//-----------------------------------------------------------------------------
+typedef struct {
+  uint16_t address;
+  const uint8_t *data;
+  uint32_t len;
+} emu_host_write_t;
+static esp_err_t emu_host_write_call(void *arg) {
+  emu_host_write_t *write = arg;
+  replay_host_write(&emu_replay, write->address, write->data, write->len);
+  return ESP_OK;
+}
+esp_err_t emu_host_write(uint16_t address, const uint8_t *data, uint32_t len) {
+  emu_host_write_t write = { address, data, len };
+  return emu_call(emu_host_write_call, &write);
+}
+
+//-----------------------------------------------------------------------------
+typedef struct {
+  uint32_t offset;
+  const uint8_t *data;
+  uint32_t len;
+} emu_bank_write_t;
+static esp_err_t emu_bank_write_call(void *arg) {
+  emu_bank_write_t *write = arg;
+  return fakebank_write(&emu_bank, write->offset, write->data, write->len) == 0 ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+esp_err_t emu_bank_write(uint32_t offset, const uint8_t *data, uint32_t len) {
+  emu_bank_write_t write = { offset, data, len };
+  return emu_call(emu_bank_write_call, &write);
+}
+
+//-----------------------------------------------------------------------------
+// Start the log at a new checkpoint of the machine
+static esp_err_t emu_replay_checkpoint(void *arg) {
+  esp_err_t res = snapshot_save(SNAPSHOT_CHECKPOINT_PARTITION, &cpu6502, 0);
+  if(res == ESP_OK) {
+    replay_record_start(&emu_replay);
+  } else {
+    replay_stop(&emu_replay);
+  }
+  return res;
+}
+static esp_err_t emu_replay_stop(void *arg) {
+  replay_stop(&emu_replay);
+  return ESP_OK;
+}
+esp_err_t emu_record(uint8_t start) {
+  return emu_call(start ? emu_replay_checkpoint : emu_replay_stop, NULL);
+}
+
+static void log_replay_diverged(int reads) {
+  char text[48];
+  sprintf(text, "Replay diverged on %d reads\n", reads);
+  serial_send_slip_byte(CMD_LOG);
+  serial_send_slip_bytes((uint8_t *)text, strlen(text));
+  serial_send_slip_end();
+}
+static esp_err_t emu_step_back_call(void *arg) {
+  uint32_t count = *(uint32_t *)arg;
+  uint32_t target = cpu6502.instructions - count;
+  if(emu_replay.mode != REPLAY_RECORD) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if(count > cpu6502.instructions - emu_replay.start ||
+     target - emu_replay.start > replay_end(&emu_replay) - emu_replay.start) {
+    return ESP_ERR_INVALID_ARG; // Before the checkpoint or past a full log
+  }
+  replay_close(&emu_replay);
+  esp_err_t res = snapshot_restore(SNAPSHOT_CHECKPOINT_PARTITION, &cpu6502, 0);
+  if(res != ESP_OK) {
+    replay_stop(&emu_replay);
+    return res;
+  }
+  fake6502_running_status = 1; // Stay where we stepped back to
+  int diverged = replay_play(&emu_replay, target);
+  if(diverged < 0) {
+    return ESP_FAIL;
+  }
+  if(diverged > 0) {
+    log_replay_diverged(diverged);
+  }
+  return ESP_OK;
+}
+esp_err_t emu_step_back(uint32_t count) {
+  return emu_call(emu_step_back_call, &count);
+}
+
+//-----------------------------------------------------------------------------
+static esp_err_t emu_replay_header_call(void *arg) {
+  replay_get_header(&emu_replay, arg);
+  return ESP_OK;
+}
+esp_err_t emu_replay_hold_log(replay_header_t *header) {
+  emu_replay_hold = 1;
+  return emu_call(emu_replay_header_call, header);
+}
+void emu_replay_release_log(void) {
+  emu_replay_hold = 0;
+}
+
 //-----------------------------------------------------------------------------
 void log_perf_task(void *pvParameters) {
-  static uint32_t old_instructions = 0;
+  uint32_t old_instructions = cpu6502.instructions;
+  uint32_t old_ticks = cpu6502.clockticks6502;
+  int64_t old_time = esp_timer_get_time();
   while(1) {
-    // Log performance metrics every second
-    char text[32];
-    sprintf(text, "6502 CPU Speed: %dKips\n", 
-                (int)((instructions - old_instructions)/1000));
+    vTaskDelay(pdMS_TO_TICKS(1000)); // Log every second
+    // Same metrics and keys as host/benchrun, one JSON object per line
+    int64_t now = esp_timer_get_time();
+    uint32_t instructions = cpu6502.instructions - old_instructions;
+    uint32_t ticks = cpu6502.clockticks6502 - old_ticks;
+    double seconds = (now - old_time) / 1e6;
+    old_instructions += instructions;
+    old_ticks += ticks;
+    old_time = now;
+    if(!emu_perf_log || instructions == 0) continue; // Off or stopped
+    char text[160];
+    snprintf(text, sizeof(text), "{\"engine\": \"%s\", \"instructions_per_second\": %.0f, "
+             "\"cycles_per_second\": %.0f, \"ns_per_instruction\": %.1f}\n",
+             FAKE6502_ENGINE, instructions / seconds, ticks / seconds, seconds * 1e9 / instructions);
     serial_send_slip_byte(CMD_LOG);
     serial_send_slip_bytes((uint8_t *)text, strlen(text)); // Send log message
     serial_send_slip_end();
-    old_instructions = instructions; // Update old instruction count
-    vTaskDelay(pdMS_TO_TICKS(1000)); // Log every second
   }
 }
 //-----------------------------------------------------------------------------
+static void log_map_error(const char *what, uint16_t address) {
+  char text[64];
+  snprintf(text, sizeof(text), "No room for the %s at $%04X\n", what, address);
+  serial_send_slip_byte(CMD_LOG);
+  serial_send_slip_bytes((uint8_t *)text, strlen(text));
+  serial_send_slip_end();
+}
+//-----------------------------------------------------------------------------
+static void log_breakpoint(uint16_t address) {
+  char text[32];
+  sprintf(text, "Breakpoint at $%04X\n", address);
+  serial_send_slip_byte(CMD_LOG);
+  serial_send_slip_bytes((uint8_t *)text, strlen(text));
+  serial_send_slip_end();
+}
+//-----------------------------------------------------------------------------
 void app_main(void)
 {
   // Initialize Everything
   serial_init(); // Initialize serial communication
   command_init(); // Initialize command handler
   io_init(); // Initialize IO for buttons and LEDs
-  fakemem_init(EXEC_START); // Initialize fake memory
+  cpu6502_bus_t bus = { NULL, fakemem_read, fakemem_write, fakemem };
+  cpu6502_init(&cpu6502, &bus); // Attach the CPU to the memory map
+  cpu6502.idledetect = 1; // Sleep instead of spinning in idle loops
+#ifdef FAKE6502_PROFILE
+  cpu6502.profile = &cpu6502_profile; // Count per opcode and addressing mode
+#endif
+#ifdef FAKE6502_CALLGRAPH
+  cpu6502.callgraph = &cpu6502_callgraph; // Count calls and ticks per routine
+#endif
+#ifdef FAKE6502_TRACE
+  cpu6502.trace = &cpu6502_trace; // Record the last instructions
+#endif
+  emu_task_handle = xTaskGetCurrentTaskHandle();
+  emu_call_lock = xSemaphoreCreateMutex();
+  fake6522_set_change_callback(&emu_wake_from_isr); // Port inputs end idle loops
+  pc_sampler_init(&cpu6502); // Statistical PC profile, read by CMD_GET_PC_SAMPLES
+  replay_init(&emu_replay, &cpu6502, fakemem, (uint8_t *)emu_replay_buffer, EMU_REPLAY_BYTES);
+  fakemem_replay = &emu_replay; // Device reads are inputs of a recording
 
-  //  Set up callable memory for IO operations
-  fakemem_set_callable_write(0, &io_write);
-  fakemem_set_callable_write(1, &delay_write);
+  //  Set up the emulator functions, a resumed snapshot brings the memory but
+  //  not the map
+  static const fakemem_device_t io_devices[] = {
+    { IO_LED_ADDRESS, 1, NULL, io_write, NULL, NULL, NULL },
+    { IO_DELAY_ADDRESS, 1, NULL, delay_write, NULL, NULL, NULL },
+  };
+  fakemem_map_init();
+  for(int i = 0; i < sizeof(io_devices) / sizeof(io_devices[0]); i++) {
+    if(fakemem_add_device(&io_devices[i]) != 0) {
+      log_map_error("emulator function", io_devices[i].start);
+    }
+  }
+  uint32_t bank_size = EMU_BANK_PSRAM_BYTES;
+  uint8_t *bank_memory = heap_caps_malloc(bank_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if(bank_memory == NULL) {
+    bank_size = EMU_BANK_SRAM_BYTES;
+    bank_memory = heap_caps_malloc(bank_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  }
+  if(fakebank_init(&emu_bank, &cpu6502, bank_memory, bank_memory != NULL ? bank_size : 0, FAKEBANK_BOARD_REGISTERS,
+                   emu_bank_windows, sizeof(emu_bank_windows) / sizeof(emu_bank_windows[0])) != 0) {
+    log_map_error("bank registers", FAKEBANK_BOARD_REGISTERS);
+  }
+  // Resume the boot snapshot if there is one, else start at the reset vector
+  uint8_t resumed = snapshot_restore(SNAPSHOT_PARTITION, &cpu6502, SNAPSHOT_FLAG_BOOT) == ESP_OK;
+  if(!resumed) {
+    fakemem_init(EXEC_START); // Initialize fake memory
+  }
   //printf("Program loaded into memory at address %04X\n", EXEC_START);
   idisplay_init(); // Initialize the display 
 
@@ -124,6 +450,15 @@ void app_main(void)
     NULL, // Task handle
     1 // Core ID (0 for core 0)
   );
+  xTaskCreatePinnedToCore(
+    (TaskFunction_t)log_perf_task, // Task function
+    "log_perf_task", // Task name
+    3072, // Stack size
+    NULL, // Task parameters
+    1, // Priority
+    NULL, // Task handle
+    1 // Core ID (0 for core 0)
+  );
   xTaskCreatePinnedToCore(
     (TaskFunction_t)serial_task, // Task function
     "serial_task", // Task name
@@ -135,25 +470,72 @@ void app_main(void)
   );
 
   // Reset the 6502 CPU before starting execution
-  reset6502(); 
+  if(!resumed) {
+    reset6502(&cpu6502); 
+  }
   // ----- MAIN LOOP -----
-  static time_t last_vtask_delay = 0;
+  TickType_t last_yield = xTaskGetTickCount();
   while(1) {
+    if(emu_call_fn != NULL) {
+      // Between slices cpu6502 holds the complete CPU state
+      emu_call_result = emu_call_fn(emu_call_arg);
+      emu_call_fn = NULL;
+    }
+    // Log full, start over from here. Only once the CPU runs again, a log
+    // that a failed step back left closed can be played again meanwhile.
+    if(emu_replay.mode == REPLAY_RECORD && !emu_replay_hold && fake6502_running_status != 1 &&
+       (emu_replay.closed || emu_replay.used > EMU_REPLAY_LIMIT)) {
+      emu_replay_checkpoint(NULL);
+    }
     if(fake6502_running_status == 1) {
+      cpu6502_cancel_stop(&cpu6502); // Stopped already, it would end the next step
       vTaskDelay(1); 
       continue; // Skip execution if break flag is set
     }
+    uint32_t budget = EXEC_SLICE_INSTRUCTIONS;
     if(fake6502_running_status == 2)
     {
+      budget = 1; // Single step
+      fake6502_running_status = 1;
+    }
+    // The display wants to see a memory access, run one instruction on the
+    // latching bus so the rest of the time pays nothing for it
+    uint8_t latch = fakemem_access_request;
+    if(latch) {
+      budget = 1;
+      cpu6502.bus.read = fakemem_read_latched;
+      cpu6502.bus.write = fakemem_write_latched;
+    }
+    cpu6502_stop_t reason = run6502(&cpu6502, budget);
+    if(latch) {
+      cpu6502.bus.read = fakemem_read;
+      cpu6502.bus.write = fakemem_write;
+      fakemem_access_request = 0;
+    }
+    if(reason == CPU6502_STOP_BREAKPOINT) {
       fake6502_running_status = 1;
+      log_breakpoint(cpu6502.pc);
+    } else if(reason == CPU6502_STOP_WAIT) {
+      // Nothing to run until an interrupt arrives
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(EXEC_IDLE_MAX_MS));
+      last_yield = xTaskGetTickCount();
+      continue;
+    } else if(reason == CPU6502_STOP_IDLE) {
+      // Sleep until a port change or host command, then credit the cycles
+      // the loop would have spun for meanwhile
+      int64_t idle_start = esp_timer_get_time();
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(EXEC_IDLE_MAX_MS));
+      int64_t idle_us = esp_timer_get_time() - idle_start;
+      uint32_t ticks = cpu6502.clockticks6502;
+      cpu6502_skip_idle(&cpu6502, (uint32_t)(idle_us * EXEC_IDLE_CLOCK_HZ / 1000000));
+      replay_record_skip(&emu_replay, cpu6502.clockticks6502 - ticks);
+      last_yield = xTaskGetTickCount();
+      continue;
     }
-    step6502();
-    time_t now;
-    time(&now); // Get current time
-    if(now - last_vtask_delay > 1000) {
-      // Log performance every second
-      time(&last_vtask_delay); // Get current time
+    // Yield between slices so the other tasks on this core get to run
+    if(xTaskGetTickCount() - last_yield >= pdMS_TO_TICKS(EXEC_YIELD_MS)) {
       vTaskDelay(1); 
+      last_yield = xTaskGetTickCount();
     }
   }
 }
@@ -0,0 +1,79 @@
+//-----------------------------------------------------------------------------
+// bitboard_6502.h: Machine instance shared by the firmware tasks
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#ifndef BITBOARD_6502_H
+#define BITBOARD_6502_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "fake6502.h"
+#include "replay.h"
+#include "fakebank.h"
+
+//-----------------------------------------------------------------------------
+// The emulated CPU driven by app_main
+extern cpu6502_t cpu6502;
+// 0: running, 1: stopped, 2: step
+extern uint8_t fake6502_running_status;
+
+// IRQ sources of the board, see cpu6502_irq_assert()
+#define IRQ_SOURCE_BUTTON CPU6502_IRQ_SOURCE(0) // GPIO 13 button, held = asserted
+
+// Wake the main loop when it sleeps in WAI or an idle 6502 loop, call after
+// raising an interrupt line
+void emu_wake(void);
+
+// Run fn on the main loop between two slices, where cpu6502 holds the
+// complete machine state, and wait for its result. Any task may call it,
+// the calls take turns.
+esp_err_t emu_call(esp_err_t (*fn)(void *arg), void *arg);
+
+// Snapshot operations, flags are SNAPSHOT_FLAG_* bits for a save
+#define EMU_SNAPSHOT_SAVE 1
+#define EMU_SNAPSHOT_RESTORE 2
+esp_err_t emu_snapshot(uint8_t op, uint16_t flags);
+
+// Breakpoints and the profile counters of cpu6502 changed between two slices,
+// the running CPU reads them. ESP_ERR_NO_MEM when the breakpoint table is full.
+esp_err_t emu_set_breakpoint(uint16_t address);
+esp_err_t emu_clear_breakpoints(void);
+esp_err_t emu_clear_counters(void *counters, uint32_t size);
+// Pause the instruction trace between two slices, so no record is half
+// written while the host reads it
+esp_err_t emu_freeze_trace(cpu6502_trace_t *trace);
+
+// Memory written by the host, between two slices so a recording logs it at
+// an exact instruction
+esp_err_t emu_host_write(uint16_t address, const uint8_t *data, uint32_t len);
+
+// Replay recording of the machine inputs, see replay.h
+extern replay_t emu_replay;
+// Start recording from a new checkpoint, or stop
+esp_err_t emu_record(uint8_t start);
+// Take the stopped machine back count instructions by playing the log from
+// the checkpoint, recording goes on from there
+esp_err_t emu_step_back(uint32_t count);
+// Header of the log for a download, no new checkpoint is taken until the
+// log is released again
+esp_err_t emu_replay_hold_log(replay_header_t *header);
+void emu_replay_release_log(void);
+
+// Extended memory behind the bank windows, the selected blocks are part of
+// a snapshot
+extern fakebank_t emu_bank;
+// Load the extended memory behind the bank windows, between two slices
+esp_err_t emu_bank_write(uint32_t offset, const uint8_t *data, uint32_t len);
+
+// Set to have log_perf_task report the emulation speed every second
+extern volatile uint8_t emu_perf_log;
+
+// Emulator functions on the bus, see the memory map in bitboard_6502.c
+#define IO_LED_ADDRESS 0xF000
+#define IO_DELAY_ADDRESS 0xF001
+
+// LED at IO_LED_ADDRESS, its last written value is part of a snapshot
+extern uint8_t io_led_state;
+void io_write(void *ctx, uint16_t addr, uint8_t byte);
+
+#endif
@@ -8,9 +8,13 @@
 
 #include "esp_log.h"
 #include "esp_err.h"
+#include "bitboard_6502.h"
 #include "fake6502.h"
 #include "fakemem.h"
 #include "info_display.h"
+#include "pc_sampler.h"
+#include "symbols.h"
+#include "snapshot.h"
 #include "driver/uart.h"
 
 #define SLIP_IMPLEMENTATION
@@ -26,12 +30,41 @@ void command_init(){
 void command_task(){
 }
 
+//-----------------------------------------------------------------------------
+// Bytes of the saved image in a snapshot partition
+static esp_err_t snapshot_image_size(const char *partition, uint32_t *size){
+  snapshot_header_t header;
+  esp_err_t res = snapshot_read(partition, 0, &header, sizeof(header));
+  if(res == ESP_OK && header.magic != SNAPSHOT_MAGIC){
+    res = ESP_ERR_NOT_FOUND;
+  }
+  *size = sizeof(header) + header.size;
+  if(*size > SNAPSHOT_IMAGE_SIZE){
+    *size = SNAPSHOT_IMAGE_SIZE; // Image of another version, send what fits
+  }
+  return res;
+}
+
+// Send size bytes of the image as part of the packet being sent
+static esp_err_t send_snapshot_image(const char *partition, uint32_t size){
+  esp_err_t res = ESP_OK;
+  for(uint32_t offset = 0; offset < size && res == ESP_OK; ){
+    uint8_t chunk[256];
+    uint32_t chunk_len = (size - offset < sizeof(chunk)) ? size - offset : sizeof(chunk);
+    res = snapshot_read(partition, offset, chunk, chunk_len);
+    serial_send_slip_bytes(chunk, chunk_len);
+    offset += chunk_len;
+  }
+  return res;
+}
+
 //-----------------------------------------------------------------------------
 void command_parse(uint8_t *msg_data, uint32_t len){
   CMD_PACKET_TYPE_E cmd = (CMD_PACKET_TYPE_E)msg_data[0];
   uint8_t *data = msg_data + 1; 
   len -= 1;
   esp_err_t res = ESP_OK;
+  uint32_t size;
   switch(cmd){
     case CMD_NONE:
     case CMD_RSP_ERROR:
@@ -45,8 +78,7 @@ void command_parse(uint8_t *msg_data, uint32_t len){
         res = ESP_ERR_INVALID_SIZE;
       } else {
         uint16_t addr = (data[0] | (data[1] << 8));
-        memcpy(&fakemem[addr], data + 2, len - 2);
-        res = ESP_OK;
+        res = emu_host_write(addr, data + 2, len - 2); // Also drops stale decoded code
         //serial_send_slip_byte(CMD_LOG);
         //uint8_t text[64];
         //sprintf((char *)text, "Wrote %d bytes to address %04X\n", (int)(len - 2), addr);
@@ -61,6 +93,9 @@ void command_parse(uint8_t *msg_data, uint32_t len){
     }break;
     case CMD_STOP_EMU:
     {
+      // End the current slice early, the main loop drops the request once it
+      // sees the stopped state
+      cpu6502_request_stop(&cpu6502);
       fake6502_running_status = 1; // Set running status to 0
     }break;
     case CMD_STEP_EMU:
@@ -69,11 +104,241 @@ void command_parse(uint8_t *msg_data, uint32_t len){
     }break;
     case CMD_GET_INST_COUNT:
     {
-      uint32_t inst_count = instructions; // Get the current instruction count
+      uint32_t inst_count = cpu6502.instructions; // Get the current instruction count
       serial_send_slip_byte(CMD_GET_INST_COUNT); // Send log command
       serial_send_slip_bytes((uint8_t *)&inst_count, sizeof(inst_count)); // Send instruction count
       serial_send_slip_end(); // End the SLIP message
     }break;
+    case CMD_SET_BREAKPOINT:
+    {
+      if(len < 2){
+        res = ESP_ERR_INVALID_SIZE;
+      } else {
+        res = emu_set_breakpoint(data[0] | (data[1] << 8)); // ESP_ERR_NO_MEM when full
+      }
+    }break;
+    case CMD_CLEAR_BREAKPOINTS:
+    {
+      res = emu_clear_breakpoints();
+    }break;
+    case CMD_GET_FUSION_COUNTS:
+    {
+      // One uint32_t per superinstruction, in cpu6502_fusion_t order
+      serial_send_slip_byte(CMD_GET_FUSION_COUNTS);
+      serial_send_slip_bytes((uint8_t *)&cpu6502.fusions[CPU6502_FUSE_NONE + 1],
+                             (CPU6502_FUSE_COUNT - 1) * sizeof(uint32_t));
+      serial_send_slip_end();
+    }break;
+    case CMD_GET_PROFILE:
+    {
+      // Only a FAKE6502_PROFILE build attaches counters
+      cpu6502_profile_t *profile = cpu6502.profile;
+      if(profile == NULL){
+        res = ESP_ERR_NOT_SUPPORTED;
+        break;
+      }
+      // Mode count, every mode entry, then the executed opcodes as
+      // (opcode, entry) records. A first data byte of 1 clears the counters.
+      serial_send_slip_byte(CMD_GET_PROFILE);
+      serial_send_slip_byte(CPU6502_MODE_COUNT);
+      serial_send_slip_bytes((uint8_t *)profile->modes, sizeof(profile->modes));
+      for(uint32_t i = 0; i < 256; i++){
+        if(profile->opcodes[i].count == 0) continue;
+        serial_send_slip_byte(i);
+        serial_send_slip_bytes((uint8_t *)&profile->opcodes[i], sizeof(cpu6502_profile_entry_t));
+      }
+      serial_send_slip_end();
+      if(len > 0 && data[0] == 1){
+        res = emu_clear_counters(profile, sizeof(*profile));
+      }
+    }break;
+    case CMD_SET_PC_SAMPLING:
+    {
+      // uint32_t sample period in us (0 stops), uint8_t log2 of the bucket size
+      if(len < 5){
+        res = ESP_ERR_INVALID_SIZE;
+      } else {
+        uint32_t period_us = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+        res = pc_sampler_start(period_us, data[4]);
+      }
+    }break;
+    case CMD_GET_PC_SAMPLES:
+    {
+      // Bucket shift, samples missed while the 6502 was not running, then
+      // (uint16_t bucket, uint32_t count) records of the non-empty buckets.
+      // A first data byte of 1 clears the histogram.
+      uint8_t shift = pc_sampler_hist.shift;
+      serial_send_slip_byte(CMD_GET_PC_SAMPLES);
+      serial_send_slip_byte(shift);
+      serial_send_slip_bytes((uint8_t *)&pc_sampler_missed, sizeof(pc_sampler_missed));
+      for(uint32_t i = 0; i < (0x10000 >> shift); i++){
+        uint32_t count = pc_sampler_hist.buckets[i];
+        if(count == 0) continue;
+        uint16_t bucket = i;
+        serial_send_slip_bytes((uint8_t *)&bucket, sizeof(bucket));
+        serial_send_slip_bytes((uint8_t *)&count, sizeof(count));
+      }
+      serial_send_slip_end();
+      if(len > 0 && data[0] == 1){
+        pc_sampler_clear();
+      }
+    }break;
+    case CMD_LOAD_SYMBOLS:
+    {
+      // uint8_t 1 to replace the loaded names, then (uint16_t address,
+      // uint8_t length, name) records
+      if(len < 1){
+        res = ESP_ERR_INVALID_SIZE;
+        break;
+      }
+      if(data[0] == 1){
+        symbols_clear();
+      }
+      for(uint32_t i = 1; i < len && res == ESP_OK; ){
+        if(len - i < 3 || len - i - 3 < data[i + 2]){
+          res = ESP_ERR_INVALID_SIZE;
+          break;
+        }
+        res = symbols_add(data[i] | (data[i + 1] << 8), (const char *)&data[i + 3], data[i + 2]);
+        i += 3 + data[i + 2];
+      }
+    }break;
+    case CMD_GET_CALLGRAPH:
+    {
+      // Only a FAKE6502_CALLGRAPH build tracks calls
+      cpu6502_callgraph_t *graph = cpu6502.callgraph;
+      if(graph == NULL){
+        res = ESP_ERR_NOT_SUPPORTED;
+        break;
+      }
+      // Dropped call count, then (uint16_t entry, uint32_t calls, inclusive,
+      // exclusive, uint8_t name length, name) records of the called routines.
+      // A first data byte of 1 clears the counters.
+      serial_send_slip_byte(CMD_GET_CALLGRAPH);
+      serial_send_slip_bytes((uint8_t *)&graph->dropped, sizeof(graph->dropped));
+      for(uint32_t i = 0; i < CPU6502_CALLGRAPH_ROUTINES; i++){
+        cpu6502_routine_t *routine = &graph->routines[i];
+        if(routine->calls == 0) continue;
+        const char *name = symbols_find(routine->entry);
+        uint8_t name_len = name ? strlen(name) : 0;
+        serial_send_slip_bytes((uint8_t *)&routine->entry, sizeof(routine->entry));
+        serial_send_slip_bytes((uint8_t *)&routine->calls, sizeof(routine->calls));
+        serial_send_slip_bytes((uint8_t *)&routine->inclusive, sizeof(routine->inclusive));
+        serial_send_slip_bytes((uint8_t *)&routine->exclusive, sizeof(routine->exclusive));
+        serial_send_slip_byte(name_len);
+        serial_send_slip_bytes((uint8_t *)name, name_len);
+      }
+      serial_send_slip_end();
+      if(len > 0 && data[0] == 1){
+        res = emu_clear_counters(graph, sizeof(*graph));
+      }
+    }break;
+    case CMD_GET_TRACE:
+    {
+      // Only a FAKE6502_TRACE build records instructions
+      cpu6502_trace_t *trace = cpu6502.trace;
+      if(trace == NULL){
+        res = ESP_ERR_NOT_SUPPORTED;
+        break;
+      }
+      res = emu_freeze_trace(trace); // Head, wrapped and buffer stay as they are
+      if(res != ESP_OK) break;
+      // Buffer size, head, wrapped flag, then the used part of the buffer. A
+      // first data byte of 1 keeps the trace frozen after the download.
+      uint32_t used = trace->wrapped ? trace->size : trace->head;
+      serial_send_slip_byte(CMD_GET_TRACE);
+      serial_send_slip_bytes((uint8_t *)&trace->size, sizeof(trace->size));
+      serial_send_slip_bytes((uint8_t *)&trace->head, sizeof(trace->head));
+      serial_send_slip_byte(trace->wrapped);
+      serial_send_slip_bytes(trace->buffer, used);
+      serial_send_slip_end();
+      trace->frozen = (len > 0 && data[0] == 1);
+    }break;
+    case CMD_SNAPSHOT_SAVE:
+    {
+      // Optional uint16_t SNAPSHOT_FLAG_* bits
+      uint16_t flags = (len >= 2) ? (data[0] | (data[1] << 8)) : 0;
+      res = emu_snapshot(EMU_SNAPSHOT_SAVE, flags);
+    }break;
+    case CMD_SNAPSHOT_RESTORE:
+    {
+      res = emu_snapshot(EMU_SNAPSHOT_RESTORE, 0);
+    }break;
+    case CMD_SNAPSHOT_READ:
+    {
+      // The whole saved image in one packet
+      res = snapshot_image_size(SNAPSHOT_PARTITION, &size);
+      if(res != ESP_OK) break;
+      serial_send_slip_byte(CMD_SNAPSHOT_READ);
+      res = send_snapshot_image(SNAPSHOT_PARTITION, size);
+      serial_send_slip_end();
+    }break;
+    case CMD_SNAPSHOT_WRITE:
+    {
+      // uint32_t offset, then image bytes. Offset 0 erases the saved image.
+      if(len < 5){
+        res = ESP_ERR_INVALID_SIZE;
+      } else {
+        uint32_t offset = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+        res = snapshot_write(SNAPSHOT_PARTITION, offset, data + 4, len - 4);
+      }
+    }break;
+    case CMD_REPLAY_RECORD:
+    {
+      // uint8_t 1 starts recording from a new checkpoint, 0 stops
+      if(len < 1){
+        res = ESP_ERR_INVALID_SIZE;
+      } else {
+        res = emu_record(data[0]);
+      }
+    }break;
+    case CMD_REPLAY_STEP_BACK:
+    {
+      // uint32_t instructions to go back, the emulator stays stopped there
+      if(len < 4){
+        res = ESP_ERR_INVALID_SIZE;
+      } else {
+        cpu6502_request_stop(&cpu6502);
+        fake6502_running_status = 1;
+        res = emu_step_back(data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24));
+      }
+    }break;
+    case CMD_REPLAY_READ:
+    {
+      // The checkpoint image, replay_header_t, then the events, everything a
+      // host build needs to play the recording
+      replay_header_t header;
+      res = snapshot_image_size(SNAPSHOT_CHECKPOINT_PARTITION, &size);
+      if(res == ESP_OK){
+        res = emu_replay_hold_log(&header);
+      }
+      if(res != ESP_OK) break;
+      serial_send_slip_byte(CMD_REPLAY_READ);
+      res = send_snapshot_image(SNAPSHOT_CHECKPOINT_PARTITION, size);
+      serial_send_slip_bytes((uint8_t *)&header, sizeof(header));
+      serial_send_slip_bytes(emu_replay.buffer, header.size);
+      serial_send_slip_end();
+      emu_replay_release_log();
+    }break;
+    case CMD_SET_PERF_LOG:
+    {
+      // uint8_t 1 logs the emulation speed every second, 0 stops
+      if(len < 1){
+        res = ESP_ERR_INVALID_SIZE;
+      } else {
+        emu_perf_log = data[0];
+      }
+    }break;
+    case CMD_WRITE_BANK:
+    {
+      // uint32_t offset into the extended memory, then the bytes
+      if(len < 5){
+        res = ESP_ERR_INVALID_SIZE;
+      } else {
+        uint32_t offset = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+        res = emu_bank_write(offset, data + 4, len - 4);
+      }
+    }break;
     default:
       res = ESP_ERR_INVALID_ARG; // Invalid command
     break;
@@ -84,6 +349,7 @@ void command_parse(uint8_t *msg_data, uint32_t len){
     serial_send_slip_byte(CMD_RSP_PONG);
   }
   serial_send_slip_end();
+  emu_wake(); // Let an idle 6502 loop see what the command changed
 }
 //-----------------------------------------------------------------------------
 uint8_t serial_slip_buffer[1024]; // Buffer for SLIP data
@@ -19,6 +19,24 @@ typedef enum{
     CMD_STOP_EMU,
     CMD_STEP_EMU,
     CMD_GET_INST_COUNT,
+    CMD_SET_BREAKPOINT,
+    CMD_CLEAR_BREAKPOINTS,
+    CMD_GET_FUSION_COUNTS,
+    CMD_GET_PROFILE,
+    CMD_SET_PC_SAMPLING,
+    CMD_GET_PC_SAMPLES,
+    CMD_LOAD_SYMBOLS,
+    CMD_GET_CALLGRAPH,
+    CMD_GET_TRACE,
+    CMD_SNAPSHOT_SAVE,
+    CMD_SNAPSHOT_RESTORE,
+    CMD_SNAPSHOT_READ,
+    CMD_SNAPSHOT_WRITE,
+    CMD_REPLAY_RECORD,
+    CMD_REPLAY_STEP_BACK,
+    CMD_REPLAY_READ,
+    CMD_SET_PERF_LOG,
+    CMD_WRITE_BANK,
 } CMD_PACKET_TYPE_E;
 
 //-----------------------------------------------------------------------------
@@ -43,17 +43,21 @@
  *****************************************************
  * Usage:                                            *
  *                                                   *
- * Fake6502 requires you to provide two external     *
- * functions:                                        *
+ * All state of one emulated CPU lives in a          *
+ * cpu6502_t. Initialise it with cpu6502_init() and  *
+ * a bus table providing the memory callbacks:       *
  *                                                   *
- * uint8_t read6502(uint16_t address)                *
- * void write6502(uint16_t address, uint8_t value)   *
+ * uint8_t read(void *ctx, uint16_t address)         *
+ * void write(void *ctx, uint16_t address,           *
+ *            uint8_t value)                         *
+ *                                                   *
+ * ctx is passed back unchanged, so several machines *
+ * can each have their own memory.                   *
  *                                                   *
  * You may optionally pass Fake6502 the pointer to a *
  * function which you want to be called after every  *
- * emulated instruction. This function should be a   *
- * void with no parameters expected to be passed to  *
- * it.                                               *
+ * emulated instruction. It receives the cpu6502_t   *
+ * it was installed on.                              *
  *                                                   *
  * This can be very useful. For example, in a NES    *
  * emulator, you check the number of clock ticks     *
@@ -61,36 +65,67 @@
  * APU events.                                       *
  *                                                   *
  * To pass Fake6502 this pointer, use the            *
- * hookexternal(void *funcptr) function provided.    *
+ * hookexternal(cpu, funcptr) function provided.     *
  *                                                   *
  * To disable the hook later, pass NULL to it.       *
  *****************************************************
  * Useful functions in this emulator:                *
  *                                                   *
- * void reset6502()                                  *
+ * void cpu6502_init(cpu, bus)                       *
+ *   - Clear the context and attach the bus.         *
+ *                                                   *
+ * void reset6502(cpu)                               *
  *   - Call this once before you begin execution.    *
  *                                                   *
- * void exec6502(uint32_t tickcount)                 *
+ * cpu6502_stop_t run6502(cpu, uint32_t budget)      *
+ *   - Execute up to budget instructions. Returns    *
+ *     early on a breakpoint, a stop request or WAI, *
+ *     the return value tells which.                 *
+ *                                                   *
+ * void cpu6502_skip_idle(cpu, uint32_t ticks)       *
+ *   - After run6502() returned CPU6502_STOP_IDLE,   *
+ *     credit the ticks the idle loop would have     *
+ *     used while the caller slept.                  *
+ *                                                   *
+ * cpu6502_stop_t exec6502(cpu, uint32_t tickcount)  *
  *   - Execute 6502 code up to the next specified    *
  *     count of clock ticks.                         *
  *                                                   *
- * void step6502()                                   *
+ * void step6502(cpu)                                *
  *   - Execute a single instrution.                  *
  *                                                   *
- * void irq6502()                                    *
- *   - Trigger a hardware IRQ in the 6502 core.      *
+ * void cpu6502_irq_assert(cpu, uint32_t source)     *
+ * void cpu6502_irq_deassert(cpu, uint32_t source)   *
+ *   - Pull the IRQ line low or release it for one   *
+ *     CPU6502_IRQ_SOURCE(n). The line is low while  *
+ *     any source asserts it, and the IRQ is taken   *
+ *     before the next instruction when the I flag   *
+ *     is clear. Safe to call from other tasks.      *
+ *                                                   *
+ * void nmi6502(cpu)                                 *
+ *   - Latch an edge on NMI. The NMI is taken before *
+ *     the next instruction.                         *
  *                                                   *
- * void nmi6502()                                    *
- *   - Trigger an NMI in the 6502 core.              *
+ * A CPU waiting in WAI wakes on any interrupt       *
+ * request, even a masked IRQ.                       *
  *                                                   *
- * void hookexternal(void *funcptr)                  *
- *   - Pass a pointer to a void function taking no   *
- *     parameters. This will cause Fake6502 to call  *
- *     that function once after each emulated        *
- *     instruction.                                  *
+ * uint8_t cpu6502_request_sample(cpu)               *
+ *   - Count the pc of the next instruction into the *
+ *     cpu->pchist histogram. Safe to call from a    *
+ *     timer. Returns 0 if the previous request was  *
+ *     still pending, as the CPU was not running.    *
+ *                                                   *
+ * void hookexternal(cpu, funcptr)                   *
+ *   - Install a function called once after each     *
+ *     emulated instruction.                         *
+ *                                                   *
+ * void cpu6502_invalidate(cpu, address, length)     *
+ *   - Call after changing memory behind the back of *
+ *     the CPU, so stale decoded instructions in     *
+ *     that range are dropped.                       *
  *                                                   *
  *****************************************************
- * Useful variables in this emulator:                *
+ * Useful fields of cpu6502_t:                       *
  *                                                   *
  * uint32_t clockticks6502                           *
  *   - A running total of the emulated cycle count.  *
@@ -100,10 +135,47 @@
  *     instruction count. This is not related to     *
  *     clock cycle timing.                           *
  *                                                   *
+ * uint8_t idledetect                                *
+ *   - When set, run6502() of the fused core stops   *
+ *     with CPU6502_STOP_IDLE at the end of a loop   *
+ *     that cannot exit without outside input: a     *
+ *     JMP or branch to itself, or a single load     *
+ *     followed by a branch back to it.              *
+ *                                                   *
+ * cpu6502_profile_t *profile                        *
+ *   - In a FAKE6502_PROFILE build, every executed   *
+ *     instruction is counted into these tables when *
+ *     set, by opcode and by addressing mode.        *
+ *                                                   *
+ * cpu6502_callgraph_t *callgraph                    *
+ *   - In a FAKE6502_CALLGRAPH build, the calls and  *
+ *     ticks of every routine entered by JSR, BRK or *
+ *     an interrupt are counted here when set.       *
+ *                                                   *
+ * cpu6502_trace_t *trace                            *
+ *   - In a FAKE6502_TRACE build, every instruction  *
+ *     is recorded into this ring buffer when set.   *
+ *     Zero it and give it a buffer before use.      *
+ *                                                   *
+ * void (*interrupthook)(ctx, uint16_t vector)       *
+ *   - When set, called with interruptctx and the    *
+ *     vector of every interrupt as it is taken, and *
+ *     with a vector of 0 when a WAI ends.           *
+ *                                                   *
+ * cpu6502_pchist_t *pchist                          *
+ *   - When set, the pc sampled by each request is   *
+ *     counted into buckets[pc >> shift].            *
+ *                                                   *
+ * uint32_t fusions[CPU6502_FUSE_COUNT]              *
+ *   - How often each superinstruction of the fused  *
+ *     core ran both of its instructions in one      *
+ *     dispatch.                                     *
+ *                                                   *
  *****************************************************/
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include "fake6502.h"
 
 //6502 defines
@@ -115,700 +187,1071 @@
                      //CPU in the Nintendo Entertainment System does not
                      //support BCD operation.
 
-#define saveaccum(n) a = (uint8_t)((n) & 0x00FF)
+//memory access through the bus of the machine
+#define read6502(c, addr) (c)->bus.read((c)->bus.ctx, (addr))
+#define write6502(c, addr, val) (c)->bus.write((c)->bus.ctx, (addr), (val))
+//zero page and stack access, addr is below 0x200
+#ifdef FAKE6502_DIRECT_LOW_PAGES
+#define readlow6502(c, addr) ((c)->bus.lowpages[(addr)])
+#define writelow6502(c, addr, val) ((c)->bus.lowpages[(addr)] = (val))
+#else
+#define readlow6502(c, addr) read6502(c, addr)
+#define writelow6502(c, addr, val) write6502(c, addr, val)
+#endif
+
+#define saveaccum(n) c->a = (uint8_t)((n) & 0x00FF)
 
 //flag calculation macros
 #define zerocalc(n) {\
-    if ((n) & 0x00FF) clearzero();\
-        else setzero();\
+    if ((n) & 0x00FF) clearzero(c);\
+        else setzero(c);\
 }
 
 #define signcalc(n) {\
-    if ((n) & 0x0080) setsign();\
-        else clearsign();\
+    if ((n) & 0x0080) setsign(c);\
+        else clearsign(c);\
 }
 
 #define carrycalc(n) {\
-    if ((n) & 0xFF00) setcarry();\
-        else clearcarry();\
+    if ((n) & 0xFF00) setcarry(c);\
+        else clearcarry(c);\
 }
 
 #define overflowcalc(n, m, o) { /* n = result, m = accumulator, o = memory */ \
-    if (((n) ^ (uint16_t)(m)) & ((n) ^ (o)) & 0x0080) setoverflow();\
-        else clearoverflow();\
+    if (((n) ^ (uint16_t)(m)) & ((n) ^ (o)) & 0x0080) setoverflow(c);\
+        else clearoverflow(c);\
 }
 
 
-//6502 CPU registers
-static uint16_t pc;
-static uint8_t sp, a, x, y, status;
-
-uint16_t *fake6502_pc = &pc;
-uint8_t *fake6502_sp = &sp; 
-uint8_t *fake6502_a = &a;
-uint8_t *fake6502_x = &x;
-uint8_t *fake6502_y = &y;
-uint8_t *fake6502_status = &status;
-
-//helper variables
-uint32_t instructions = 0; //keep track of total instructions executed
-uint32_t clockticks6502 = 0, clockgoal6502 = 0;
-uint16_t oldpc, ea, reladdr, value, result;
-uint8_t opcode, oldstatus;
-
+void cpu6502_init(cpu6502_t *cpu, const cpu6502_bus_t *bus) {
+    memset(cpu, 0, sizeof(*cpu));
+    cpu->bus = *bus;
+}
 
 //a few general functions used by various other functions
-void push16(uint16_t pushval) {
-    write6502(BASE_STACK + sp, (pushval >> 8) & 0xFF);
-    write6502(BASE_STACK + ((sp - 1) & 0xFF), pushval & 0xFF);
-    sp -= 2;
+void push16(cpu6502_t *c, uint16_t pushval) {
+    writelow6502(c, BASE_STACK + c->sp, (pushval >> 8) & 0xFF);
+    writelow6502(c, BASE_STACK + ((c->sp - 1) & 0xFF), pushval & 0xFF);
+    c->sp -= 2;
 }
 
-void push8(uint8_t pushval) {
-    write6502(BASE_STACK + sp--, pushval);
+void push8(cpu6502_t *c, uint8_t pushval) {
+    writelow6502(c, BASE_STACK + c->sp--, pushval);
 }
 
-uint16_t pull16() {
+uint16_t pull16(cpu6502_t *c) {
     uint16_t temp16;
-    temp16 = read6502(BASE_STACK + ((sp + 1) & 0xFF)) | ((uint16_t)read6502(BASE_STACK + ((sp + 2) & 0xFF)) << 8);
-    sp += 2;
+    temp16 = readlow6502(c, BASE_STACK + ((c->sp + 1) & 0xFF)) | ((uint16_t)readlow6502(c, BASE_STACK + ((c->sp + 2) & 0xFF)) << 8);
+    c->sp += 2;
     return(temp16);
 }
 
-uint8_t pull8() {
-    return (read6502(BASE_STACK + ++sp));
+uint8_t pull8(cpu6502_t *c) {
+    return (readlow6502(c, BASE_STACK + ++c->sp));
+}
+
+void reset6502(cpu6502_t *c) {
+    c->pc = (uint16_t)read6502(c, 0xFFFC) | ((uint16_t)read6502(c, 0xFFFD) << 8);
+    c->a = 0;
+    c->x = 0;
+    c->y = 0;
+    c->sp = 0xFD;
+    c->status |= FLAG_CONSTANT;
+    c->waiting = 0;
+    __atomic_fetch_and(&c->events, ~CPU6502_EVENT_NMI, __ATOMIC_RELAXED); //drop a latched NMI
+#ifdef FAKE6502_CALLGRAPH
+    if (c->callgraph) c->callgraph->depth = 0;
+#endif
+}
+
+//run control shared by both engines
+void cpu6502_request_stop(cpu6502_t *c) {
+    __atomic_fetch_or(&c->events, CPU6502_EVENT_STOP, __ATOMIC_RELAXED);
 }
 
-void reset6502() {
-    pc = (uint16_t)read6502(0xFFFC) | ((uint16_t)read6502(0xFFFD) << 8);
-    a = 0;
-    x = 0;
-    y = 0;
-    sp = 0xFD;
-    status |= FLAG_CONSTANT;
+//drop a stop request no run has taken, so it can't end the next one before
+//its first instruction
+void cpu6502_cancel_stop(cpu6502_t *c) {
+    __atomic_fetch_and(&c->events, ~CPU6502_EVENT_STOP, __ATOMIC_RELAXED);
 }
 
+//sampling only costs the run loop its existing events test, the sample is
+//taken by checkstop()
+uint8_t cpu6502_request_sample(cpu6502_t *c) {
+    return !(__atomic_fetch_or(&c->events, CPU6502_EVENT_SAMPLE, __ATOMIC_RELAXED) & CPU6502_EVENT_SAMPLE);
+}
+
+int cpu6502_set_breakpoint(cpu6502_t *c, uint16_t address) {
+    if (c->nbreakpoints >= CPU6502_MAX_BREAKPOINTS) return -1;
+    c->breakpoints[c->nbreakpoints++] = address;
+    return 0;
+}
 
-static void (*addrtable[256])();
-static void (*optable[256])();
-uint8_t penaltyop, penaltyaddr;
+void cpu6502_clear_breakpoints(cpu6502_t *c) {
+    c->nbreakpoints = 0;
+}
+
+//drop the decoded instructions that overlap address..address+length-1. a
+//superinstruction starting up to five bytes before the range can overlap it
+//too.
+//the fused core calls this for its own writes, anything else that changes
+//memory at or above FAKE6502_DCACHE_START has to call it, preferably while
+//the CPU is not running.
+//cached instructions start at or above FAKE6502_DCACHE_START and never wrap
+//around the end of memory, so only that part of the range is looked at and
+//a change below it costs nothing.
+void cpu6502_invalidate(cpu6502_t *c, uint16_t address, uint32_t length) {
+    uint32_t first = address < FAKE6502_DCACHE_START + 5 ? FAKE6502_DCACHE_START : address - 5u;
+    uint32_t end = length > 0x10000u - address ? 0x10000u : address + length;
+    uint32_t pc;
+    if (first >= end) return;
+    if (end - first >= FAKE6502_DCACHE_ENTRIES) {
+        for (pc = 0; pc < FAKE6502_DCACHE_ENTRIES; pc++) c->dcache[pc].length = 0;
+        return;
+    }
+    for (pc = first; pc < end; pc++) {
+        cpu6502_decoded_t *entry = &c->dcache[pc & (FAKE6502_DCACHE_ENTRIES - 1)];
+        if (entry->pc == pc) entry->length = 0;
+    }
+}
+
+//credit ticks spent outside the emulation while the CPU sat in the idle loop
+//run6502() stopped in, rounded down to whole iterations of that loop
+void cpu6502_skip_idle(cpu6502_t *c, uint32_t ticks) {
+#ifndef FAKE6502_FAST
+    if (c->idleticks) c->clockticks6502 += ticks - ticks % c->idleticks;
+#else
+    (void)c; //no cycles are counted
+    (void)ticks;
+#endif
+}
+
+//interrupt lines, all in the events word so the run loop sees them with the
+//same single test as a stop request
+void cpu6502_irq_assert(cpu6502_t *c, uint32_t source) {
+    __atomic_fetch_or(&c->events, source & CPU6502_EVENT_IRQ, __ATOMIC_RELAXED);
+}
+
+void cpu6502_irq_deassert(cpu6502_t *c, uint32_t source) {
+    __atomic_fetch_and(&c->events, ~(source & CPU6502_EVENT_IRQ), __ATOMIC_RELAXED);
+}
+
+void nmi6502(cpu6502_t *c) {
+    __atomic_fetch_or(&c->events, CPU6502_EVENT_NMI, __ATOMIC_RELAXED);
+}
+
+//vector of the interrupt to take before the next instruction, or 0. a
+//latched NMI is consumed by this.
+static uint16_t takeinterrupt(cpu6502_t *c, uint8_t status) {
+    uint32_t events = c->events;
+    uint16_t vector = 0;
+    if (events & CPU6502_EVENT_NMI) {
+        __atomic_fetch_and(&c->events, ~CPU6502_EVENT_NMI, __ATOMIC_RELAXED);
+        vector = 0xFFFA;
+    } else if ((events & CPU6502_EVENT_IRQ) && !(status & FLAG_INTERRUPT)) {
+        vector = 0xFFFE;
+    }
+    if (vector && c->interrupthook) c->interrupthook(c->interruptctx, vector);
+    return vector;
+}
+
+//true when WAI may end, returns 0 if the CPU keeps waiting
+static uint8_t wake6502(cpu6502_t *c) {
+    if (!(c->events & (CPU6502_EVENT_NMI | CPU6502_EVENT_IRQ))) return 0;
+    c->waiting = 0;
+    if (c->interrupthook) c->interrupthook(c->interruptctx, 0);
+    return 1;
+}
+
+//called before an instruction when events or breakpoints are pending.
+//stepover skips the breakpoints, for the first instruction of a run that
+//resumes from the breakpoint it stopped at. returns CPU6502_STOP_BUDGET to
+//keep going.
+static cpu6502_stop_t checkstop(cpu6502_t *c, uint16_t pc, uint8_t stepover) {
+    uint8_t i;
+    if (c->events & CPU6502_EVENT_SAMPLE) {
+        __atomic_fetch_and(&c->events, ~CPU6502_EVENT_SAMPLE, __ATOMIC_RELAXED);
+        if (c->pchist) c->pchist->buckets[pc >> c->pchist->shift]++;
+    }
+    if (c->events & CPU6502_EVENT_STOP) {
+        __atomic_fetch_and(&c->events, ~CPU6502_EVENT_STOP, __ATOMIC_RELAXED);
+        return CPU6502_STOP_REQUEST;
+    }
+    for (i = 0; i < c->nbreakpoints && !stepover; i++) {
+        if (c->breakpoints[i] == pc) return CPU6502_STOP_BREAKPOINT;
+    }
+    return CPU6502_STOP_BUDGET;
+}
+
+
+#ifdef FAKE6502_PROFILE
+//addressing mode of every opcode
+static const uint8_t opmode[256] = {
+    #define OPCODE(code, op, mode, ticks, penalty) [code] = CPU6502_MODE_##mode,
+    #include "fake6502_opcodes.h"
+    #undef OPCODE
+};
+
+//count one executed instruction that used ticks, penalty of them for
+//crossing a page
+static void profile6502(cpu6502_profile_t *p, uint8_t opcode, uint32_t ticks, uint8_t penalty) {
+    cpu6502_profile_entry_t *op = &p->opcodes[opcode], *mode = &p->modes[opmode[opcode]];
+    op->count++;
+    op->ticks += ticks;
+    op->penalty += penalty;
+    mode->count++;
+    mode->ticks += ticks;
+    mode->penalty += penalty;
+}
+#endif
+
+#ifdef FAKE6502_CALLGRAPH
+//a JSR, BRK or interrupt entered the routine at entry and left the stack
+//pointer at sp. now is clockticks6502 before the calling instruction, so
+//the call itself is counted to the routine.
+static void callenter(cpu6502_callgraph_t *g, uint16_t entry, uint8_t sp, uint32_t now) {
+    uint32_t i, slot = entry ^ (entry >> 7);
+    cpu6502_callframe_t *frame;
+    if (g->depth == CPU6502_CALLGRAPH_DEPTH) {
+        g->dropped++;
+        return;
+    }
+    frame = &g->frames[g->depth++];
+    frame->routine = NULL;
+    frame->start = now;
+    frame->callees = 0;
+    frame->sp = sp;
+    for (i = 0; i < CPU6502_CALLGRAPH_ROUTINES; i++) {
+        cpu6502_routine_t *r = &g->routines[(slot + i) & (CPU6502_CALLGRAPH_ROUTINES - 1)];
+        if (r->calls && r->entry != entry) continue;
+        r->entry = entry;
+        r->calls++;
+        frame->routine = r;
+        return;
+    }
+    g->dropped++;
+}
+
+//an RTS or RTI left the stack pointer at sp, at clockticks6502 now. every
+//frame below sp has returned, which also unwinds routines that dropped
+//their return address, while an RTS used as a jump returns from nothing.
+static void callleave(cpu6502_callgraph_t *g, uint8_t sp, uint32_t now) {
+    while (g->depth && g->frames[g->depth - 1].sp < sp) {
+        cpu6502_callframe_t *frame = &g->frames[--g->depth];
+        uint32_t inclusive = now - frame->start;
+        if (frame->routine) {
+            frame->routine->inclusive += inclusive;
+            frame->routine->exclusive += inclusive - frame->callees;
+        }
+        if (g->depth) g->frames[g->depth - 1].callees += inclusive;
+    }
+}
+
+#define CALLENTER(c, entry, sp) if ((c)->callgraph) callenter((c)->callgraph, entry, sp, (c)->clockticks6502)
+#define CALLLEAVE(c, sp, ticks) if ((c)->callgraph) callleave((c)->callgraph, sp, (c)->clockticks6502 + (ticks))
+#else
+#define CALLENTER(c, entry, sp)
+#define CALLLEAVE(c, sp, ticks)
+#endif
+
+#if !defined(FAKE6502_LEGACY_CORE) || defined(FAKE6502_TRACE)
+//instruction length of each addressing mode
+#define LENGTH_IMP  1
+#define LENGTH_ACC  1
+#define LENGTH_IMM  2
+#define LENGTH_ZP   2
+#define LENGTH_ZPX  2
+#define LENGTH_ZPY  2
+#define LENGTH_REL  2
+#define LENGTH_ABSO 3
+#define LENGTH_ABSX 3
+#define LENGTH_ABSY 3
+#define LENGTH_IND  3
+#define LENGTH_INDX 2
+#define LENGTH_INDY 2
+
+static const uint8_t oplength[256] = {
+    #define OPCODE(code, op, mode, ticks, penalty) [code] = LENGTH_##mode,
+    #include "fake6502_opcodes.h"
+    #undef OPCODE
+};
+#endif
+
+#ifdef FAKE6502_TRACE
+//encode the instruction at pc, its code bytes and the registers before it
+//into r, as a full record if the trace has to resync. returns the length.
+static uint8_t traceencode(cpu6502_trace_t *t, uint8_t *r, uint16_t pc, const uint8_t *code, const uint8_t *regs) {
+    uint8_t i, length = 1, header;
+    int16_t delta = (int16_t)(pc - t->nextpc);
+    if (t->resync) {
+        header = CPU6502_TRACE_PC_ABS;
+    } else if (!delta) {
+        header = CPU6502_TRACE_PC_NEXT;
+    } else if (delta >= -128 && delta < 128) {
+        header = CPU6502_TRACE_PC_REL;
+        r[length++] = (uint8_t)delta;
+    } else {
+        header = CPU6502_TRACE_PC_ABS;
+    }
+    if (header == CPU6502_TRACE_PC_ABS) {
+        r[length++] = pc & 0xFF;
+        r[length++] = pc >> 8;
+    }
+    for (i = 0; i < oplength[code[0]]; i++) r[length++] = code[i];
+    for (i = 0; i < 5; i++) {
+        if (!t->resync && regs[i] == t->regs[i]) continue;
+        header |= CPU6502_TRACE_A << i;
+        r[length++] = regs[i];
+    }
+    r[0] = header;
+    return length;
+}
+
+//record the instruction about to run at pc
+static void trace6502(cpu6502_t *c, uint16_t pc, uint8_t a, uint8_t x, uint8_t y, uint8_t sp, uint8_t status) {
+    cpu6502_trace_t *t = c->trace;
+    uint8_t regs[5] = { a, x, y, sp, status };
+    uint8_t code[3], r[CPU6502_TRACE_RECORD_MAX], length, i;
+    if (t->frozen) {
+        t->resync = 1;
+        return;
+    }
+    code[0] = read6502(c, pc);
+    for (i = 1; i < oplength[code[0]]; i++) code[i] = read6502(c, (uint16_t)(pc + i));
+    if (t->head % CPU6502_TRACE_CHUNK == 0) t->resync = 1;
+    length = traceencode(t, r, pc, code, regs);
+    if (t->head % CPU6502_TRACE_CHUNK + length > CPU6502_TRACE_CHUNK) {
+        //too long for this chunk, the next one starts with a full record
+        t->buffer[t->head] = CPU6502_TRACE_END;
+        t->head += CPU6502_TRACE_CHUNK - t->head % CPU6502_TRACE_CHUNK;
+        if (t->head >= t->size) {
+            t->head = 0;
+            t->wrapped = 1;
+        }
+        t->resync = 1;
+        length = traceencode(t, r, pc, code, regs);
+    }
+    memcpy(t->buffer + t->head, r, length);
+    t->head += length;
+    if (t->head >= t->size) {
+        t->head = 0;
+        t->wrapped = 1;
+    }
+    t->resync = 0;
+    t->nextpc = pc + oplength[code[0]];
+    memcpy(t->regs, regs, sizeof(regs));
+}
+
+#define TRACE(c, pc, a, x, y, sp, status) if ((c)->trace) trace6502(c, pc, a, x, y, sp, status)
+#else
+#define TRACE(c, pc, a, x, y, sp, status)
+#endif
+
+#ifndef NES_CPU
+//decimal mode ADC and SBC of the NMOS 6502, one lookup per nibble. the low
+//tables take the low nibble sum (a & 0x0F) + (value & 0x0F) + carry for ADC,
+//or 16 + (a & 0x0F) - (value & 0x0F) + carry - 1 for SBC, and give the
+//adjusted low digit with the carry or borrow into the high digit in bit 4.
+//the high tables are indexed by (a >> 4) << 5 | (value >> 4) << 1 | that bit
+//and give the adjusted high digit in bits 4-7. for ADC, bits 8-15 also hold
+//N and V as the NMOS sets them from the sum before the high digit is adjusted,
+//and the decimal carry. Z always follows the binary sum, and SBC leaves all
+//flags as in binary mode.
+static const uint8_t adclo[32] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15,
+    0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15
+};
+static const uint16_t adchi[512] = {
+    0x0000, 0x0010, 0x0010, 0x0020, 0x0020, 0x0030, 0x0030, 0x0040, 0x0040, 0x0050, 0x0050, 0x0060, 0x0060, 0x0070, 0x0070, 0xC080,
+    0x8080, 0x8090, 0x8090, 0x8100, 0x8100, 0x8110, 0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160,
+    0x0010, 0x0020, 0x0020, 0x0030, 0x0030, 0x0040, 0x0040, 0x0050, 0x0050, 0x0060, 0x0060, 0x0070, 0x0070, 0xC080, 0xC080, 0xC090,
+    0x8090, 0x8100, 0x8100, 0x8110, 0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170,
+    0x0020, 0x0030, 0x0030, 0x0040, 0x0040, 0x0050, 0x0050, 0x0060, 0x0060, 0x0070, 0x0070, 0xC080, 0xC080, 0xC090, 0xC090, 0xC100,
+    0x8100, 0x8110, 0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180,
+    0x0030, 0x0040, 0x0040, 0x0050, 0x0050, 0x0060, 0x0060, 0x0070, 0x0070, 0xC080, 0xC080, 0xC090, 0xC090, 0xC100, 0xC100, 0xC110,
+    0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190,
+    0x0040, 0x0050, 0x0050, 0x0060, 0x0060, 0x0070, 0x0070, 0xC080, 0xC080, 0xC090, 0xC090, 0xC100, 0xC100, 0xC110, 0xC110, 0xC120,
+    0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190, 0x0190, 0x01A0,
+    0x0050, 0x0060, 0x0060, 0x0070, 0x0070, 0xC080, 0xC080, 0xC090, 0xC090, 0xC100, 0xC100, 0xC110, 0xC110, 0xC120, 0xC120, 0xC130,
+    0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190, 0x0190, 0x01A0, 0x01A0, 0x01B0,
+    0x0060, 0x0070, 0x0070, 0xC080, 0xC080, 0xC090, 0xC090, 0xC100, 0xC100, 0xC110, 0xC110, 0xC120, 0xC120, 0xC130, 0xC130, 0xC140,
+    0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190, 0x0190, 0x01A0, 0x01A0, 0x01B0, 0x01B0, 0x01C0,
+    0x0070, 0xC080, 0xC080, 0xC090, 0xC090, 0xC100, 0xC100, 0xC110, 0xC110, 0xC120, 0xC120, 0xC130, 0xC130, 0xC140, 0xC140, 0xC150,
+    0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190, 0x0190, 0x01A0, 0x01A0, 0x01B0, 0x01B0, 0x01C0, 0x01C0, 0x01D0,
+    0x8080, 0x8090, 0x8090, 0x8100, 0x8100, 0x8110, 0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160,
+    0x4160, 0x4170, 0x4170, 0x4180, 0x4180, 0x4190, 0x4190, 0x41A0, 0x41A0, 0x41B0, 0x41B0, 0x41C0, 0x41C0, 0x41D0, 0x41D0, 0x81E0,
+    0x8090, 0x8100, 0x8100, 0x8110, 0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170,
+    0x4170, 0x4180, 0x4180, 0x4190, 0x4190, 0x41A0, 0x41A0, 0x41B0, 0x41B0, 0x41C0, 0x41C0, 0x41D0, 0x41D0, 0x81E0, 0x81E0, 0x81F0,
+    0x8100, 0x8110, 0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180,
+    0x4180, 0x4190, 0x4190, 0x41A0, 0x41A0, 0x41B0, 0x41B0, 0x41C0, 0x41C0, 0x41D0, 0x41D0, 0x81E0, 0x81E0, 0x81F0, 0x81F0, 0x8100,
+    0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190,
+    0x4190, 0x41A0, 0x41A0, 0x41B0, 0x41B0, 0x41C0, 0x41C0, 0x41D0, 0x41D0, 0x81E0, 0x81E0, 0x81F0, 0x81F0, 0x8100, 0x8100, 0x8110,
+    0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190, 0x0190, 0x01A0,
+    0x41A0, 0x41B0, 0x41B0, 0x41C0, 0x41C0, 0x41D0, 0x41D0, 0x81E0, 0x81E0, 0x81F0, 0x81F0, 0x8100, 0x8100, 0x8110, 0x8110, 0x8120,
+    0x8130, 0x8140, 0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190, 0x0190, 0x01A0, 0x01A0, 0x01B0,
+    0x41B0, 0x41C0, 0x41C0, 0x41D0, 0x41D0, 0x81E0, 0x81E0, 0x81F0, 0x81F0, 0x8100, 0x8100, 0x8110, 0x8110, 0x8120, 0x8120, 0x8130,
+    0x8140, 0x8150, 0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190, 0x0190, 0x01A0, 0x01A0, 0x01B0, 0x01B0, 0x01C0,
+    0x41C0, 0x41D0, 0x41D0, 0x81E0, 0x81E0, 0x81F0, 0x81F0, 0x8100, 0x8100, 0x8110, 0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140,
+    0x8150, 0x0160, 0x0160, 0x0170, 0x0170, 0x0180, 0x0180, 0x0190, 0x0190, 0x01A0, 0x01A0, 0x01B0, 0x01B0, 0x01C0, 0x01C0, 0x01D0,
+    0x41D0, 0x81E0, 0x81E0, 0x81F0, 0x81F0, 0x8100, 0x8100, 0x8110, 0x8110, 0x8120, 0x8120, 0x8130, 0x8130, 0x8140, 0x8140, 0x8150
+};
+static const uint8_t sbclo[32] = {
+    0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+};
+static const uint8_t sbchi[512] = {
+    0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20,
+    0x20, 0x10, 0x10, 0x00, 0x00, 0xF0, 0xF0, 0xE0, 0xE0, 0xD0, 0xD0, 0xC0, 0xC0, 0xB0, 0xB0, 0xA0,
+    0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30,
+    0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0xF0, 0xF0, 0xE0, 0xE0, 0xD0, 0xD0, 0xC0, 0xC0, 0xB0,
+    0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40,
+    0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0xF0, 0xF0, 0xE0, 0xE0, 0xD0, 0xD0, 0xC0,
+    0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50,
+    0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0xF0, 0xF0, 0xE0, 0xE0, 0xD0,
+    0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60,
+    0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0xF0, 0xF0, 0xE0,
+    0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70,
+    0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0xF0,
+    0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80,
+    0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00,
+    0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90,
+    0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10,
+    0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00,
+    0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20,
+    0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10,
+    0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30,
+    0xA0, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20,
+    0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40,
+    0xB0, 0xA0, 0xA0, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30,
+    0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50,
+    0xC0, 0xB0, 0xB0, 0xA0, 0xA0, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50, 0x50, 0x40,
+    0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60,
+    0xD0, 0xC0, 0xC0, 0xB0, 0xB0, 0xA0, 0xA0, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60, 0x60, 0x50,
+    0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80, 0x80, 0x70,
+    0xE0, 0xD0, 0xD0, 0xC0, 0xC0, 0xB0, 0xB0, 0xA0, 0xA0, 0x90, 0x90, 0x80, 0x80, 0x70, 0x70, 0x60,
+    0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90, 0x90, 0x80,
+    0xF0, 0xE0, 0xE0, 0xD0, 0xD0, 0xC0, 0xC0, 0xB0, 0xB0, 0xA0, 0xA0, 0x90, 0x90, 0x80, 0x80, 0x70,
+    0x70, 0x60, 0x60, 0x50, 0x50, 0x40, 0x40, 0x30, 0x30, 0x20, 0x20, 0x10, 0x10, 0x00, 0x00, 0x90
+};
+
+#define DECIMAL_LOW(lo) ((lo) & 0x0F)
+#define DECIMAL_HIGH(a, value, lo) (((a) >> 4) << 5 | ((value) >> 4) << 1 | (lo) >> 4)
+#endif
+
+
+#ifdef FAKE6502_LEGACY_CORE
+
+//legacy engine: one call through addrtable[] and one through optable[] per
+//instruction, with operands passed in the scratch fields of the context
+static void (*addrtable[256])(cpu6502_t *c);
+static void (*optable[256])(cpu6502_t *c);
 
 //addressing mode functions, calculates effective addresses
-static void imp() { //implied
+static void imp(cpu6502_t *c) { //implied
 }
 
-static void acc() { //accumulator
+static void acc(cpu6502_t *c) { //accumulator
 }
 
-static void imm() { //immediate
-    ea = pc++;
+static void imm(cpu6502_t *c) { //immediate
+    c->ea = c->pc++;
 }
 
-static void zp() { //zero-page
-    ea = (uint16_t)read6502((uint16_t)pc++);
+static void zp(cpu6502_t *c) { //zero-page
+    c->ea = (uint16_t)read6502(c, (uint16_t)c->pc++);
 }
 
-static void zpx() { //zero-page,X
-    ea = ((uint16_t)read6502((uint16_t)pc++) + (uint16_t)x) & 0xFF; //zero-page wraparound
+static void zpx(cpu6502_t *c) { //zero-page,X
+    c->ea = ((uint16_t)read6502(c, (uint16_t)c->pc++) + (uint16_t)c->x) & 0xFF; //zero-page wraparound
 }
 
-static void zpy() { //zero-page,Y
-    ea = ((uint16_t)read6502((uint16_t)pc++) + (uint16_t)y) & 0xFF; //zero-page wraparound
+static void zpy(cpu6502_t *c) { //zero-page,Y
+    c->ea = ((uint16_t)read6502(c, (uint16_t)c->pc++) + (uint16_t)c->y) & 0xFF; //zero-page wraparound
 }
 
-static void rel() { //relative for branch ops (8-bit immediate value, sign-extended)
-    reladdr = (uint16_t)read6502(pc++);
-    if (reladdr & 0x80) reladdr |= 0xFF00;
+static void rel(cpu6502_t *c) { //relative for branch ops (8-bit immediate value, sign-extended)
+    c->reladdr = (uint16_t)read6502(c, c->pc++);
+    if (c->reladdr & 0x80) c->reladdr |= 0xFF00;
 }
 
-static void abso() { //absolute
-    ea = (uint16_t)read6502(pc) | ((uint16_t)read6502(pc+1) << 8);
-    pc += 2;
+static void abso(cpu6502_t *c) { //absolute
+    c->ea = (uint16_t)read6502(c, c->pc) | ((uint16_t)read6502(c, c->pc+1) << 8);
+    c->pc += 2;
 }
 
-static void absx() { //absolute,X
+static void absx(cpu6502_t *c) { //absolute,X
     uint16_t startpage;
-    ea = ((uint16_t)read6502(pc) | ((uint16_t)read6502(pc+1) << 8));
-    startpage = ea & 0xFF00;
-    ea += (uint16_t)x;
+    c->ea = ((uint16_t)read6502(c, c->pc) | ((uint16_t)read6502(c, c->pc+1) << 8));
+    startpage = c->ea & 0xFF00;
+    c->ea += (uint16_t)c->x;
 
-    if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
-        penaltyaddr = 1;
+    if (startpage != (c->ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+        c->penaltyaddr = 1;
     }
 
-    pc += 2;
+    c->pc += 2;
 }
 
-static void absy() { //absolute,Y
+static void absy(cpu6502_t *c) { //absolute,Y
     uint16_t startpage;
-    ea = ((uint16_t)read6502(pc) | ((uint16_t)read6502(pc+1) << 8));
-    startpage = ea & 0xFF00;
-    ea += (uint16_t)y;
+    c->ea = ((uint16_t)read6502(c, c->pc) | ((uint16_t)read6502(c, c->pc+1) << 8));
+    startpage = c->ea & 0xFF00;
+    c->ea += (uint16_t)c->y;
 
-    if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
-        penaltyaddr = 1;
+    if (startpage != (c->ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+        c->penaltyaddr = 1;
     }
 
-    pc += 2;
+    c->pc += 2;
 }
 
-static void ind() { //indirect
+static void ind(cpu6502_t *c) { //indirect
     uint16_t eahelp, eahelp2;
-    eahelp = (uint16_t)read6502(pc) | (uint16_t)((uint16_t)read6502(pc+1) << 8);
+    eahelp = (uint16_t)read6502(c, c->pc) | (uint16_t)((uint16_t)read6502(c, c->pc+1) << 8);
     eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //replicate 6502 page-boundary wraparound bug
-    ea = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
-    pc += 2;
+    c->ea = (uint16_t)read6502(c, eahelp) | ((uint16_t)read6502(c, eahelp2) << 8);
+    c->pc += 2;
 }
 
-static void indx() { // (indirect,X)
+static void indx(cpu6502_t *c) { // (indirect,X)
     uint16_t eahelp;
-    eahelp = (uint16_t)(((uint16_t)read6502(pc++) + (uint16_t)x) & 0xFF); //zero-page wraparound for table pointer
-    ea = (uint16_t)read6502(eahelp & 0x00FF) | ((uint16_t)read6502((eahelp+1) & 0x00FF) << 8);
+    eahelp = (uint16_t)(((uint16_t)read6502(c, c->pc++) + (uint16_t)c->x) & 0xFF); //zero-page wraparound for table pointer
+    c->ea = (uint16_t)readlow6502(c, eahelp & 0x00FF) | ((uint16_t)readlow6502(c, (eahelp+1) & 0x00FF) << 8);
 }
 
-static void indy() { // (indirect),Y
+static void indy(cpu6502_t *c) { // (indirect),Y
     uint16_t eahelp, eahelp2, startpage;
-    eahelp = (uint16_t)read6502(pc++);
+    eahelp = (uint16_t)read6502(c, c->pc++);
     eahelp2 = (eahelp & 0xFF00) | ((eahelp + 1) & 0x00FF); //zero-page wraparound
-    ea = (uint16_t)read6502(eahelp) | ((uint16_t)read6502(eahelp2) << 8);
-    startpage = ea & 0xFF00;
-    ea += (uint16_t)y;
+    c->ea = (uint16_t)readlow6502(c, eahelp) | ((uint16_t)readlow6502(c, eahelp2) << 8);
+    startpage = c->ea & 0xFF00;
+    c->ea += (uint16_t)c->y;
 
-    if (startpage != (ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
-        penaltyaddr = 1;
+    if (startpage != (c->ea & 0xFF00)) { //one cycle penlty for page-crossing on some opcodes
+        c->penaltyaddr = 1;
     }
 }
 
-static uint16_t getvalue() {
-    if (addrtable[opcode] == acc) return((uint16_t)a);
-        else return((uint16_t)read6502(ea));
+static uint16_t getvalue(cpu6502_t *c) {
+    if (addrtable[c->opcode] == acc) return((uint16_t)c->a);
+        else return((uint16_t)read6502(c, c->ea));
 }
 
-static uint16_t getvalue16() {
-    return((uint16_t)read6502(ea) | ((uint16_t)read6502(ea+1) << 8));
-}
-
-static void putvalue(uint16_t saveval) {
-    if (addrtable[opcode] == acc) a = (uint8_t)(saveval & 0x00FF);
-        else write6502(ea, (saveval & 0x00FF));
+static void putvalue(cpu6502_t *c, uint16_t saveval) {
+    if (addrtable[c->opcode] == acc) c->a = (uint8_t)(saveval & 0x00FF);
+        else write6502(c, c->ea, (saveval & 0x00FF));
 }
 
 
 //instruction handler functions
-static void adc() {
-    penaltyop = 1;
-    value = getvalue();
-    result = (uint16_t)a + value + (uint16_t)(status & FLAG_CARRY);
-   
-    carrycalc(result);
-    zerocalc(result);
-    overflowcalc(result, a, value);
-    signcalc(result);
+static void adc(cpu6502_t *c) {
+    uint8_t carry = c->status & FLAG_CARRY;
+    c->penaltyop = 1;
+    c->value = getvalue(c);
+    c->result = (uint16_t)c->a + c->value + (uint16_t)carry;
+   
+    carrycalc(c->result);
+    zerocalc(c->result);
+    overflowcalc(c->result, c->a, c->value);
+    signcalc(c->result);
     
     #ifndef NES_CPU
-    if (status & FLAG_DECIMAL) {
-        clearcarry();
-        
-        if ((a & 0x0F) > 0x09) {
-            a += 0x06;
-        }
-        if ((a & 0xF0) > 0x90) {
-            a += 0x60;
-            setcarry();
-        }
-        
-        clockticks6502++;
+    if (c->status & FLAG_DECIMAL) {
+        uint8_t lo = adclo[(c->a & 0x0F) + (c->value & 0x0F) + carry];
+        uint16_t hi = adchi[DECIMAL_HIGH(c->a, c->value, lo)];
+        c->status = (c->status & ~(FLAG_SIGN | FLAG_OVERFLOW | FLAG_CARRY)) | (hi >> 8);
+        c->result = (hi & 0xF0) | DECIMAL_LOW(lo);
     }
     #endif
    
-    saveaccum(result);
+    saveaccum(c->result);
 }
 
-static void and() {
-    penaltyop = 1;
-    value = getvalue();
-    result = (uint16_t)a & value;
+static void and(cpu6502_t *c) {
+    c->penaltyop = 1;
+    c->value = getvalue(c);
+    c->result = (uint16_t)c->a & c->value;
    
-    zerocalc(result);
-    signcalc(result);
+    zerocalc(c->result);
+    signcalc(c->result);
    
-    saveaccum(result);
+    saveaccum(c->result);
 }
 
-static void asl() {
-    value = getvalue();
-    result = value << 1;
+static void asl(cpu6502_t *c) {
+    c->value = getvalue(c);
+    c->result = c->value << 1;
 
-    carrycalc(result);
-    zerocalc(result);
-    signcalc(result);
+    carrycalc(c->result);
+    zerocalc(c->result);
+    signcalc(c->result);
    
-    putvalue(result);
+    putvalue(c, c->result);
 }
 
-static void bcc() {
-    if ((status & FLAG_CARRY) == 0) {
-        oldpc = pc;
-        pc += reladdr;
-        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-            else clockticks6502++;
+static void bcc(cpu6502_t *c) {
+    if ((c->status & FLAG_CARRY) == 0) {
+        uint16_t oldpc = c->pc;
+        c->pc += c->reladdr;
+        if ((oldpc & 0xFF00) != (c->pc & 0xFF00)) c->clockticks6502 += 2; //check if jump crossed a page boundary
+            else c->clockticks6502++;
     }
 }
 
-static void bcs() {
-    if ((status & FLAG_CARRY) == FLAG_CARRY) {
-        oldpc = pc;
-        pc += reladdr;
-        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-            else clockticks6502++;
+static void bcs(cpu6502_t *c) {
+    if ((c->status & FLAG_CARRY) == FLAG_CARRY) {
+        uint16_t oldpc = c->pc;
+        c->pc += c->reladdr;
+        if ((oldpc & 0xFF00) != (c->pc & 0xFF00)) c->clockticks6502 += 2; //check if jump crossed a page boundary
+            else c->clockticks6502++;
     }
 }
 
-static void beq() {
-    if ((status & FLAG_ZERO) == FLAG_ZERO) {
-        oldpc = pc;
-        pc += reladdr;
-        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-            else clockticks6502++;
+static void beq(cpu6502_t *c) {
+    if ((c->status & FLAG_ZERO) == FLAG_ZERO) {
+        uint16_t oldpc = c->pc;
+        c->pc += c->reladdr;
+        if ((oldpc & 0xFF00) != (c->pc & 0xFF00)) c->clockticks6502 += 2; //check if jump crossed a page boundary
+            else c->clockticks6502++;
     }
 }
 
-static void bit() {
-    value = getvalue();
-    result = (uint16_t)a & value;
+static void bit(cpu6502_t *c) {
+    c->value = getvalue(c);
+    c->result = (uint16_t)c->a & c->value;
    
-    zerocalc(result);
-    status = (status & 0x3F) | (uint8_t)(value & 0xC0);
+    zerocalc(c->result);
+    c->status = (c->status & 0x3F) | (uint8_t)(c->value & 0xC0);
 }
 
-static void bmi() {
-    if ((status & FLAG_SIGN) == FLAG_SIGN) {
-        oldpc = pc;
-        pc += reladdr;
-        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-            else clockticks6502++;
+static void bmi(cpu6502_t *c) {
+    if ((c->status & FLAG_SIGN) == FLAG_SIGN) {
+        uint16_t oldpc = c->pc;
+        c->pc += c->reladdr;
+        if ((oldpc & 0xFF00) != (c->pc & 0xFF00)) c->clockticks6502 += 2; //check if jump crossed a page boundary
+            else c->clockticks6502++;
     }
 }
 
-static void bne() {
-    if ((status & FLAG_ZERO) == 0) {
-        oldpc = pc;
-        pc += reladdr;
-        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-            else clockticks6502++;
+static void bne(cpu6502_t *c) {
+    if ((c->status & FLAG_ZERO) == 0) {
+        uint16_t oldpc = c->pc;
+        c->pc += c->reladdr;
+        if ((oldpc & 0xFF00) != (c->pc & 0xFF00)) c->clockticks6502 += 2; //check if jump crossed a page boundary
+            else c->clockticks6502++;
     }
 }
 
-static void bpl() {
-    if ((status & FLAG_SIGN) == 0) {
-        oldpc = pc;
-        pc += reladdr;
-        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-            else clockticks6502++;
+static void bpl(cpu6502_t *c) {
+    if ((c->status & FLAG_SIGN) == 0) {
+        uint16_t oldpc = c->pc;
+        c->pc += c->reladdr;
+        if ((oldpc & 0xFF00) != (c->pc & 0xFF00)) c->clockticks6502 += 2; //check if jump crossed a page boundary
+            else c->clockticks6502++;
     }
 }
 
-static void brk() {
-    pc++;
-    push16(pc); //push next instruction address onto stack
-    push8(status | FLAG_BREAK); //push CPU status to stack
-    setinterrupt(); //set interrupt flag
-    pc = (uint16_t)read6502(0xFFFE) | ((uint16_t)read6502(0xFFFF) << 8);
+static void brk(cpu6502_t *c) {
+    c->pc++;
+    push16(c, c->pc); //push next instruction address onto stack
+    push8(c, c->status | FLAG_BREAK); //push CPU status to stack
+    setinterrupt(c); //set interrupt flag
+    c->pc = (uint16_t)read6502(c, 0xFFFE) | ((uint16_t)read6502(c, 0xFFFF) << 8);
+    CALLENTER(c, c->pc, c->sp);
 }
 
-static void bvc() {
-    if ((status & FLAG_OVERFLOW) == 0) {
-        oldpc = pc;
-        pc += reladdr;
-        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-            else clockticks6502++;
+static void bvc(cpu6502_t *c) {
+    if ((c->status & FLAG_OVERFLOW) == 0) {
+        uint16_t oldpc = c->pc;
+        c->pc += c->reladdr;
+        if ((oldpc & 0xFF00) != (c->pc & 0xFF00)) c->clockticks6502 += 2; //check if jump crossed a page boundary
+            else c->clockticks6502++;
     }
 }
 
-static void bvs() {
-    if ((status & FLAG_OVERFLOW) == FLAG_OVERFLOW) {
-        oldpc = pc;
-        pc += reladdr;
-        if ((oldpc & 0xFF00) != (pc & 0xFF00)) clockticks6502 += 2; //check if jump crossed a page boundary
-            else clockticks6502++;
+static void bvs(cpu6502_t *c) {
+    if ((c->status & FLAG_OVERFLOW) == FLAG_OVERFLOW) {
+        uint16_t oldpc = c->pc;
+        c->pc += c->reladdr;
+        if ((oldpc & 0xFF00) != (c->pc & 0xFF00)) c->clockticks6502 += 2; //check if jump crossed a page boundary
+            else c->clockticks6502++;
     }
 }
 
-static void clc() {
-    clearcarry();
+static void clc(cpu6502_t *c) {
+    clearcarry(c);
 }
 
-static void cld() {
-    cleardecimal();
+static void cld(cpu6502_t *c) {
+    cleardecimal(c);
 }
 
-static void cli() {
-    clearinterrupt();
+static void cli(cpu6502_t *c) {
+    clearinterrupt(c);
 }
 
-static void clv() {
-    clearoverflow();
+static void clv(cpu6502_t *c) {
+    clearoverflow(c);
 }
 
-static void cmp() {
-    penaltyop = 1;
-    value = getvalue();
-    result = (uint16_t)a - value;
+static void cmp(cpu6502_t *c) {
+    c->penaltyop = 1;
+    c->value = getvalue(c);
+    c->result = (uint16_t)c->a - c->value;
    
-    if (a >= (uint8_t)(value & 0x00FF)) setcarry();
-        else clearcarry();
-    if (a == (uint8_t)(value & 0x00FF)) setzero();
-        else clearzero();
-    signcalc(result);
+    if (c->a >= (uint8_t)(c->value & 0x00FF)) setcarry(c);
+        else clearcarry(c);
+    if (c->a == (uint8_t)(c->value & 0x00FF)) setzero(c);
+        else clearzero(c);
+    signcalc(c->result);
 }
 
-static void cpx() {
-    value = getvalue();
-    result = (uint16_t)x - value;
+static void cpx(cpu6502_t *c) {
+    c->value = getvalue(c);
+    c->result = (uint16_t)c->x - c->value;
    
-    if (x >= (uint8_t)(value & 0x00FF)) setcarry();
-        else clearcarry();
-    if (x == (uint8_t)(value & 0x00FF)) setzero();
-        else clearzero();
-    signcalc(result);
+    if (c->x >= (uint8_t)(c->value & 0x00FF)) setcarry(c);
+        else clearcarry(c);
+    if (c->x == (uint8_t)(c->value & 0x00FF)) setzero(c);
+        else clearzero(c);
+    signcalc(c->result);
 }
 
-static void cpy() {
-    value = getvalue();
-    result = (uint16_t)y - value;
+static void cpy(cpu6502_t *c) {
+    c->value = getvalue(c);
+    c->result = (uint16_t)c->y - c->value;
    
-    if (y >= (uint8_t)(value & 0x00FF)) setcarry();
-        else clearcarry();
-    if (y == (uint8_t)(value & 0x00FF)) setzero();
-        else clearzero();
-    signcalc(result);
+    if (c->y >= (uint8_t)(c->value & 0x00FF)) setcarry(c);
+        else clearcarry(c);
+    if (c->y == (uint8_t)(c->value & 0x00FF)) setzero(c);
+        else clearzero(c);
+    signcalc(c->result);
 }
 
-static void dec() {
-    value = getvalue();
-    result = value - 1;
+static void dec(cpu6502_t *c) {
+    c->value = getvalue(c);
+    c->result = c->value - 1;
    
-    zerocalc(result);
-    signcalc(result);
+    zerocalc(c->result);
+    signcalc(c->result);
    
-    putvalue(result);
+    putvalue(c, c->result);
 }
 
-static void dex() {
-    x--;
+static void dex(cpu6502_t *c) {
+    c->x--;
    
-    zerocalc(x);
-    signcalc(x);
+    zerocalc(c->x);
+    signcalc(c->x);
 }
 
-static void dey() {
-    y--;
+static void dey(cpu6502_t *c) {
+    c->y--;
    
-    zerocalc(y);
-    signcalc(y);
+    zerocalc(c->y);
+    signcalc(c->y);
 }
 
-static void eor() {
-    penaltyop = 1;
-    value = getvalue();
-    result = (uint16_t)a ^ value;
+static void eor(cpu6502_t *c) {
+    c->penaltyop = 1;
+    c->value = getvalue(c);
+    c->result = (uint16_t)c->a ^ c->value;
    
-    zerocalc(result);
-    signcalc(result);
+    zerocalc(c->result);
+    signcalc(c->result);
    
-    saveaccum(result);
+    saveaccum(c->result);
 }
 
-static void inc() {
-    value = getvalue();
-    result = value + 1;
+static void inc(cpu6502_t *c) {
+    c->value = getvalue(c);
+    c->result = c->value + 1;
    
-    zerocalc(result);
-    signcalc(result);
+    zerocalc(c->result);
+    signcalc(c->result);
    
-    putvalue(result);
+    putvalue(c, c->result);
 }
 
-static void inx() {
-    x++;
+static void inx(cpu6502_t *c) {
+    c->x++;
    
-    zerocalc(x);
-    signcalc(x);
+    zerocalc(c->x);
+    signcalc(c->x);
 }
 
-static void iny() {
-    y++;
+static void iny(cpu6502_t *c) {
+    c->y++;
    
-    zerocalc(y);
-    signcalc(y);
+    zerocalc(c->y);
+    signcalc(c->y);
 }
 
-static void jmp() {
-    pc = ea;
+static void jmp(cpu6502_t *c) {
+    c->pc = c->ea;
 }
 
-static void jsr() {
-    push16(pc - 1);
-    pc = ea;
+static void jsr(cpu6502_t *c) {
+    push16(c, c->pc - 1);
+    c->pc = c->ea;
+    CALLENTER(c, c->pc, c->sp);
 }
 
-static void lda() {
-    penaltyop = 1;
-    value = getvalue();
-    a = (uint8_t)(value & 0x00FF);
+static void lda(cpu6502_t *c) {
+    c->penaltyop = 1;
+    c->value = getvalue(c);
+    c->a = (uint8_t)(c->value & 0x00FF);
    
-    zerocalc(a);
-    signcalc(a);
+    zerocalc(c->a);
+    signcalc(c->a);
 }
 
-static void ldx() {
-    penaltyop = 1;
-    value = getvalue();
-    x = (uint8_t)(value & 0x00FF);
+static void ldx(cpu6502_t *c) {
+    c->penaltyop = 1;
+    c->value = getvalue(c);
+    c->x = (uint8_t)(c->value & 0x00FF);
    
-    zerocalc(x);
-    signcalc(x);
+    zerocalc(c->x);
+    signcalc(c->x);
 }
 
-static void ldy() {
-    penaltyop = 1;
-    value = getvalue();
-    y = (uint8_t)(value & 0x00FF);
+static void ldy(cpu6502_t *c) {
+    c->penaltyop = 1;
+    c->value = getvalue(c);
+    c->y = (uint8_t)(c->value & 0x00FF);
    
-    zerocalc(y);
-    signcalc(y);
+    zerocalc(c->y);
+    signcalc(c->y);
 }
 
-static void lsr() {
-    value = getvalue();
-    result = value >> 1;
+static void lsr(cpu6502_t *c) {
+    c->value = getvalue(c);
+    c->result = c->value >> 1;
    
-    if (value & 1) setcarry();
-        else clearcarry();
-    zerocalc(result);
-    signcalc(result);
+    if (c->value & 1) setcarry(c);
+        else clearcarry(c);
+    zerocalc(c->result);
+    signcalc(c->result);
    
-    putvalue(result);
+    putvalue(c, c->result);
 }
 
-static void nop() {
-    switch (opcode) {
+static void nop(cpu6502_t *c) {
+    switch (c->opcode) {
         case 0x1C:
         case 0x3C:
         case 0x5C:
         case 0x7C:
         case 0xDC:
         case 0xFC:
-            penaltyop = 1;
+            c->penaltyop = 1;
             break;
     }
 }
 
-static void ora() {
-    penaltyop = 1;
-    value = getvalue();
-    result = (uint16_t)a | value;
+static void wai(cpu6502_t *c) { //65C02 WAI, sleep until an interrupt
+    c->waiting = 1;
+}
+
+static void ora(cpu6502_t *c) {
+    c->penaltyop = 1;
+    c->value = getvalue(c);
+    c->result = (uint16_t)c->a | c->value;
    
-    zerocalc(result);
-    signcalc(result);
+    zerocalc(c->result);
+    signcalc(c->result);
    
-    saveaccum(result);
+    saveaccum(c->result);
 }
 
-static void pha() {
-    push8(a);
+static void pha(cpu6502_t *c) {
+    push8(c, c->a);
 }
 
-static void php() {
-    push8(status | FLAG_BREAK);
+static void php(cpu6502_t *c) {
+    push8(c, c->status | FLAG_BREAK);
 }
 
-static void pla() {
-    a = pull8();
+static void pla(cpu6502_t *c) {
+    c->a = pull8(c);
    
-    zerocalc(a);
-    signcalc(a);
+    zerocalc(c->a);
+    signcalc(c->a);
 }
 
-static void plp() {
-    status = pull8() | FLAG_CONSTANT;
+static void plp(cpu6502_t *c) {
+    c->status = pull8(c) | FLAG_CONSTANT;
 }
 
-static void rol() {
-    value = getvalue();
-    result = (value << 1) | (status & FLAG_CARRY);
+static void rol(cpu6502_t *c) {
+    c->value = getvalue(c);
+    c->result = (c->value << 1) | (c->status & FLAG_CARRY);
    
-    carrycalc(result);
-    zerocalc(result);
-    signcalc(result);
+    carrycalc(c->result);
+    zerocalc(c->result);
+    signcalc(c->result);
    
-    putvalue(result);
+    putvalue(c, c->result);
 }
 
-static void ror() {
-    value = getvalue();
-    result = (value >> 1) | ((status & FLAG_CARRY) << 7);
+static void ror(cpu6502_t *c) {
+    c->value = getvalue(c);
+    c->result = (c->value >> 1) | ((c->status & FLAG_CARRY) << 7);
    
-    if (value & 1) setcarry();
-        else clearcarry();
-    zerocalc(result);
-    signcalc(result);
+    if (c->value & 1) setcarry(c);
+        else clearcarry(c);
+    zerocalc(c->result);
+    signcalc(c->result);
    
-    putvalue(result);
+    putvalue(c, c->result);
 }
 
-static void rti() {
-    status = pull8();
-    value = pull16();
-    pc = value;
+static void rti(cpu6502_t *c) {
+    c->status = pull8(c);
+    c->value = pull16(c);
+    c->pc = c->value;
+    CALLLEAVE(c, c->sp, 6);
 }
 
-static void rts() {
-    value = pull16();
-    pc = value + 1;
+static void rts(cpu6502_t *c) {
+    c->value = pull16(c);
+    c->pc = c->value + 1;
+    CALLLEAVE(c, c->sp, 6);
 }
 
-static void sbc() {
-    penaltyop = 1;
-    value = getvalue() ^ 0x00FF;
-    result = (uint16_t)a + value + (uint16_t)(status & FLAG_CARRY);
+static void sbc(cpu6502_t *c) {
+    uint8_t carry = c->status & FLAG_CARRY;
+    c->penaltyop = 1;
+    c->value = getvalue(c) ^ 0x00FF;
+    c->result = (uint16_t)c->a + c->value + (uint16_t)carry;
    
-    carrycalc(result);
-    zerocalc(result);
-    overflowcalc(result, a, value);
-    signcalc(result);
+    carrycalc(c->result);
+    zerocalc(c->result);
+    overflowcalc(c->result, c->a, c->value);
+    signcalc(c->result);
 
     #ifndef NES_CPU
-    if (status & FLAG_DECIMAL) {
-        clearcarry();
-        
-        a -= 0x66;
-        if ((a & 0x0F) > 0x09) {
-            a += 0x06;
-        }
-        if ((a & 0xF0) > 0x90) {
-            a += 0x60;
-            setcarry();
-        }
-        
-        clockticks6502++;
+    if (c->status & FLAG_DECIMAL) {
+        uint8_t value = c->value ^ 0x00FF;
+        uint8_t lo = sbclo[16 + (c->a & 0x0F) - (value & 0x0F) + carry - 1];
+        c->result = sbchi[DECIMAL_HIGH(c->a, value, lo)] | DECIMAL_LOW(lo);
     }
     #endif
    
-    saveaccum(result);
+    saveaccum(c->result);
 }
 
-static void sec() {
-    setcarry();
+static void sec(cpu6502_t *c) {
+    setcarry(c);
 }
 
-static void sed() {
-    setdecimal();
+static void sed(cpu6502_t *c) {
+    setdecimal(c);
 }
 
-static void sei() {
-    setinterrupt();
+static void sei(cpu6502_t *c) {
+    setinterrupt(c);
 }
 
-static void sta() {
-    putvalue(a);
+static void sta(cpu6502_t *c) {
+    putvalue(c, c->a);
 }
 
-static void stx() {
-    putvalue(x);
+static void stx(cpu6502_t *c) {
+    putvalue(c, c->x);
 }
 
-static void sty() {
-    putvalue(y);
+static void sty(cpu6502_t *c) {
+    putvalue(c, c->y);
 }
 
-static void tax() {
-    x = a;
+static void tax(cpu6502_t *c) {
+    c->x = c->a;
    
-    zerocalc(x);
-    signcalc(x);
+    zerocalc(c->x);
+    signcalc(c->x);
 }
 
-static void tay() {
-    y = a;
+static void tay(cpu6502_t *c) {
+    c->y = c->a;
    
-    zerocalc(y);
-    signcalc(y);
+    zerocalc(c->y);
+    signcalc(c->y);
 }
 
-static void tsx() {
-    x = sp;
+static void tsx(cpu6502_t *c) {
+    c->x = c->sp;
    
-    zerocalc(x);
-    signcalc(x);
+    zerocalc(c->x);
+    signcalc(c->x);
 }
 
-static void txa() {
-    a = x;
+static void txa(cpu6502_t *c) {
+    c->a = c->x;
    
-    zerocalc(a);
-    signcalc(a);
+    zerocalc(c->a);
+    signcalc(c->a);
 }
 
-static void txs() {
-    sp = x;
+static void txs(cpu6502_t *c) {
+    c->sp = c->x;
 }
 
-static void tya() {
-    a = y;
+static void tya(cpu6502_t *c) {
+    c->a = c->y;
    
-    zerocalc(a);
-    signcalc(a);
+    zerocalc(c->a);
+    signcalc(c->a);
 }
 
 //undocumented instructions
 #ifdef UNDOCUMENTED
-    static void lax() {
-        lda();
-        ldx();
+    static void lax(cpu6502_t *c) {
+        lda(c);
+        ldx(c);
     }
 
-    static void sax() {
-        sta();
-        stx();
-        putvalue(a & x);
-        if (penaltyop && penaltyaddr) clockticks6502--;
+    static void sax(cpu6502_t *c) {
+        sta(c);
+        stx(c);
+        putvalue(c, c->a & c->x);
+        if (c->penaltyop && c->penaltyaddr) c->clockticks6502--;
     }
 
-    static void dcp() {
-        dec();
-        cmp();
-        if (penaltyop && penaltyaddr) clockticks6502--;
+    static void dcp(cpu6502_t *c) {
+        dec(c);
+        cmp(c);
+        if (c->penaltyop && c->penaltyaddr) c->clockticks6502--;
     }
 
-    static void isb() {
-        inc();
-        sbc();
-        if (penaltyop && penaltyaddr) clockticks6502--;
+    static void isb(cpu6502_t *c) {
+        inc(c);
+        sbc(c);
+        if (c->penaltyop && c->penaltyaddr) c->clockticks6502--;
     }
 
-    static void slo() {
-        asl();
-        ora();
-        if (penaltyop && penaltyaddr) clockticks6502--;
+    static void slo(cpu6502_t *c) {
+        asl(c);
+        ora(c);
+        if (c->penaltyop && c->penaltyaddr) c->clockticks6502--;
     }
 
-    static void rla() {
-        rol();
-        and();
-        if (penaltyop && penaltyaddr) clockticks6502--;
+    static void rla(cpu6502_t *c) {
+        rol(c);
+        and(c);
+        if (c->penaltyop && c->penaltyaddr) c->clockticks6502--;
     }
 
-    static void sre() {
-        lsr();
-        eor();
-        if (penaltyop && penaltyaddr) clockticks6502--;
+    static void sre(cpu6502_t *c) {
+        lsr(c);
+        eor(c);
+        if (c->penaltyop && c->penaltyaddr) c->clockticks6502--;
     }
 
-    static void rra() {
-        ror();
-        adc();
-        if (penaltyop && penaltyaddr) clockticks6502--;
+    static void rra(cpu6502_t *c) {
+        ror(c);
+        adc(c);
+        if (c->penaltyop && c->penaltyaddr) c->clockticks6502--;
     }
 #else
     #define lax nop
@@ -822,7 +1265,7 @@ static void tya() {
 #endif
 
 
-static void (*addrtable[256])() = {
+static void (*addrtable[256])(cpu6502_t *c) = {
 /*        |  0  |  1  |  2  |  3  |  4  |  5  |  6  |  7  |  8  |  9  |  A  |  B  |  C  |  D  |  E  |  F  |     */
 /* 0 */     imp, indx,  imp, indx,   zp,   zp,   zp,   zp,  imp,  imm,  acc,  imm, abso, abso, abso, abso, /* 0 */
 /* 1 */     rel, indy,  imp, indy,  zpx,  zpx,  zpx,  zpx,  imp, absy,  imp, absy, absx, absx, absx, absx, /* 1 */
@@ -836,13 +1279,13 @@ static void (*addrtable[256])() = {
 /* 9 */     rel, indy,  imp, indy,  zpx,  zpx,  zpy,  zpy,  imp, absy,  imp, absy, absx, absx, absy, absy, /* 9 */
 /* A */     imm, indx,  imm, indx,   zp,   zp,   zp,   zp,  imp,  imm,  imp,  imm, abso, abso, abso, abso, /* A */
 /* B */     rel, indy,  imp, indy,  zpx,  zpx,  zpy,  zpy,  imp, absy,  imp, absy, absx, absx, absy, absy, /* B */
-/* C */     imm, indx,  imm, indx,   zp,   zp,   zp,   zp,  imp,  imm,  imp,  imm, abso, abso, abso, abso, /* C */
+/* C */     imm, indx,  imm, indx,   zp,   zp,   zp,   zp,  imp,  imm,  imp,  imp, abso, abso, abso, abso, /* C */
 /* D */     rel, indy,  imp, indy,  zpx,  zpx,  zpx,  zpx,  imp, absy,  imp, absy, absx, absx, absx, absx, /* D */
 /* E */     imm, indx,  imm, indx,   zp,   zp,   zp,   zp,  imp,  imm,  imp,  imm, abso, abso, abso, abso, /* E */
 /* F */     rel, indy,  imp, indy,  zpx,  zpx,  zpx,  zpx,  imp, absy,  imp, absy, absx, absx, absx, absx  /* F */
 };
 
-static void (*optable[256])() = {
+static void (*optable[256])(cpu6502_t *c) = {
 /*        |  0  |  1  |  2  |  3  |  4  |  5  |  6  |  7  |  8  |  9  |  A  |  B  |  C  |  D  |  E  |  F  |      */
 /* 0 */      brk,  ora,  nop,  slo,  nop,  ora,  asl,  slo,  php,  ora,  asl,  nop,  nop,  ora,  asl,  slo, /* 0 */
 /* 1 */      bpl,  ora,  nop,  slo,  nop,  ora,  asl,  slo,  clc,  ora,  nop,  slo,  nop,  ora,  asl,  slo, /* 1 */
@@ -856,7 +1299,7 @@ static void (*optable[256])() = {
 /* 9 */      bcc,  sta,  nop,  nop,  sty,  sta,  stx,  sax,  tya,  sta,  txs,  nop,  nop,  sta,  nop,  nop, /* 9 */
 /* A */      ldy,  lda,  ldx,  lax,  ldy,  lda,  ldx,  lax,  tay,  lda,  tax,  nop,  ldy,  lda,  ldx,  lax, /* A */
 /* B */      bcs,  lda,  nop,  lax,  ldy,  lda,  ldx,  lax,  clv,  lda,  tsx,  lax,  ldy,  lda,  ldx,  lax, /* B */
-/* C */      cpy,  cmp,  nop,  dcp,  cpy,  cmp,  dec,  dcp,  iny,  cmp,  dex,  nop,  cpy,  cmp,  dec,  dcp, /* C */
+/* C */      cpy,  cmp,  nop,  dcp,  cpy,  cmp,  dec,  dcp,  iny,  cmp,  dex,  wai,  cpy,  cmp,  dec,  dcp, /* C */
 /* D */      bne,  cmp,  nop,  dcp,  nop,  cmp,  dec,  dcp,  cld,  cmp,  nop,  dcp,  nop,  cmp,  dec,  dcp, /* D */
 /* E */      cpx,  sbc,  nop,  isb,  cpx,  sbc,  inc,  isb,  inx,  sbc,  nop,  sbc,  cpx,  sbc,  inc,  isb, /* E */
 /* F */      beq,  sbc,  nop,  isb,  nop,  sbc,  inc,  isb,  sed,  sbc,  nop,  isb,  nop,  sbc,  inc,  isb  /* F */
@@ -876,73 +1319,554 @@ static const uint32_t ticktable[256] = {
 /* 9 */      2,    6,    2,    6,    4,    4,    4,    4,    2,    5,    2,    5,    5,    5,    5,    5,  /* 9 */
 /* A */      2,    6,    2,    6,    3,    3,    3,    3,    2,    2,    2,    2,    4,    4,    4,    4,  /* A */
 /* B */      2,    5,    2,    5,    4,    4,    4,    4,    2,    4,    2,    4,    4,    4,    4,    4,  /* B */
-/* C */      2,    6,    2,    8,    3,    3,    5,    5,    2,    2,    2,    2,    4,    4,    6,    6,  /* C */
+/* C */      2,    6,    2,    8,    3,    3,    5,    5,    2,    2,    2,    3,    4,    4,    6,    6,  /* C */
 /* D */      2,    5,    2,    8,    4,    4,    6,    6,    2,    4,    2,    7,    4,    4,    7,    7,  /* D */
 /* E */      2,    6,    2,    8,    3,    3,    5,    5,    2,    2,    2,    2,    4,    4,    6,    6,  /* E */
 /* F */      2,    5,    2,    8,    4,    4,    6,    6,    2,    4,    2,    7,    4,    4,    7,    7   /* F */
 };
 
 
-void nmi6502() {
-    push16(pc);
-    push8(status);
-    status |= FLAG_INTERRUPT;
-    pc = (uint16_t)read6502(0xFFFA) | ((uint16_t)read6502(0xFFFB) << 8);
+//run up to budget instructions, and only while the tick goal is ahead if
+//ticklimit is set
+static cpu6502_stop_t legacy6502(cpu6502_t *c, uint32_t budget, uint8_t ticklimit) {
+    cpu6502_stop_t reason = CPU6502_STOP_BUDGET;
+    uint8_t resume = c->breakresume && c->breakresumepc == c->pc;
+
+    c->breakresume = 0;
+    if (c->waiting && !wake6502(c)) return CPU6502_STOP_WAIT;
+
+    while (budget && (!ticklimit || c->clockticks6502 < c->clockgoal6502)) {
+        if (c->events || c->nbreakpoints) {
+            uint16_t vector;
+            reason = checkstop(c, c->pc, resume);
+            if (reason != CPU6502_STOP_BUDGET) break;
+            vector = takeinterrupt(c, c->status);
+            if (vector) {
+                push16(c, c->pc);
+                push8(c, (c->status & ~FLAG_BREAK) | FLAG_CONSTANT);
+                setinterrupt(c);
+                c->pc = (uint16_t)read6502(c, vector) | ((uint16_t)read6502(c, vector + 1) << 8);
+                CALLENTER(c, c->pc, c->sp);
+                c->clockticks6502 += 7;
+                resume = 0;
+                continue;
+            }
+        }
+        resume = 0;
+        TRACE(c, c->pc, c->a, c->x, c->y, c->sp, c->status);
+#ifdef FAKE6502_PROFILE
+        uint32_t profileticks = c->clockticks6502;
+#endif
+
+        c->opcode = read6502(c, c->pc++);
+        c->status |= FLAG_CONSTANT;
+
+        c->penaltyop = 0;
+        c->penaltyaddr = 0;
+
+        (*addrtable[c->opcode])(c);
+        (*optable[c->opcode])(c);
+        c->clockticks6502 += ticktable[c->opcode];
+        if (c->penaltyop && c->penaltyaddr) c->clockticks6502++;
+#ifdef FAKE6502_PROFILE
+        if (c->profile) profile6502(c->profile, c->opcode, c->clockticks6502 - profileticks,
+                                    c->penaltyop && c->penaltyaddr);
+#endif
+
+        c->instructions++;
+
+        if (c->loopexternal) (*c->loopexternal)(c);
+
+        budget--;
+        if (c->waiting) {
+            reason = CPU6502_STOP_WAIT;
+            break;
+        }
+    }
+    if (reason == CPU6502_STOP_BREAKPOINT) {
+        c->breakresume = 1;
+        c->breakresumepc = c->pc;
+    }
+    return reason;
+}
+
+cpu6502_stop_t run6502(cpu6502_t *c, uint32_t budget) {
+    return legacy6502(c, budget, 0);
+}
+
+cpu6502_stop_t exec6502(cpu6502_t *c, uint32_t tickcount) {
+    c->clockgoal6502 += tickcount;
+    return legacy6502(c, UINT32_MAX, 1);
 }
 
-void irq6502() {
-    push16(pc);
-    push8(status);
-    status |= FLAG_INTERRUPT;
-    pc = (uint16_t)read6502(0xFFFE) | ((uint16_t)read6502(0xFFFF) << 8);
+void step6502(cpu6502_t *c) {
+    c->breakresume = 1; //always runs the instruction
+    c->breakresumepc = c->pc;
+    legacy6502(c, 1, 0);
+    c->clockgoal6502 = c->clockticks6502;
 }
 
-uint8_t callexternal = 0;
-void (*loopexternal)();
+#else //FAKE6502_LEGACY_CORE
 
-void exec6502(uint32_t tickcount) {
-    clockgoal6502 += tickcount;
-   
-    while (clockticks6502 < clockgoal6502) {
-        opcode = read6502(pc++);
+//fused single-dispatch core. every opcode is one switch case generated from
+//fake6502_opcodes.h, with its addressing mode and operation expanded inline.
+//the cycle exact and FAKE6502_FAST variants expand the same table and only
+//differ in the TICKS() and PAGECROSS() bookkeeping macros.
+//the registers live in locals for the whole run and are written back on exit
+//or before the external hook is called.
+#ifdef UNDOCUMENTED
+    #error "UNDOCUMENTED opcodes are only implemented by FAKE6502_LEGACY_CORE"
+#endif
+
+//cycle bookkeeping, compiled out entirely in the fast variant
+#ifdef FAKE6502_FAST
+#define TICKS(n)
+#define PAGECROSS(cond)
+#define PENALTY(penalty) 0
+#else
+#define TICKS(n) cpu->clockticks6502 += (n)
+#define PAGECROSS(cond) pagecross = (cond)
+#define PENALTY(penalty) ((penalty) & pagecross)
+#endif
+
+//profiler counting, ticks are measured from profileticks on
+#ifdef FAKE6502_PROFILE
+#define PROFILE(code, penalty) if (cpu->profile) {\
+    profile6502(cpu->profile, code, cpu->clockticks6502 - profileticks, penalty);\
+    profileticks = cpu->clockticks6502;\
+}
+#else
+#define PROFILE(code, penalty)
+#endif
+
+#define READ(addr) read6502(cpu, addr)
+#define READLOW(addr) readlow6502(cpu, addr)
+#define READ16(addr) ((uint16_t)READ(addr) | ((uint16_t)READ((uint16_t)((addr) + 1)) << 8))
+//writes into the cached region drop the decoded instructions they overlap
+#define WRITE(addr, val) {\
+    uint16_t waddr = (addr);\
+    write6502(cpu, waddr, (val));\
+    if (waddr >= FAKE6502_DCACHE_START) cpu6502_invalidate(cpu, waddr, 1);\
+}
+
+//the stack page is never cached, so pushes skip the invalidation
+#define PUSH8(val) writelow6502(cpu, BASE_STACK + sp--, (val))
+#define PUSH16(val) {\
+    writelow6502(cpu, BASE_STACK + sp, ((val) >> 8) & 0xFF);\
+    writelow6502(cpu, BASE_STACK + ((sp - 1) & 0xFF), (val) & 0xFF);\
+    sp -= 2;\
+}
+#define PULL8() READLOW(BASE_STACK + ++sp)
+#define PULL16(dst) {\
+    dst = READLOW(BASE_STACK + ((sp + 1) & 0xFF)) | ((uint16_t)READLOW(BASE_STACK + ((sp + 2) & 0xFF)) << 8);\
+    sp += 2;\
+}
+
+//lazy flags. N, Z, C and V are not kept in status while running, only the
+//values they derive from: N is bit 7 of nres, Z is set when zres is zero, C
+//is cflag and V is bit 7 of vres. status holds the remaining bits and the
+//flags are packed back by STATUS() only where the byte is observed.
+#define FLAGS_NZ(n) nres = zres = (uint8_t)(n)
+#define STATUS() ((status & ~(FLAG_SIGN | FLAG_ZERO | FLAG_CARRY | FLAG_OVERFLOW)) |\
+    (nres & FLAG_SIGN) | (zres ? 0 : FLAG_ZERO) | cflag | ((vres & 0x80) >> 1))
+#define SET_STATUS(p) {\
+    status = (p);\
+    nres = status;\
+    zres = !(status & FLAG_ZERO);\
+    cflag = status & FLAG_CARRY;\
+    vres = (status & FLAG_OVERFLOW) << 1;\
+}
+
+//operand bytes of the instruction at addr with the given length
+#define OPERAND(addr, length) ((length) > 2 ? READ16((uint16_t)((addr) + 1)) :\
+    (length) > 1 ? READ((uint16_t)((addr) + 1)) : 0)
+
+//fetch the instruction at pc into d, pc itself is left alone
+#define DECODE(d) {\
+    (d).handler = READ(pc);\
+    (d).length = oplength[(d).handler];\
+    (d).operand = OPERAND(pc, (d).length);\
+    (d).operand2 = 0;\
+}
+
+//superinstructions: the pair id, then opcode, operation, addressing mode,
+//ticks and page crossing penalty of both instructions as in fake6502_opcodes.h
+#define FUSIONS \
+    FUSION(CPU6502_FUSE_DEX_BNE, 0xCA, DEX, IMP,  2, 0, 0xD0, BNE, REL,  2, 0) \
+    FUSION(CPU6502_FUSE_DEY_BNE, 0x88, DEY, IMP,  2, 0, 0xD0, BNE, REL,  2, 0) \
+    FUSION(CPU6502_FUSE_LDA_STA, 0xBD, LDA, ABSX, 4, 1, 0x99, STA, ABSY, 5, 0) \
+    FUSION(CPU6502_FUSE_INC_BNE, 0xE6, INC, ZP,   5, 0, 0xD0, BNE, REL,  2, 0) \
+    FUSION(CPU6502_FUSE_CMP_BEQ, 0xC9, CMP, IMM,  2, 0, 0xF0, BEQ, REL,  2, 0)
+
+//fill a decode cache entry for pc, turning the instruction into a
+//superinstruction when it starts one of the FUSIONS pairs. only cached code
+//is fused since the pair is looked at once per fill, not per execution.
+static void decodeentry(cpu6502_t *cpu, uint16_t pc, cpu6502_decoded_t *entry) {
+    uint16_t next;
+    DECODE(*entry);
+    entry->pc = pc;
+    if (pc > 0xFFFF - 6) return; //keep both halves inside the cached region
+    next = pc + entry->length;
+    switch (entry->handler) {
+        #define FUSION(id, code1, op1, mode1, ticks1, penalty1, code2, op2, mode2, ticks2, penalty2) \
+            case code1:\
+                if (READ(next) == code2) {\
+                    entry->operand2 = OPERAND(next, LENGTH_##mode2);\
+                    entry->handler = CPU6502_HANDLER_FUSED + id;\
+                    return;\
+                }\
+                break;
+        FUSIONS
+        #undef FUSION
+    }
+}
+
+//addressing modes, leave the effective address in ea. the operand bytes
+//were already fetched by DECODE() and pc points at the next instruction.
+#define ADDR_IMP
+#define ADDR_ACC
+#define ADDR_IMM
+#define ADDR_ZP   ea = operand;
+#define ADDR_ZPX  ea = (operand + x) & 0xFF;
+#define ADDR_ZPY  ea = (operand + y) & 0xFF;
+#define ADDR_REL  ea = (uint16_t)(int8_t)operand;
+#define ADDR_ABSO ea = operand;
+#define ADDR_ABSX ea = operand; PAGECROSS(((ea + x) ^ ea) > 0xFF); ea += x;
+#define ADDR_ABSY ea = operand; PAGECROSS(((ea + y) ^ ea) > 0xFF); ea += y;
+#define ADDR_IND  ea = READ(operand) | ((uint16_t)READ((operand & 0xFF00) | ((operand + 1) & 0x00FF)) << 8);
+#define ADDR_INDX {\
+    uint16_t eahelp = (operand + x) & 0xFF;\
+    ea = READLOW(eahelp) | ((uint16_t)READLOW((eahelp + 1) & 0xFF) << 8);\
+}
+#define ADDR_INDY {\
+    ea = READLOW(operand) | ((uint16_t)READLOW((operand + 1) & 0xFF) << 8);\
+    PAGECROSS(((ea + y) ^ ea) > 0xFF);\
+    ea += y;\
+}
+
+//value read by an instruction, immediates come straight from the operand
+#define LOAD(mode) LOAD_##mode
+#define LOAD_IMM  ((uint8_t)operand)
+#define LOAD_ZP   READLOW(ea)
+#define LOAD_ZPX  READLOW(ea)
+#define LOAD_ZPY  READLOW(ea)
+#define LOAD_ABSO READ(ea)
+#define LOAD_ABSX READ(ea)
+#define LOAD_ABSY READ(ea)
+#define LOAD_INDX READ(ea)
+#define LOAD_INDY READ(ea)
+
+//memory operand of the read-modify-write, BIT and store operations, the zero
+//page modes take the zero page path
+#define LOWMODE_IMP  0
+#define LOWMODE_ACC  0
+#define LOWMODE_IMM  0
+#define LOWMODE_ZP   1
+#define LOWMODE_ZPX  1
+#define LOWMODE_ZPY  1
+#define LOWMODE_REL  0
+#define LOWMODE_ABSO 0
+#define LOWMODE_ABSX 0
+#define LOWMODE_ABSY 0
+#define LOWMODE_IND  0
+#define LOWMODE_INDX 0
+#define LOWMODE_INDY 0
+#define MREAD(m) (LOWMODE_##m ? READLOW(ea) : READ(ea))
+#define MWRITE(m, val) { if (LOWMODE_##m) writelow6502(cpu, ea, (val)); else WRITE(ea, (val)) }
+
+//operations, ea holds the operand address (or sign extended offset for REL)
+//and m is the addressing mode
+#define BRANCH(cond) if (cond) {\
+    TICKS(((pc ^ (uint16_t)(pc + ea)) & 0xFF00) ? 2 : 1);\
+    pc += ea;\
+    if ((uint16_t)(ea + 5) <= 3 && IDLE_OK) {\
+        uint8_t loopticks = idleloop(cpu, pc, ea);\
+        if (loopticks) IDLE(loopticks);\
+    }\
+}
+#define COMPARE(reg, m) {\
+    uint8_t value = LOAD(m);\
+    cflag = reg >= value;\
+    FLAGS_NZ(reg - value);\
+}
+//binary add shared by ADC and SBC (value already inverted for SBC)
+#define ADD(val) {\
+    uint16_t addend = (val);\
+    uint16_t result = (uint16_t)a + addend + cflag;\
+    cflag = result >> 8;\
+    vres = (result ^ a) & (result ^ addend);\
+    FLAGS_NZ(result);\
+    a = (uint8_t)result;\
+}
+
+#ifndef NES_CPU
+#define OP_ADC(m) {\
+    uint8_t value = LOAD(m);\
+    if (status & FLAG_DECIMAL) {\
+        uint8_t lo = adclo[(a & 0x0F) + (value & 0x0F) + cflag];\
+        uint16_t hi = adchi[DECIMAL_HIGH(a, value, lo)];\
+        zres = a + value + cflag;\
+        nres = hi >> 8;\
+        vres = (hi >> 8) << 1;\
+        cflag = (hi >> 8) & FLAG_CARRY;\
+        a = (hi & 0xF0) | DECIMAL_LOW(lo);\
+    } else ADD(value)\
+}
+#define OP_SBC(m) {\
+    uint8_t value = LOAD(m), olda = a, carry = cflag;\
+    ADD(value ^ 0x00FF);\
+    if (status & FLAG_DECIMAL) {\
+        uint8_t lo = sbclo[16 + (olda & 0x0F) - (value & 0x0F) + carry - 1];\
+        a = sbchi[DECIMAL_HIGH(olda, value, lo)] | DECIMAL_LOW(lo);\
+    }\
+}
+#else
+#define OP_ADC(m) ADD(LOAD(m))
+#define OP_SBC(m) ADD(LOAD(m) ^ 0x00FF)
+#endif
+#define OP_AND(m)  a &= LOAD(m); FLAGS_NZ(a);
+#define OP_ORA(m)  a |= LOAD(m); FLAGS_NZ(a);
+#define OP_EOR(m)  a ^= LOAD(m); FLAGS_NZ(a);
+#define OP_ASL(m)  { uint8_t value = MREAD(m); cflag = value >> 7; value <<= 1; FLAGS_NZ(value); MWRITE(m, value); }
+#define OP_ASLA(m) cflag = a >> 7; a <<= 1; FLAGS_NZ(a);
+#define OP_LSR(m)  { uint8_t value = MREAD(m); cflag = value & 1; value >>= 1; FLAGS_NZ(value); MWRITE(m, value); }
+#define OP_LSRA(m) cflag = a & 1; a >>= 1; FLAGS_NZ(a);
+#define OP_ROL(m)  {\
+    uint8_t value = MREAD(m), carry = cflag;\
+    cflag = value >> 7; value = (value << 1) | carry; FLAGS_NZ(value); MWRITE(m, value);\
+}
+#define OP_ROLA(m) { uint8_t carry = cflag; cflag = a >> 7; a = (a << 1) | carry; FLAGS_NZ(a); }
+#define OP_ROR(m)  {\
+    uint8_t value = MREAD(m), carry = cflag << 7;\
+    cflag = value & 1; value = (value >> 1) | carry; FLAGS_NZ(value); MWRITE(m, value);\
+}
+#define OP_RORA(m) { uint8_t carry = cflag << 7; cflag = a & 1; a = (a >> 1) | carry; FLAGS_NZ(a); }
+#define OP_BCC(m)  BRANCH(!cflag)
+#define OP_BCS(m)  BRANCH(cflag)
+#define OP_BEQ(m)  BRANCH(!zres)
+#define OP_BNE(m)  BRANCH(zres)
+#define OP_BMI(m)  BRANCH(nres & 0x80)
+#define OP_BPL(m)  BRANCH(!(nres & 0x80))
+#define OP_BVS(m)  BRANCH(vres & 0x80)
+#define OP_BVC(m)  BRANCH(!(vres & 0x80))
+#define OP_BIT(m)  {\
+    uint8_t value = MREAD(m);\
+    zres = a & value;\
+    nres = value;\
+    vres = value << 1;\
+}
+#define OP_BRK(m)  {\
+    pc++;\
+    PUSH16(pc);\
+    PUSH8(STATUS() | FLAG_BREAK);\
+    status |= FLAG_INTERRUPT;\
+    pc = READ16(0xFFFE);\
+    CALLENTER(cpu, pc, sp);\
+}
+#define OP_CLC(m)  cflag = 0;
+#define OP_CLD(m)  status &= ~FLAG_DECIMAL;
+#define OP_CLI(m)  status &= ~FLAG_INTERRUPT;
+#define OP_CLV(m)  vres = 0;
+#define OP_SEC(m)  cflag = 1;
+#define OP_SED(m)  status |= FLAG_DECIMAL;
+#define OP_SEI(m)  status |= FLAG_INTERRUPT;
+#define OP_CMP(m)  COMPARE(a, m)
+#define OP_CPX(m)  COMPARE(x, m)
+#define OP_CPY(m)  COMPARE(y, m)
+#define OP_DEC(m)  { uint8_t value = MREAD(m) - 1; FLAGS_NZ(value); MWRITE(m, value); }
+#define OP_INC(m)  { uint8_t value = MREAD(m) + 1; FLAGS_NZ(value); MWRITE(m, value); }
+#define OP_DEX(m)  x--; FLAGS_NZ(x);
+#define OP_DEY(m)  y--; FLAGS_NZ(y);
+#define OP_INX(m)  x++; FLAGS_NZ(x);
+#define OP_INY(m)  y++; FLAGS_NZ(y);
+#define OP_JMP(m)  if (ea == (uint16_t)(pc - 3) && IDLE_OK) IDLE(JMPTICKS_##m); pc = ea;
+#define OP_JSR(m)  PUSH16(pc - 1); pc = ea; CALLENTER(cpu, pc, sp);
+#define OP_LDA(m)  a = LOAD(m); FLAGS_NZ(a);
+#define OP_LDX(m)  x = LOAD(m); FLAGS_NZ(x);
+#define OP_LDY(m)  y = LOAD(m); FLAGS_NZ(y);
+#define OP_NOP(m)
+#define OP_PHA(m)  PUSH8(a);
+#define OP_PHP(m)  PUSH8(STATUS() | FLAG_BREAK);
+#define OP_PLA(m)  a = PULL8(); FLAGS_NZ(a);
+#define OP_PLP(m)  SET_STATUS(PULL8() | FLAG_CONSTANT);
+#define OP_RTI(m)  SET_STATUS(PULL8()); PULL16(pc); CALLLEAVE(cpu, sp, 6);
+#define OP_RTS(m)  PULL16(pc); pc++; CALLLEAVE(cpu, sp, 6);
+#define OP_STA(m)  MWRITE(m, a);
+#define OP_STX(m)  MWRITE(m, x);
+#define OP_STY(m)  MWRITE(m, y);
+#define OP_TAX(m)  x = a; FLAGS_NZ(x);
+#define OP_TAY(m)  y = a; FLAGS_NZ(y);
+#define OP_TSX(m)  x = sp; FLAGS_NZ(x);
+#define OP_TXA(m)  a = x; FLAGS_NZ(a);
+#define OP_TXS(m)  sp = x;
+#define OP_TYA(m)  a = y; FLAGS_NZ(a);
+//65C02 WAI, ends the run by using up the budget
+#define OP_WAI(m)  cpu->waiting = 1; reason = CPU6502_STOP_WAIT; budget = 1;
+
+//idle loops are only looked for by run6502() with idledetect set, and not
+//while a hook wants to see every instruction or an interrupt is pending
+#define IDLE_OK (!ticklimit && cpu->idledetect && !cpu->loopexternal && !cpu->events)
+//end the run after the current instruction, n ticks per loop iteration
+#define IDLE(n) { cpu->idleticks = (n); reason = CPU6502_STOP_IDLE; budget = 1; }
+#define JMPTICKS_ABSO 3
+#define JMPTICKS_IND  5
+
+//ticks per iteration if the branch just taken to pc, offset back from the
+//next instruction, closes an idle loop: a branch to itself, or a zero page or
+//absolute load followed by the branch. nothing in such a loop writes, so it
+//spins until an interrupt, a device or the host changes what it reads.
+//0 if the loop is not idle.
+static uint8_t idleloop(cpu6502_t *cpu, uint16_t pc, uint16_t offset) {
+    uint8_t branchticks = (((uint16_t)(pc - offset) ^ pc) & 0xFF00) ? 4 : 3;
+    if (offset == 0xFFFE) return branchticks;
+    switch (READ(pc)) {
+        case 0xA5: case 0xA6: case 0xA4: case 0x24: //LDA, LDX, LDY, BIT zp
+            if (offset == 0xFFFC) return 3 + branchticks;
+            break;
+        case 0xAD: case 0xAE: case 0xAC: case 0x2C: //LDA, LDX, LDY, BIT abs
+            if (offset == 0xFFFB) return 4 + branchticks;
+            break;
+    }
+    return 0;
+}
+
+//true when nothing would stop the run or look at the state between the two
+//halves of a superinstruction
+#define FUSE_OK (budget > 1 && !cpu->events && !cpu->nbreakpoints && !cpu->loopexternal &&\
+    (!ticklimit || cpu->clockticks6502 < cpu->clockgoal6502))
+
+//run up to budget instructions, and only while the tick goal is ahead if
+//ticklimit is set. the constant ticklimit argument lets the compiler drop
+//the tick check from run6502()
+static inline cpu6502_stop_t core6502(cpu6502_t *cpu, uint32_t budget, const uint8_t ticklimit) {
+    cpu6502_stop_t reason = CPU6502_STOP_BUDGET;
+    uint8_t resume = cpu->breakresume && cpu->breakresumepc == cpu->pc;
+    uint16_t pc = cpu->pc;
+    uint8_t sp = cpu->sp, a = cpu->a, x = cpu->x, y = cpu->y;
+    uint8_t status, nres, zres, cflag, vres;
+
+    cpu->breakresume = 0;
+    if (cpu->waiting && !wake6502(cpu)) return CPU6502_STOP_WAIT;
+    SET_STATUS(cpu->status);
+    cpu->idleticks = 0;
+
+    while (budget && (!ticklimit || cpu->clockticks6502 < cpu->clockgoal6502)) {
+        uint16_t ea = 0;
+#ifndef FAKE6502_FAST
+        uint8_t pagecross = 0;
+#endif
+        cpu6502_decoded_t decoded;
+        uint16_t operand;
+
+        if (cpu->events || cpu->nbreakpoints) {
+            uint16_t vector;
+            reason = checkstop(cpu, pc, resume);
+            if (reason != CPU6502_STOP_BUDGET) break;
+            vector = takeinterrupt(cpu, status);
+            if (vector) {
+                //the handler starts with a fresh check, so a breakpoint on
+                //its first instruction is honoured
+                PUSH16(pc);
+                PUSH8((STATUS() & ~FLAG_BREAK) | FLAG_CONSTANT);
+                status |= FLAG_INTERRUPT;
+                pc = READ16(vector);
+                CALLENTER(cpu, pc, sp);
+                TICKS(7);
+                resume = 0;
+                continue;
+            }
+        }
+        resume = 0;
+        TRACE(cpu, pc, a, x, y, sp, STATUS());
+#ifdef FAKE6502_PROFILE
+        uint32_t profileticks = cpu->clockticks6502;
+#endif
+
+        //the operand of an instruction in the last two bytes wraps around
+        //into the zero page, which writes don't invalidate
+        if (pc >= FAKE6502_DCACHE_START && pc < 0xFFFE) {
+            cpu6502_decoded_t *entry = &cpu->dcache[pc & (FAKE6502_DCACHE_ENTRIES - 1)];
+            if (entry->pc != pc || !entry->length) decodeentry(cpu, pc, entry);
+            decoded = *entry;
+        } else {
+            DECODE(decoded);
+        }
+        pc += decoded.length;
+        operand = decoded.operand;
         status |= FLAG_CONSTANT;
 
-        penaltyop = 0;
-        penaltyaddr = 0;
+        switch (decoded.handler) {
+            #define OPCODE(code, op, mode, ticks, penalty) \
+                case code: {\
+                    ADDR_##mode OP_##op(mode) TICKS((ticks) + PENALTY(penalty));\
+                    PROFILE(code, PENALTY(penalty));\
+                } break;
+            #include "fake6502_opcodes.h"
+            #undef OPCODE
+            //the first instruction, then the second one only if the loop
+            //would have gone straight on to it. otherwise the second one runs
+            //on its own in the next iteration.
+            #define FUSION(id, code1, op1, mode1, ticks1, penalty1, code2, op2, mode2, ticks2, penalty2) \
+                case CPU6502_HANDLER_FUSED + id: {\
+                    ADDR_##mode1 OP_##op1(mode1) TICKS((ticks1) + PENALTY(penalty1));\
+                    PROFILE(code1, PENALTY(penalty1));\
+                    if (!FUSE_OK) break;\
+                    cpu->instructions++;\
+                    cpu->fusions[id]++;\
+                    budget--;\
+                    PAGECROSS(0);\
+                    TRACE(cpu, pc, a, x, y, sp, STATUS());\
+                    operand = decoded.operand2;\
+                    pc += LENGTH_##mode2;\
+                    ADDR_##mode2 OP_##op2(mode2) TICKS((ticks2) + PENALTY(penalty2));\
+                    PROFILE(code2, PENALTY(penalty2));\
+                } break;
+            FUSIONS
+            #undef FUSION
+        }
 
-        (*addrtable[opcode])();
-        (*optable[opcode])();
-        clockticks6502 += ticktable[opcode];
-        if (penaltyop && penaltyaddr) clockticks6502++;
+        cpu->instructions++;
 
-        instructions++;
+        if (cpu->loopexternal) {
+            cpu->pc = pc; cpu->sp = sp; cpu->a = a;
+            cpu->x = x; cpu->y = y; cpu->status = STATUS();
+            (*cpu->loopexternal)(cpu);
+            pc = cpu->pc; sp = cpu->sp; a = cpu->a;
+            x = cpu->x; y = cpu->y; SET_STATUS(cpu->status);
+        }
+        budget--;
+    }
 
-        if (callexternal) (*loopexternal)();
+    cpu->pc = pc; cpu->sp = sp; cpu->a = a;
+    cpu->x = x; cpu->y = y; cpu->status = STATUS();
+    if (reason == CPU6502_STOP_BREAKPOINT) {
+        cpu->breakresume = 1;
+        cpu->breakresumepc = pc;
     }
+    return reason;
+}
 
+cpu6502_stop_t run6502(cpu6502_t *cpu, uint32_t budget) {
+    return core6502(cpu, budget, 0);
 }
 
-void step6502() {
-    opcode = read6502(pc++);
-    status |= FLAG_CONSTANT;
+#ifndef FAKE6502_FAST
+cpu6502_stop_t exec6502(cpu6502_t *cpu, uint32_t tickcount) {
+    cpu->clockgoal6502 += tickcount;
+    return core6502(cpu, UINT32_MAX, 1);
+}
+#endif
 
-    penaltyop = 0;
-    penaltyaddr = 0;
+void step6502(cpu6502_t *cpu) {
+    cpu->breakresume = 1; //always runs the instruction
+    cpu->breakresumepc = cpu->pc;
+    core6502(cpu, 1, 0);
+    cpu->clockgoal6502 = cpu->clockticks6502;
+}
 
-    (*addrtable[opcode])();
-    (*optable[opcode])();
-    clockticks6502 += ticktable[opcode];
-    if (penaltyop && penaltyaddr) clockticks6502++;
-    clockgoal6502 = clockticks6502;
+#endif //FAKE6502_LEGACY_CORE
 
-    instructions++;
 
-    if (callexternal) (*loopexternal)();
+void hookexternal(cpu6502_t *c, void (*funcptr)(cpu6502_t *cpu)) {
+    c->loopexternal = funcptr;
 }
-
-void hookexternal(void *funcptr) {
-    if (funcptr != (void *)NULL) {
-        loopexternal = funcptr;
-        callexternal = 1;
-    } else callexternal = 0;
-}
\ No newline at end of file
@@ -3,19 +3,233 @@
 
 #include <stddef.h>
 #include <stdint.h>
-#include "fakemem.h"
 
+//build options
+//#define FAKE6502_LEGACY_CORE //when this is defined, the original interpreter
+                               //that calls through addrtable[] and optable[]
+                               //is built instead of the fused switch core.
 
-//6502 defines
-extern uint16_t *fake6502_pc;
-extern uint8_t *fake6502_sp; 
-extern uint8_t *fake6502_a;
-extern uint8_t *fake6502_x;
-extern uint8_t *fake6502_y;
-extern uint8_t *fake6502_status;
-extern uint32_t instructions; 
-// 0: running, 1: stopped, 2: step
-extern uint8_t fake6502_running_status;
+//#define FAKE6502_FAST        //when this is defined, the fused core is built
+                               //without cycle accounting. clockticks6502 stays
+                               //at zero and exec6502() is not available.
+
+//#define FAKE6502_PROFILE     //when this is defined, both engines count
+                               //executions and ticks per opcode and per
+                               //addressing mode into cpu6502_t.profile.
+
+//#define FAKE6502_CALLGRAPH   //when this is defined, JSR/RTS, BRK/RTI and
+                               //interrupts are tracked on a shadow call stack
+                               //into cpu6502_t.callgraph.
+
+//#define FAKE6502_TRACE       //when this is defined, both engines record
+                               //every instruction into cpu6502_t.trace.
+
+//#define FAKE6502_DIRECT_LOW_PAGES //when this is defined, both engines read
+                               //and write the zero page and the stack in
+                               //cpu6502_bus_t.lowpages instead of calling
+                               //the bus. only for a bus that keeps pages 0
+                               //and 1 as plain RAM there.
+#if defined(FAKE6502_LEGACY_CORE) && defined(FAKE6502_FAST)
+#error "FAKE6502_FAST is only supported by the fused core"
+#endif
+#if defined(FAKE6502_CALLGRAPH) && defined(FAKE6502_FAST)
+#error "FAKE6502_CALLGRAPH needs the clock ticks FAKE6502_FAST drops"
+#endif
+
+#ifdef FAKE6502_LEGACY_CORE
+#define FAKE6502_ENGINE "legacy"
+#elif defined(FAKE6502_FAST)
+#define FAKE6502_ENGINE "fused-fast"
+#else
+#define FAKE6502_ENGINE "fused"
+#endif
+
+#define CPU6502_MAX_BREAKPOINTS 4
+
+//decoded instruction cache of the fused core. instructions at or above
+//FAKE6502_DCACHE_START are decoded once and kept in a direct mapped table
+//indexed by the low bits of their address.
+#ifndef FAKE6502_DCACHE_START
+#define FAKE6502_DCACHE_START 0x8000
+#endif
+#ifndef FAKE6502_DCACHE_ENTRIES
+#define FAKE6502_DCACHE_ENTRIES 2048 //must be a power of two
+#endif
+#if FAKE6502_DCACHE_START < 0x0200
+#error "FAKE6502_DCACHE_START must be above the stack page"
+#endif
+
+//bits of cpu6502_t.events, the one word run6502() checks per instruction
+#define CPU6502_EVENT_STOP 0x01       //set by cpu6502_request_stop()
+#define CPU6502_EVENT_NMI  0x02       //NMI edge latched by nmi6502()
+#define CPU6502_EVENT_SAMPLE 0x04     //pc sample asked for by cpu6502_request_sample()
+#define CPU6502_EVENT_IRQ  0xFFFFFF00 //IRQ line, one bit per asserting source
+
+//bit of IRQ source n (0 to 23) for cpu6502_irq_assert()/cpu6502_irq_deassert()
+#define CPU6502_IRQ_SOURCE(n) (0x100UL << (n))
+
+//why run6502() returned
+typedef enum {
+  CPU6502_STOP_BUDGET = 0,  //the instruction budget is used up
+  CPU6502_STOP_BREAKPOINT,  //pc reached a breakpoint, not executed yet
+  CPU6502_STOP_REQUEST,     //cpu6502_request_stop() was called
+  CPU6502_STOP_WAIT,        //WAI executed, waiting for an interrupt
+  CPU6502_STOP_IDLE,        //pc is in a loop only outside input can end
+} cpu6502_stop_t;
+
+//instruction pairs the fused core runs as one superinstruction
+typedef enum {
+  CPU6502_FUSE_NONE = 0,
+  CPU6502_FUSE_DEX_BNE,
+  CPU6502_FUSE_DEY_BNE,
+  CPU6502_FUSE_LDA_STA,     //LDA abs,X then STA abs,Y
+  CPU6502_FUSE_INC_BNE,     //INC zp then BNE
+  CPU6502_FUSE_CMP_BEQ,     //CMP #imm then BEQ
+  CPU6502_FUSE_COUNT
+} cpu6502_fusion_t;
+
+//handler numbers of superinstructions, plain instructions use their opcode
+#define CPU6502_HANDLER_FUSED 0x100
+
+//addressing modes, in the order of the names in fake6502_opcodes.h
+typedef enum {
+  CPU6502_MODE_IMP = 0, CPU6502_MODE_ACC, CPU6502_MODE_IMM,
+  CPU6502_MODE_ZP, CPU6502_MODE_ZPX, CPU6502_MODE_ZPY, CPU6502_MODE_REL,
+  CPU6502_MODE_ABSO, CPU6502_MODE_ABSX, CPU6502_MODE_ABSY,
+  CPU6502_MODE_IND, CPU6502_MODE_INDX, CPU6502_MODE_INDY,
+  CPU6502_MODE_COUNT
+} cpu6502_mode_t;
+
+//counters of a FAKE6502_PROFILE build
+typedef struct {
+  uint32_t count;   //instructions executed
+  uint32_t ticks;   //clock ticks used, penalty ticks included
+  uint32_t penalty; //page crossing penalty ticks alone
+} cpu6502_profile_entry_t;
+
+typedef struct {
+  cpu6502_profile_entry_t opcodes[256];
+  cpu6502_profile_entry_t modes[CPU6502_MODE_COUNT];
+} cpu6502_profile_t;
+
+//call graph of a FAKE6502_CALLGRAPH build
+#ifndef CPU6502_CALLGRAPH_ROUTINES
+#define CPU6502_CALLGRAPH_ROUTINES 256 //must be a power of two
+#endif
+#define CPU6502_CALLGRAPH_DEPTH 64
+
+typedef struct {
+  uint16_t entry;     //address the routine was called at
+  uint32_t calls;     //calls entered, 0 marks a free entry
+  uint32_t inclusive; //ticks from the call to the return, callees included
+  uint32_t exclusive; //ticks spent in the routine itself
+} cpu6502_routine_t;
+
+typedef struct {
+  cpu6502_routine_t *routine; //NULL if the routine table was full
+  uint32_t start;             //clockticks6502 at the call
+  uint32_t callees;           //ticks of the calls it made
+  uint8_t sp;                 //stack pointer after the call pushed
+} cpu6502_callframe_t;
+
+typedef struct {
+  cpu6502_routine_t routines[CPU6502_CALLGRAPH_ROUTINES]; //hashed by entry
+  cpu6502_callframe_t frames[CPU6502_CALLGRAPH_DEPTH];
+  uint8_t depth;
+  uint32_t dropped; //calls not counted as the table or the stack was full
+} cpu6502_callgraph_t;
+
+//instruction trace of a FAKE6502_TRACE build. the buffer is a ring of
+//CPU6502_TRACE_CHUNK byte chunks, each starting with a full record so it
+//decodes on its own. a record describes one instruction before it runs:
+//  header  CPU6502_TRACE_PC_* in bits 0-1, CPU6502_TRACE_A.. bits for the
+//          registers that follow
+//  pc      none for PC_NEXT, a signed byte from the expected pc for PC_REL,
+//          two bytes for PC_ABS
+//  code    the opcode and operand bytes
+//  a, x, y, sp, status, only those that changed since the last record
+//a header of CPU6502_TRACE_END ends a chunk early.
+#define CPU6502_TRACE_CHUNK      256
+#define CPU6502_TRACE_RECORD_MAX 11
+#define CPU6502_TRACE_PC_NEXT    0 //pc follows on from the last record
+#define CPU6502_TRACE_PC_REL     1
+#define CPU6502_TRACE_PC_ABS     2
+#define CPU6502_TRACE_END        3
+#define CPU6502_TRACE_A          0x04
+#define CPU6502_TRACE_X          0x08
+#define CPU6502_TRACE_Y          0x10
+#define CPU6502_TRACE_SP         0x20
+#define CPU6502_TRACE_STATUS     0x40
+
+typedef struct {
+  uint8_t *buffer;         //size bytes, a multiple of CPU6502_TRACE_CHUNK
+  uint32_t size;
+  uint32_t head;           //where the next record goes
+  uint8_t wrapped;         //set once head went round, all chunks are in use
+  volatile uint8_t frozen; //set to pause recording, e.g. while reading it
+  uint8_t resync;          //next record is a full one
+  uint16_t nextpc;         //pc the last record falls through to
+  uint8_t regs[5];         //a, x, y, sp and status of the last record
+} cpu6502_trace_t;
+
+//pc histogram of the sampling profiler, one counter per 1 << shift bytes
+typedef struct {
+  uint32_t *buckets;
+  uint8_t shift;
+} cpu6502_pchist_t;
+
+//one decoded instruction
+typedef struct {
+  uint16_t pc;       //address the entry was decoded from
+  uint16_t operand;  //operand bytes, little endian
+  uint16_t operand2; //operand bytes of the second half of a superinstruction
+  uint16_t handler;  //opcode, or CPU6502_HANDLER_FUSED + cpu6502_fusion_t
+  uint8_t length;    //length of the first instruction, 0 marks a free entry
+} cpu6502_decoded_t;
+
+//memory bus of one machine, ctx is passed back to both callbacks
+typedef struct {
+  void *ctx;
+  uint8_t (*read)(void *ctx, uint16_t address);
+  void (*write)(void *ctx, uint16_t address, uint8_t value);
+  uint8_t *lowpages; //pages 0 and 1, used by a FAKE6502_DIRECT_LOW_PAGES build
+} cpu6502_bus_t;
+
+//complete state of one emulated 6502, every API call takes one of these so
+//any number of machines can run side by side
+typedef struct cpu6502 {
+  //registers
+  uint16_t pc;
+  uint8_t sp, a, x, y, status;
+  //counters
+  uint32_t clockticks6502; //running total of emulated clock ticks
+  uint32_t clockgoal6502;
+  uint32_t instructions;   //running total of executed instructions
+  uint32_t fusions[CPU6502_FUSE_COUNT]; //superinstructions run, per pair
+  //memory bus and optional per instruction hook
+  cpu6502_bus_t bus;
+  void (*loopexternal)(struct cpu6502 *cpu);
+  cpu6502_profile_t *profile; //counted into by a FAKE6502_PROFILE build if set
+  cpu6502_pchist_t *pchist;   //counts the pc of each requested sample if set
+  cpu6502_callgraph_t *callgraph; //tracked by a FAKE6502_CALLGRAPH build if set
+  cpu6502_trace_t *trace;     //recorded into by a FAKE6502_TRACE build if set
+  void (*interrupthook)(void *ctx, uint16_t vector); //told of interrupts if set
+  void *interruptctx;         //passed back to interrupthook
+  //run control
+  volatile uint32_t events; //CPU6502_EVENT_* bits, may be set from other tasks
+  uint8_t waiting;          //set by WAI, cleared by the next interrupt request
+  uint8_t idledetect;       //set to let run6502() stop in idle loops
+  uint8_t idleticks;        //ticks per iteration of that loop
+  uint8_t nbreakpoints;
+  uint16_t breakpoints[CPU6502_MAX_BREAKPOINTS];
+  uint8_t breakresume;      //set when a run stopped at the breakpoint on
+  uint16_t breakresumepc;   //breakresumepc, the next run from there executes it
+  //operand scratch of the legacy engine
+  uint16_t ea, reladdr, value, result;
+  uint8_t opcode, penaltyop, penaltyaddr;
+  //decoded instruction cache, unused by the legacy engine
+  cpu6502_decoded_t dcache[FAKE6502_DCACHE_ENTRIES];
+} cpu6502_t;
 
 #define FLAG_CARRY     0x01
 #define FLAG_ZERO      0x02
@@ -29,31 +243,40 @@ extern uint8_t fake6502_running_status;
 #define BASE_STACK     0x100
 
 //flag modifier macros
-#define setcarry() *fake6502_status |= FLAG_CARRY
-#define clearcarry() *fake6502_status &= (~FLAG_CARRY)
-#define setzero() *fake6502_status |= FLAG_ZERO
-#define clearzero() *fake6502_status &= (~FLAG_ZERO)
-#define setinterrupt() *fake6502_status |= FLAG_INTERRUPT
-#define clearinterrupt() *fake6502_status &= (~FLAG_INTERRUPT)
-#define setdecimal() *fake6502_status |= FLAG_DECIMAL
-#define cleardecimal() *fake6502_status &= (~FLAG_DECIMAL)
-#define setoverflow() *fake6502_status |= FLAG_OVERFLOW
-#define clearoverflow() *fake6502_status &= (~FLAG_OVERFLOW)
-#define setsign() *fake6502_status |= FLAG_SIGN
-#define clearsign() *fake6502_status &= (~FLAG_SIGN)
-
-void exec6502(uint32_t tickcount);
-void step6502();
-void hookexternal(void *funcptr);
-void irq6502();
-void nmi6502();
-void reset6502();
-void push16(uint16_t pushval);
-void push8(uint8_t pushval);
-uint16_t pull16();
-uint8_t pull8();
-//externally supplied functions
-extern uint8_t read6502(uint16_t address);
-extern void write6502(uint16_t address, uint8_t value);
-
-#endif
\ No newline at end of file
+#define setcarry(c) (c)->status |= FLAG_CARRY
+#define clearcarry(c) (c)->status &= (~FLAG_CARRY)
+#define setzero(c) (c)->status |= FLAG_ZERO
+#define clearzero(c) (c)->status &= (~FLAG_ZERO)
+#define setinterrupt(c) (c)->status |= FLAG_INTERRUPT
+#define clearinterrupt(c) (c)->status &= (~FLAG_INTERRUPT)
+#define setdecimal(c) (c)->status |= FLAG_DECIMAL
+#define cleardecimal(c) (c)->status &= (~FLAG_DECIMAL)
+#define setoverflow(c) (c)->status |= FLAG_OVERFLOW
+#define clearoverflow(c) (c)->status &= (~FLAG_OVERFLOW)
+#define setsign(c) (c)->status |= FLAG_SIGN
+#define clearsign(c) (c)->status &= (~FLAG_SIGN)
+
+void cpu6502_init(cpu6502_t *cpu, const cpu6502_bus_t *bus);
+cpu6502_stop_t run6502(cpu6502_t *cpu, uint32_t budget);
+#ifndef FAKE6502_FAST
+cpu6502_stop_t exec6502(cpu6502_t *cpu, uint32_t tickcount);
+#endif
+void step6502(cpu6502_t *cpu);
+void cpu6502_request_stop(cpu6502_t *cpu);
+void cpu6502_cancel_stop(cpu6502_t *cpu);
+uint8_t cpu6502_request_sample(cpu6502_t *cpu);
+int cpu6502_set_breakpoint(cpu6502_t *cpu, uint16_t address);
+void cpu6502_clear_breakpoints(cpu6502_t *cpu);
+void cpu6502_invalidate(cpu6502_t *cpu, uint16_t address, uint32_t length);
+void cpu6502_skip_idle(cpu6502_t *cpu, uint32_t ticks);
+void hookexternal(cpu6502_t *cpu, void (*funcptr)(cpu6502_t *cpu));
+void cpu6502_irq_assert(cpu6502_t *cpu, uint32_t source);
+void cpu6502_irq_deassert(cpu6502_t *cpu, uint32_t source);
+void nmi6502(cpu6502_t *cpu);
+void reset6502(cpu6502_t *cpu);
+void push16(cpu6502_t *cpu, uint16_t pushval);
+void push8(cpu6502_t *cpu, uint8_t pushval);
+uint16_t pull16(cpu6502_t *cpu);
+uint8_t pull8(cpu6502_t *cpu);
+
+#endif
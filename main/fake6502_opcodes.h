@@ -0,0 +1,267 @@
+//-----------------------------------------------------------------------------
+// fake6502_opcodes.h: Opcode definitions for the fused 6502 core
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+// Included multiple times with different OPCODE() definitions, so there is no
+// include guard. Columns:
+//   OPCODE(opcode, operation, addressing mode, base ticks, page-cross penalty)
+// Undocumented opcodes are listed as NOP with the addressing mode and timing
+// of the instruction they replace, exactly like the legacy optable does.
+// 0xCB is the 65C02 WAI instruction.
+//-----------------------------------------------------------------------------
+OPCODE(0x00, BRK,  IMP,  7, 0)
+OPCODE(0x01, ORA,  INDX, 6, 0)
+OPCODE(0x02, NOP,  IMP,  2, 0)
+OPCODE(0x03, NOP,  INDX, 8, 0)
+OPCODE(0x04, NOP,  ZP,   3, 0)
+OPCODE(0x05, ORA,  ZP,   3, 0)
+OPCODE(0x06, ASL,  ZP,   5, 0)
+OPCODE(0x07, NOP,  ZP,   5, 0)
+OPCODE(0x08, PHP,  IMP,  3, 0)
+OPCODE(0x09, ORA,  IMM,  2, 0)
+OPCODE(0x0A, ASLA, ACC,  2, 0)
+OPCODE(0x0B, NOP,  IMM,  2, 0)
+OPCODE(0x0C, NOP,  ABSO, 4, 0)
+OPCODE(0x0D, ORA,  ABSO, 4, 0)
+OPCODE(0x0E, ASL,  ABSO, 6, 0)
+OPCODE(0x0F, NOP,  ABSO, 6, 0)
+OPCODE(0x10, BPL,  REL,  2, 0)
+OPCODE(0x11, ORA,  INDY, 5, 1)
+OPCODE(0x12, NOP,  IMP,  2, 0)
+OPCODE(0x13, NOP,  INDY, 8, 0)
+OPCODE(0x14, NOP,  ZPX,  4, 0)
+OPCODE(0x15, ORA,  ZPX,  4, 0)
+OPCODE(0x16, ASL,  ZPX,  6, 0)
+OPCODE(0x17, NOP,  ZPX,  6, 0)
+OPCODE(0x18, CLC,  IMP,  2, 0)
+OPCODE(0x19, ORA,  ABSY, 4, 1)
+OPCODE(0x1A, NOP,  IMP,  2, 0)
+OPCODE(0x1B, NOP,  ABSY, 7, 0)
+OPCODE(0x1C, NOP,  ABSX, 4, 1)
+OPCODE(0x1D, ORA,  ABSX, 4, 1)
+OPCODE(0x1E, ASL,  ABSX, 7, 0)
+OPCODE(0x1F, NOP,  ABSX, 7, 0)
+OPCODE(0x20, JSR,  ABSO, 6, 0)
+OPCODE(0x21, AND,  INDX, 6, 0)
+OPCODE(0x22, NOP,  IMP,  2, 0)
+OPCODE(0x23, NOP,  INDX, 8, 0)
+OPCODE(0x24, BIT,  ZP,   3, 0)
+OPCODE(0x25, AND,  ZP,   3, 0)
+OPCODE(0x26, ROL,  ZP,   5, 0)
+OPCODE(0x27, NOP,  ZP,   5, 0)
+OPCODE(0x28, PLP,  IMP,  4, 0)
+OPCODE(0x29, AND,  IMM,  2, 0)
+OPCODE(0x2A, ROLA, ACC,  2, 0)
+OPCODE(0x2B, NOP,  IMM,  2, 0)
+OPCODE(0x2C, BIT,  ABSO, 4, 0)
+OPCODE(0x2D, AND,  ABSO, 4, 0)
+OPCODE(0x2E, ROL,  ABSO, 6, 0)
+OPCODE(0x2F, NOP,  ABSO, 6, 0)
+OPCODE(0x30, BMI,  REL,  2, 0)
+OPCODE(0x31, AND,  INDY, 5, 1)
+OPCODE(0x32, NOP,  IMP,  2, 0)
+OPCODE(0x33, NOP,  INDY, 8, 0)
+OPCODE(0x34, NOP,  ZPX,  4, 0)
+OPCODE(0x35, AND,  ZPX,  4, 0)
+OPCODE(0x36, ROL,  ZPX,  6, 0)
+OPCODE(0x37, NOP,  ZPX,  6, 0)
+OPCODE(0x38, SEC,  IMP,  2, 0)
+OPCODE(0x39, AND,  ABSY, 4, 1)
+OPCODE(0x3A, NOP,  IMP,  2, 0)
+OPCODE(0x3B, NOP,  ABSY, 7, 0)
+OPCODE(0x3C, NOP,  ABSX, 4, 1)
+OPCODE(0x3D, AND,  ABSX, 4, 1)
+OPCODE(0x3E, ROL,  ABSX, 7, 0)
+OPCODE(0x3F, NOP,  ABSX, 7, 0)
+OPCODE(0x40, RTI,  IMP,  6, 0)
+OPCODE(0x41, EOR,  INDX, 6, 0)
+OPCODE(0x42, NOP,  IMP,  2, 0)
+OPCODE(0x43, NOP,  INDX, 8, 0)
+OPCODE(0x44, NOP,  ZP,   3, 0)
+OPCODE(0x45, EOR,  ZP,   3, 0)
+OPCODE(0x46, LSR,  ZP,   5, 0)
+OPCODE(0x47, NOP,  ZP,   5, 0)
+OPCODE(0x48, PHA,  IMP,  3, 0)
+OPCODE(0x49, EOR,  IMM,  2, 0)
+OPCODE(0x4A, LSRA, ACC,  2, 0)
+OPCODE(0x4B, NOP,  IMM,  2, 0)
+OPCODE(0x4C, JMP,  ABSO, 3, 0)
+OPCODE(0x4D, EOR,  ABSO, 4, 0)
+OPCODE(0x4E, LSR,  ABSO, 6, 0)
+OPCODE(0x4F, NOP,  ABSO, 6, 0)
+OPCODE(0x50, BVC,  REL,  2, 0)
+OPCODE(0x51, EOR,  INDY, 5, 1)
+OPCODE(0x52, NOP,  IMP,  2, 0)
+OPCODE(0x53, NOP,  INDY, 8, 0)
+OPCODE(0x54, NOP,  ZPX,  4, 0)
+OPCODE(0x55, EOR,  ZPX,  4, 0)
+OPCODE(0x56, LSR,  ZPX,  6, 0)
+OPCODE(0x57, NOP,  ZPX,  6, 0)
+OPCODE(0x58, CLI,  IMP,  2, 0)
+OPCODE(0x59, EOR,  ABSY, 4, 1)
+OPCODE(0x5A, NOP,  IMP,  2, 0)
+OPCODE(0x5B, NOP,  ABSY, 7, 0)
+OPCODE(0x5C, NOP,  ABSX, 4, 1)
+OPCODE(0x5D, EOR,  ABSX, 4, 1)
+OPCODE(0x5E, LSR,  ABSX, 7, 0)
+OPCODE(0x5F, NOP,  ABSX, 7, 0)
+OPCODE(0x60, RTS,  IMP,  6, 0)
+OPCODE(0x61, ADC,  INDX, 6, 0)
+OPCODE(0x62, NOP,  IMP,  2, 0)
+OPCODE(0x63, NOP,  INDX, 8, 0)
+OPCODE(0x64, NOP,  ZP,   3, 0)
+OPCODE(0x65, ADC,  ZP,   3, 0)
+OPCODE(0x66, ROR,  ZP,   5, 0)
+OPCODE(0x67, NOP,  ZP,   5, 0)
+OPCODE(0x68, PLA,  IMP,  4, 0)
+OPCODE(0x69, ADC,  IMM,  2, 0)
+OPCODE(0x6A, RORA, ACC,  2, 0)
+OPCODE(0x6B, NOP,  IMM,  2, 0)
+OPCODE(0x6C, JMP,  IND,  5, 0)
+OPCODE(0x6D, ADC,  ABSO, 4, 0)
+OPCODE(0x6E, ROR,  ABSO, 6, 0)
+OPCODE(0x6F, NOP,  ABSO, 6, 0)
+OPCODE(0x70, BVS,  REL,  2, 0)
+OPCODE(0x71, ADC,  INDY, 5, 1)
+OPCODE(0x72, NOP,  IMP,  2, 0)
+OPCODE(0x73, NOP,  INDY, 8, 0)
+OPCODE(0x74, NOP,  ZPX,  4, 0)
+OPCODE(0x75, ADC,  ZPX,  4, 0)
+OPCODE(0x76, ROR,  ZPX,  6, 0)
+OPCODE(0x77, NOP,  ZPX,  6, 0)
+OPCODE(0x78, SEI,  IMP,  2, 0)
+OPCODE(0x79, ADC,  ABSY, 4, 1)
+OPCODE(0x7A, NOP,  IMP,  2, 0)
+OPCODE(0x7B, NOP,  ABSY, 7, 0)
+OPCODE(0x7C, NOP,  ABSX, 4, 1)
+OPCODE(0x7D, ADC,  ABSX, 4, 1)
+OPCODE(0x7E, ROR,  ABSX, 7, 0)
+OPCODE(0x7F, NOP,  ABSX, 7, 0)
+OPCODE(0x80, NOP,  IMM,  2, 0)
+OPCODE(0x81, STA,  INDX, 6, 0)
+OPCODE(0x82, NOP,  IMM,  2, 0)
+OPCODE(0x83, NOP,  INDX, 6, 0)
+OPCODE(0x84, STY,  ZP,   3, 0)
+OPCODE(0x85, STA,  ZP,   3, 0)
+OPCODE(0x86, STX,  ZP,   3, 0)
+OPCODE(0x87, NOP,  ZP,   3, 0)
+OPCODE(0x88, DEY,  IMP,  2, 0)
+OPCODE(0x89, NOP,  IMM,  2, 0)
+OPCODE(0x8A, TXA,  IMP,  2, 0)
+OPCODE(0x8B, NOP,  IMM,  2, 0)
+OPCODE(0x8C, STY,  ABSO, 4, 0)
+OPCODE(0x8D, STA,  ABSO, 4, 0)
+OPCODE(0x8E, STX,  ABSO, 4, 0)
+OPCODE(0x8F, NOP,  ABSO, 4, 0)
+OPCODE(0x90, BCC,  REL,  2, 0)
+OPCODE(0x91, STA,  INDY, 6, 0)
+OPCODE(0x92, NOP,  IMP,  2, 0)
+OPCODE(0x93, NOP,  INDY, 6, 0)
+OPCODE(0x94, STY,  ZPX,  4, 0)
+OPCODE(0x95, STA,  ZPX,  4, 0)
+OPCODE(0x96, STX,  ZPY,  4, 0)
+OPCODE(0x97, NOP,  ZPY,  4, 0)
+OPCODE(0x98, TYA,  IMP,  2, 0)
+OPCODE(0x99, STA,  ABSY, 5, 0)
+OPCODE(0x9A, TXS,  IMP,  2, 0)
+OPCODE(0x9B, NOP,  ABSY, 5, 0)
+OPCODE(0x9C, NOP,  ABSX, 5, 0)
+OPCODE(0x9D, STA,  ABSX, 5, 0)
+OPCODE(0x9E, NOP,  ABSY, 5, 0)
+OPCODE(0x9F, NOP,  ABSY, 5, 0)
+OPCODE(0xA0, LDY,  IMM,  2, 0)
+OPCODE(0xA1, LDA,  INDX, 6, 0)
+OPCODE(0xA2, LDX,  IMM,  2, 0)
+OPCODE(0xA3, NOP,  INDX, 6, 0)
+OPCODE(0xA4, LDY,  ZP,   3, 0)
+OPCODE(0xA5, LDA,  ZP,   3, 0)
+OPCODE(0xA6, LDX,  ZP,   3, 0)
+OPCODE(0xA7, NOP,  ZP,   3, 0)
+OPCODE(0xA8, TAY,  IMP,  2, 0)
+OPCODE(0xA9, LDA,  IMM,  2, 0)
+OPCODE(0xAA, TAX,  IMP,  2, 0)
+OPCODE(0xAB, NOP,  IMM,  2, 0)
+OPCODE(0xAC, LDY,  ABSO, 4, 0)
+OPCODE(0xAD, LDA,  ABSO, 4, 0)
+OPCODE(0xAE, LDX,  ABSO, 4, 0)
+OPCODE(0xAF, NOP,  ABSO, 4, 0)
+OPCODE(0xB0, BCS,  REL,  2, 0)
+OPCODE(0xB1, LDA,  INDY, 5, 1)
+OPCODE(0xB2, NOP,  IMP,  2, 0)
+OPCODE(0xB3, NOP,  INDY, 5, 0)
+OPCODE(0xB4, LDY,  ZPX,  4, 0)
+OPCODE(0xB5, LDA,  ZPX,  4, 0)
+OPCODE(0xB6, LDX,  ZPY,  4, 0)
+OPCODE(0xB7, NOP,  ZPY,  4, 0)
+OPCODE(0xB8, CLV,  IMP,  2, 0)
+OPCODE(0xB9, LDA,  ABSY, 4, 1)
+OPCODE(0xBA, TSX,  IMP,  2, 0)
+OPCODE(0xBB, NOP,  ABSY, 4, 0)
+OPCODE(0xBC, LDY,  ABSX, 4, 1)
+OPCODE(0xBD, LDA,  ABSX, 4, 1)
+OPCODE(0xBE, LDX,  ABSY, 4, 1)
+OPCODE(0xBF, NOP,  ABSY, 4, 0)
+OPCODE(0xC0, CPY,  IMM,  2, 0)
+OPCODE(0xC1, CMP,  INDX, 6, 0)
+OPCODE(0xC2, NOP,  IMM,  2, 0)
+OPCODE(0xC3, NOP,  INDX, 8, 0)
+OPCODE(0xC4, CPY,  ZP,   3, 0)
+OPCODE(0xC5, CMP,  ZP,   3, 0)
+OPCODE(0xC6, DEC,  ZP,   5, 0)
+OPCODE(0xC7, NOP,  ZP,   5, 0)
+OPCODE(0xC8, INY,  IMP,  2, 0)
+OPCODE(0xC9, CMP,  IMM,  2, 0)
+OPCODE(0xCA, DEX,  IMP,  2, 0)
+OPCODE(0xCB, WAI,  IMP,  3, 0)
+OPCODE(0xCC, CPY,  ABSO, 4, 0)
+OPCODE(0xCD, CMP,  ABSO, 4, 0)
+OPCODE(0xCE, DEC,  ABSO, 6, 0)
+OPCODE(0xCF, NOP,  ABSO, 6, 0)
+OPCODE(0xD0, BNE,  REL,  2, 0)
+OPCODE(0xD1, CMP,  INDY, 5, 1)
+OPCODE(0xD2, NOP,  IMP,  2, 0)
+OPCODE(0xD3, NOP,  INDY, 8, 0)
+OPCODE(0xD4, NOP,  ZPX,  4, 0)
+OPCODE(0xD5, CMP,  ZPX,  4, 0)
+OPCODE(0xD6, DEC,  ZPX,  6, 0)
+OPCODE(0xD7, NOP,  ZPX,  6, 0)
+OPCODE(0xD8, CLD,  IMP,  2, 0)
+OPCODE(0xD9, CMP,  ABSY, 4, 1)
+OPCODE(0xDA, NOP,  IMP,  2, 0)
+OPCODE(0xDB, NOP,  ABSY, 7, 0)
+OPCODE(0xDC, NOP,  ABSX, 4, 1)
+OPCODE(0xDD, CMP,  ABSX, 4, 1)
+OPCODE(0xDE, DEC,  ABSX, 7, 0)
+OPCODE(0xDF, NOP,  ABSX, 7, 0)
+OPCODE(0xE0, CPX,  IMM,  2, 0)
+OPCODE(0xE1, SBC,  INDX, 6, 0)
+OPCODE(0xE2, NOP,  IMM,  2, 0)
+OPCODE(0xE3, NOP,  INDX, 8, 0)
+OPCODE(0xE4, CPX,  ZP,   3, 0)
+OPCODE(0xE5, SBC,  ZP,   3, 0)
+OPCODE(0xE6, INC,  ZP,   5, 0)
+OPCODE(0xE7, NOP,  ZP,   5, 0)
+OPCODE(0xE8, INX,  IMP,  2, 0)
+OPCODE(0xE9, SBC,  IMM,  2, 0)
+OPCODE(0xEA, NOP,  IMP,  2, 0)
+OPCODE(0xEB, SBC,  IMM,  2, 0)
+OPCODE(0xEC, CPX,  ABSO, 4, 0)
+OPCODE(0xED, SBC,  ABSO, 4, 0)
+OPCODE(0xEE, INC,  ABSO, 6, 0)
+OPCODE(0xEF, NOP,  ABSO, 6, 0)
+OPCODE(0xF0, BEQ,  REL,  2, 0)
+OPCODE(0xF1, SBC,  INDY, 5, 1)
+OPCODE(0xF2, NOP,  IMP,  2, 0)
+OPCODE(0xF3, NOP,  INDY, 8, 0)
+OPCODE(0xF4, NOP,  ZPX,  4, 0)
+OPCODE(0xF5, SBC,  ZPX,  4, 0)
+OPCODE(0xF6, INC,  ZPX,  6, 0)
+OPCODE(0xF7, NOP,  ZPX,  6, 0)
+OPCODE(0xF8, SED,  IMP,  2, 0)
+OPCODE(0xF9, SBC,  ABSY, 4, 1)
+OPCODE(0xFA, NOP,  IMP,  2, 0)
+OPCODE(0xFB, NOP,  ABSY, 7, 0)
+OPCODE(0xFC, NOP,  ABSX, 4, 1)
+OPCODE(0xFD, SBC,  ABSX, 4, 1)
+OPCODE(0xFE, INC,  ABSX, 7, 0)
+OPCODE(0xFF, NOP,  ABSX, 7, 0)
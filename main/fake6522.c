@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "driver/gpio.h"
+#include "esp_attr.h"
 
 #include "fake6502.h"
 #include "fakemem.h"
@@ -20,6 +21,13 @@ static const uint64_t portb_gpio_nums[] = {
     PORTB_1, PORTB_2, PORTB_3, PORTB_4,
     PORTB_5, PORTB_6, PORTB_7, PORTB_8
 };
+static void (*port_change_callback)(void);
+static fake6522_state_t via_state;
+
+//-----------------------------------------------------------------------------
+static void IRAM_ATTR io_port_change_isr(void *arg){
+  port_change_callback();
+}
 
 //-----------------------------------------------------------------------------
 static void io_port_write_direction(uint16_t addr, uint8_t byte, const uint64_t *port_gpio_nums){
@@ -39,7 +47,7 @@ static void io_port_write_direction(uint16_t addr, uint8_t byte, const uint64_t
     .mode = GPIO_MODE_INPUT,
     .pull_up_en = GPIO_PULLUP_DISABLE,
     .pull_down_en = GPIO_PULLUP_DISABLE,
-    .intr_type = GPIO_INTR_DISABLE
+    .intr_type = port_change_callback ? GPIO_INTR_ANYEDGE : GPIO_INTR_DISABLE
   };
   gpio_config_t out_config = {
     .pin_bit_mask = port_gpio_out_mask,
@@ -50,6 +58,16 @@ static void io_port_write_direction(uint16_t addr, uint8_t byte, const uint64_t
   };
   gpio_config(&in_config); // Configure PORTA GPIOs as input
   gpio_config(&out_config); // Configure PORTA GPIOs as output
+  if(port_change_callback){
+    // Report changes of the input pins only
+    for(int i = 0; i < 8; i++) {
+      if(byte & (1 << i)) {
+        gpio_isr_handler_remove(port_gpio_nums[i]);
+      } else {
+        gpio_isr_handler_add(port_gpio_nums[i], io_port_change_isr, NULL);
+      }
+    }
+  }
 }
 //-----------------------------------------------------------------------------
 static void io_port_write_values(uint16_t addr, uint8_t byte, const uint64_t *port_gpio_nums) {
@@ -80,15 +98,19 @@ void fake6522_write(uint16_t addr, uint8_t byte) {
   uint8_t rs =  addr & 0xFF; // Get the register select bits from the address
   switch(rs) {
     case 0x00: // PORTB Value Register
+      via_state.orb = byte;
       io_port_write_values(addr, byte, portb_gpio_nums); // Write to PORTB values
       break;
     case 0x01: // PORTA Value Register
+      via_state.ora = byte;
       io_port_write_values(addr, byte, porta_gpio_nums); // Write to PORTA values
       break;
     case 0x02: // PORTB Direction Register
+      via_state.ddrb = byte;
       io_port_write_direction(addr, byte, portb_gpio_nums); // Write to PORTB direction
       break;
     case 0x03: // PORTA Direction Register
+      via_state.ddra = byte;
       io_port_write_direction(addr, byte, porta_gpio_nums); // Write to PORTA direction
       break;
     default:
@@ -97,6 +119,27 @@ void fake6522_write(uint16_t addr, uint8_t byte) {
   }
 }
 //-----------------------------------------------------------------------------
+void fake6522_set_change_callback(void (*callback)(void)) {
+  gpio_install_isr_service(0);
+  port_change_callback = callback;
+  // Pins are inputs from reset on, they must report changes before the 6502
+  // writes a direction. Direction writes keep the handlers up to date.
+  io_port_write_direction(0x6002, via_state.ddrb, portb_gpio_nums);
+  io_port_write_direction(0x6003, via_state.ddra, porta_gpio_nums);
+}
+//-----------------------------------------------------------------------------
+void fake6522_get_state(fake6522_state_t *state) {
+  *state = via_state;
+}
+//-----------------------------------------------------------------------------
+void fake6522_set_state(const fake6522_state_t *state) {
+  // Values first, so pins switching to output come up at the saved level
+  fake6522_write(0x6000, state->orb);
+  fake6522_write(0x6001, state->ora);
+  fake6522_write(0x6002, state->ddrb);
+  fake6522_write(0x6003, state->ddra);
+}
+//-----------------------------------------------------------------------------
 uint8_t fake6522_read(uint16_t addr) {
   uint8_t rs =  addr & 0xFF; // Get the register select bits from the address
   switch(rs) {
@@ -8,7 +8,6 @@
 
 #include <stdint.h>
 #include <stddef.h>
-#include "driver/gpio.h"
 
 //-----------------------------------------------------------------------------
 // Flip the pins later for port a
@@ -40,9 +39,22 @@
 #define PORTC_8 GPIO_NUM_1
 
 //-----------------------------------------------------------------------------
+// Port registers as last written by the 6502
+typedef struct {
+  uint8_t orb;  // PORTB value
+  uint8_t ora;  // PORTA value
+  uint8_t ddrb; // PORTB direction, 1 = output
+  uint8_t ddra; // PORTA direction, 1 = output
+} fake6522_state_t;
 
 void fake6522_write(uint16_t addr, uint8_t byte);
 uint8_t fake6522_read(uint16_t addr);
+// Called from the GPIO interrupt whenever a port pin set as input changes,
+// the pins are set up with the current directions right away
+void fake6522_set_change_callback(void (*callback)(void));
+// Save and restore the port registers, restoring drives the pins again
+void fake6522_get_state(fake6522_state_t *state);
+void fake6522_set_state(const fake6522_state_t *state);
 
 //-----------------------------------------------------------------------------
 #endif //  FAKE6522_H
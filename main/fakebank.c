@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------
+// fakebank.c: Bank switched extended memory behind windows of the 6502 bus
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include "fakebank.h"
+
+#include <string.h>
+#include "fakemem.h"
+
+//-----------------------------------------------------------------------------
+static uint8_t fakebank_register_read(void *ctx, uint16_t addr){
+  fakebank_t *bank = ctx;
+  return bank->selected[addr - bank->registers];
+}
+static void fakebank_register_write(void *ctx, uint16_t addr, uint8_t byte){
+  fakebank_select(ctx, addr - ((fakebank_t *)ctx)->registers, byte);
+}
+
+//-----------------------------------------------------------------------------
+int fakebank_init(fakebank_t *bank, cpu6502_t *cpu, uint8_t *memory, uint32_t size,
+                  uint16_t registers, const fakebank_window_t *windows, uint8_t nwindows){
+  if(nwindows > FAKEBANK_MAX_WINDOWS){
+    return -1;
+  }
+  for(int i = 0; i < nwindows; i++){
+    const fakebank_window_t *window = &windows[i];
+    if((window->start & 0xFF) != 0 || (window->size & 0xFF) != 0 || window->size == 0 ||
+       window->start + window->size > 0x10000){
+      return -1;
+    }
+#ifdef FAKEMEM_LOW_PAGES_RAM
+    if(window->start < FAKEMEM_LOW_PAGES_RAM){
+      return -1;
+    }
+#endif
+  }
+  bank->memory = memory;
+  bank->size = size;
+  bank->cpu = cpu;
+  bank->registers = registers;
+  bank->nwindows = nwindows;
+  memcpy(bank->windows, windows, nwindows * sizeof(windows[0]));
+  memset(bank->selected, 0, sizeof(bank->selected));
+  fakemem_device_t device = { registers, nwindows, fakebank_register_read,
+                              fakebank_register_write, NULL, NULL, bank };
+  return fakemem_add_device(&device);
+}
+//-----------------------------------------------------------------------------
+void fakebank_select(fakebank_t *bank, uint8_t window, uint8_t block){
+  if(window >= bank->nwindows){
+    return;
+  }
+  const fakebank_window_t *w = &bank->windows[window];
+  uint8_t *memory = NULL;
+  if(block != 0 && (uint64_t)block * w->size <= bank->size){
+    memory = bank->memory + (block - 1) * w->size;
+  } else {
+    block = 0; // Past the end, the RAM stays
+  }
+  fakemem_map_overlay(w->start >> 8, w->size >> 8, memory); // init() checked the pages
+  bank->selected[window] = block;
+  cpu6502_invalidate(bank->cpu, w->start, w->size);
+}
+//-----------------------------------------------------------------------------
+int fakebank_write(fakebank_t *bank, uint32_t offset, const uint8_t *data, uint32_t len){
+  if(offset > bank->size || len > bank->size - offset){
+    return -1;
+  }
+  memcpy(bank->memory + offset, data, len);
+  for(int i = 0; i < bank->nwindows; i++){
+    const fakebank_window_t *w = &bank->windows[i];
+    uint32_t shown = (bank->selected[i] - 1) * w->size;
+    if(bank->selected[i] != 0 && offset < shown + w->size && offset + len > shown){
+      cpu6502_invalidate(bank->cpu, w->start, w->size);
+    }
+  }
+  return 0;
+}
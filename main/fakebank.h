@@ -0,0 +1,52 @@
+//-----------------------------------------------------------------------------
+// fakebank.h: Bank switched extended memory behind windows of the 6502 bus
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#ifndef FAKEBANK_H
+#define FAKEBANK_H
+
+#include <stdint.h>
+#include "fake6502.h"
+
+//-----------------------------------------------------------------------------
+// Every window has one register, window n at registers + n. Writing 0 shows
+// the RAM of the window again, b selects block b - 1 of the extended memory,
+// blocks are as large as the window. A block past the end of the memory
+// selects 0, so a program finds the size by reading the register back.
+// Switching only remaps the pages of the window, nothing is copied.
+#define FAKEBANK_MAX_WINDOWS 4
+
+// Window sizes are whole pages, 4 KiB and 16 KiB suit the 6502 code
+typedef struct {
+  uint16_t start;
+  uint32_t size;
+} fakebank_window_t;
+
+// Windows of the board and the host runners, see the memory map in
+// bitboard_6502.c
+#define FAKEBANK_BOARD_REGISTERS 0xF010
+#define FAKEBANK_BOARD_WINDOWS { { 0x2000, 0x1000 }, { 0x3000, 0x1000 }, { 0xA000, 0x4000 } }
+
+typedef struct {
+  uint8_t *memory;
+  uint32_t size;
+  cpu6502_t *cpu; // Decoded code of a window is dropped on a switch
+  uint16_t registers;
+  uint8_t nwindows;
+  fakebank_window_t windows[FAKEBANK_MAX_WINDOWS];
+  uint8_t selected[FAKEBANK_MAX_WINDOWS];
+} fakebank_t;
+
+// Put the registers of the windows on the bus, every window showing its RAM.
+// -1 for windows that aren't whole pages, cover pages that must stay RAM, or
+// registers that don't fit in the memory map.
+int fakebank_init(fakebank_t *bank, cpu6502_t *cpu, uint8_t *memory, uint32_t size,
+                  uint16_t registers, const fakebank_window_t *windows, uint8_t nwindows);
+// Same as a write of block to the register of window, nothing for a window
+// that doesn't exist
+void fakebank_select(fakebank_t *bank, uint8_t window, uint8_t block);
+// Load the extended memory from the host, -1 past its end. Drops the decoded
+// code of the windows showing it.
+int fakebank_write(fakebank_t *bank, uint32_t offset, const uint8_t *data, uint32_t len);
+
+#endif
@@ -8,95 +8,329 @@
 #include <string.h>
 
 //-----------------------------------------------------------------------------
-fakemem_callable_t fakemem_callables[];
-uint8_t fakemem[1<<16]; // Simulated memory for the 6502 CPU
+// Table of the device per address of a shared page, 0 for memory, else the
+// index into fakemem_devices plus one
+typedef struct {
+  uint8_t used; // 0 while the slot is free, zeroed storage starts that way
+  uint8_t page;
+  uint8_t device[0x100];
+} fakemem_shared_t;
 
-uint16_t fakemem_access_address;
-uint8_t fakemem_access_data;
-uint8_t fakemem_access_mode;
+static uint8_t fakemem_via_read(void *ctx, uint16_t addr);
+static void fakemem_via_write(void *ctx, uint16_t addr, uint8_t byte);
 
+FAKEMEM_STORAGE fakemem_page_t fakemem_pages[FAKEMEM_PAGES];
+FAKEMEM_STORAGE fakemem_device_t fakemem_devices[FAKEMEM_MAX_DEVICES] = {
+  { FAKEMEM_VIA_START, FAKEMEM_VIA_SIZE, fakemem_via_read, fakemem_via_write, NULL, NULL, NULL },
+};
+FAKEMEM_STORAGE uint8_t fakemem_ndevices = 1;
+static FAKEMEM_STORAGE fakemem_shared_t fakemem_shared[FAKEMEM_SHARED_PAGES];
+// Memory shown in a page instead of its RAM, NULL for the RAM
+static FAKEMEM_STORAGE uint8_t *fakemem_overlays[FAKEMEM_PAGES];
+FAKEMEM_STORAGE uint8_t fakemem[1<<16]; // Simulated memory for the 6502 CPU
+
+FAKEMEM_STORAGE volatile fakemem_access_t fakemem_access;
+FAKEMEM_STORAGE volatile uint8_t fakemem_access_request;
+FAKEMEM_STORAGE replay_t *fakemem_replay;
+
+//-----------------------------------------------------------------------------
+static void fakemem_ignore_write(void *ctx, uint16_t addr, uint8_t byte){
+}
+//-----------------------------------------------------------------------------
+void fakemem_map_memory(uint8_t first, uint16_t count, uint8_t *memory, uint8_t writable){
+  for(uint16_t i = 0; i < count && first + i < FAKEMEM_PAGES; i++){
+    fakemem_page_t *page = &fakemem_pages[first + i];
+    page->read = memory + i * 0x100;
+    page->write = writable ? page->read : NULL;
+    page->read_handler = NULL;
+    page->write_handler = writable ? NULL : fakemem_ignore_write;
+    page->ctx = NULL;
+  }
+}
+//-----------------------------------------------------------------------------
+void fakemem_map_device(uint8_t first, uint16_t count, fakemem_read_t read,
+                        fakemem_write_t write, void *ctx){
+  for(uint16_t i = 0; i < count && first + i < FAKEMEM_PAGES; i++){
+    fakemem_page_t *page = &fakemem_pages[first + i];
+    page->read = NULL;
+    page->write = NULL;
+    page->read_handler = read;
+    page->write_handler = write;
+    page->ctx = ctx;
+  }
+}
+//-----------------------------------------------------------------------------
+// The memory of a page when no device answers
+static uint8_t *fakemem_memory(uint16_t page){
+  return fakemem_overlays[page] != NULL ? fakemem_overlays[page] : &fakemem[page << 8];
+}
+//-----------------------------------------------------------------------------
+// Handle fake6522 access
+static uint8_t fakemem_via_read(void *ctx, uint16_t addr){
+  return fake6522_read(addr);
+}
+static void fakemem_via_write(void *ctx, uint16_t addr, uint8_t byte){
+  fake6522_write(addr, byte);
+}
+//-----------------------------------------------------------------------------
+// Device reads are the inputs of a replay recording, while one plays the
+// device isn't asked at all
+static uint8_t fakemem_device_read(void *ctx, uint16_t addr){
+  const fakemem_device_t *device = ctx;
+  if(device->read == NULL){
+    return fakemem_memory(addr >> 8)[addr & 0xFF];
+  }
+  if(fakemem_replay != NULL && fakemem_replay->mode == REPLAY_PLAY){
+    return replay_play_read(fakemem_replay, addr);
+  }
+  uint8_t data = device->read(device->ctx, addr);
+  if(fakemem_replay != NULL){
+    replay_record_read(fakemem_replay, addr, data);
+  }
+  return data;
+}
+static void fakemem_device_write(void *ctx, uint16_t addr, uint8_t byte){
+  const fakemem_device_t *device = ctx;
+  if(device->write == NULL){
+    fakemem_memory(addr >> 8)[addr & 0xFF] = byte;
+    return;
+  }
+  device->write(device->ctx, addr, byte);
+}
+//-----------------------------------------------------------------------------
+// Pages shared by devices look the device up per address
+static uint8_t fakemem_shared_read(void *ctx, uint16_t addr){
+  const fakemem_shared_t *shared = ctx;
+  uint8_t index = shared->device[addr & 0xFF];
+  if(index == 0){
+    return fakemem_memory(addr >> 8)[addr & 0xFF];
+  }
+  return fakemem_device_read(&fakemem_devices[index - 1], addr);
+}
+static void fakemem_shared_write(void *ctx, uint16_t addr, uint8_t byte){
+  const fakemem_shared_t *shared = ctx;
+  uint8_t index = shared->device[addr & 0xFF];
+  if(index == 0){
+    fakemem_memory(addr >> 8)[addr & 0xFF] = byte;
+    return;
+  }
+  fakemem_device_write(&fakemem_devices[index - 1], addr, byte);
+}
+//-----------------------------------------------------------------------------
+static fakemem_shared_t *fakemem_shared_slot(uint16_t page){
+  fakemem_shared_t *free_slot = NULL;
+  for(int i = 0; i < FAKEMEM_SHARED_PAGES; i++){
+    if(fakemem_shared[i].used && fakemem_shared[i].page == page){
+      return &fakemem_shared[i];
+    }
+    if(free_slot == NULL && !fakemem_shared[i].used){
+      free_slot = &fakemem_shared[i];
+    }
+  }
+  if(free_slot != NULL){
+    free_slot->used = 1;
+    free_slot->page = page;
+  }
+  return free_slot;
+}
+//-----------------------------------------------------------------------------
+// Memory, a device of the whole page, or the table of a shared page. -1 if
+// a shared page is needed and none is left.
+static int fakemem_map_page(uint16_t page){
+  uint32_t start = page << 8, end = start + 0x100;
+  int count = 0, index = 0, whole = 0;
+  for(int i = 0; i < fakemem_ndevices; i++){
+    const fakemem_device_t *device = &fakemem_devices[i];
+    if(device->start < end && device->start + device->size > start){
+      count++;
+      index = i;
+      whole = device->start <= start && device->start + device->size >= end;
+    }
+  }
+  // A page that stops being shared gives its table back
+  for(int i = 0; i < FAKEMEM_SHARED_PAGES; i++){
+    if(fakemem_shared[i].used && fakemem_shared[i].page == page &&
+       (count == 0 || (count == 1 && whole))){
+      fakemem_shared[i].used = 0;
+    }
+  }
+  if(count == 0){
+    fakemem_map_memory(page, 1, fakemem_memory(page), 1);
+  } else if(count == 1 && whole){
+    fakemem_map_device(page, 1, fakemem_device_read, fakemem_device_write,
+                       &fakemem_devices[index]);
+  } else {
+    fakemem_shared_t *shared = fakemem_shared_slot(page);
+    if(shared == NULL) return -1;
+    memset(shared->device, 0, sizeof(shared->device));
+    for(int i = 0; i < fakemem_ndevices; i++){
+      const fakemem_device_t *device = &fakemem_devices[i];
+      for(uint32_t addr = start; addr < end; addr++){
+        if(addr >= device->start && addr < device->start + device->size){
+          shared->device[addr & 0xFF] = i + 1;
+        }
+      }
+    }
+    fakemem_map_device(page, 1, fakemem_shared_read, fakemem_shared_write, shared);
+  }
+  return 0;
+}
 //-----------------------------------------------------------------------------
 // Initialize the 6502 Memory
 void fakemem_init(uint16_t reset_vector){
   memset(fakemem, 0, sizeof(fakemem)); // Initialize fake memory
   fakemem[0xFFFC] = reset_vector & 0xFF; // Set reset vector low byte
   fakemem[0xFFFD] = (reset_vector >> 8) & 0xFF; // Set reset vector high byt
+  fakemem_map_init();
 }
 //-----------------------------------------------------------------------------
-uint8_t read6502(uint16_t addr){
-  // Debugging output
-  fakemem_access_mode = 1;
-  uint8_t return_data = fakemem[addr]; // Default return data from memory
-  fakemem_access_address = addr; // Update display with memory address being read
-  // Handle fake6522 access
-  if((addr & 0xff00)  == 0x6000){
-    return_data = fake6522_read(addr); // Call fake6522 access function
-    fakemem_access_data = return_data; // Update display with memory data read  
-    return return_data; // Placeholder for read function
-  }
-  // Handle callable memory reads
-  if((addr & 0xff00)  == FAKEMEM_CALLABLE_START){
-    if(fakemem_callables[addr & 0xFF].read != 0){
-
-      return_data = fakemem_callables[addr & 0xFF].read(addr);
-      fakemem_access_data = return_data; // Update display with memory data read  
-      return return_data; // Placeholder for read function
+// The page table from the devices, the lookup is never done per access
+void fakemem_map_init(void){
+  for(int i = 0; i < FAKEMEM_SHARED_PAGES; i++){
+    fakemem_shared[i].used = 0;
+  }
+  for(uint16_t page = 0; page < FAKEMEM_PAGES; page++){
+    fakemem_map_page(page); // Can't run out, add_device() checked every page
+  }
+}
+//-----------------------------------------------------------------------------
+int fakemem_add_device(const fakemem_device_t *device){
+  uint32_t end = (uint32_t)device->start + device->size;
+  if(device->size == 0 || end > 0x10000 || fakemem_ndevices == FAKEMEM_MAX_DEVICES){
+    return -1;
+  }
+#ifdef FAKEMEM_LOW_PAGES_RAM
+  if(device->start < FAKEMEM_LOW_PAGES_RAM){
+    return -1;
+  }
+#endif
+  for(int i = 0; i < fakemem_ndevices; i++){
+    const fakemem_device_t *other = &fakemem_devices[i];
+    if(device->start < other->start + other->size && end > other->start){
+      return -1;
+    }
+  }
+  fakemem_devices[fakemem_ndevices++] = *device;
+  for(uint16_t page = device->start >> 8; page < (end + 0xFF) >> 8; page++){
+    if(fakemem_map_page(page) != 0){
+      // Out of shared pages, back to the map without it
+      fakemem_ndevices--;
+      for(uint16_t undo = device->start >> 8; undo <= page; undo++){
+        fakemem_map_page(undo);
+      }
+      return -1;
+    }
+  }
+  return 0;
+}
+//-----------------------------------------------------------------------------
+int fakemem_map_overlay(uint8_t first, uint16_t count, uint8_t *memory){
+  if(first + count > FAKEMEM_PAGES){
+    return -1;
+  }
+#ifdef FAKEMEM_LOW_PAGES_RAM
+  if(first < (FAKEMEM_LOW_PAGES_RAM >> 8)){
+    return -1;
+  }
+#endif
+  for(uint16_t i = 0; i < count; i++){
+    fakemem_overlays[first + i] = memory != NULL ? memory + i * 0x100 : NULL;
+    fakemem_map_page(first + i);
+  }
+  return 0;
+}
+//-----------------------------------------------------------------------------
+const fakemem_device_t *fakemem_device_at(uint16_t address){
+  for(int i = 0; i < fakemem_ndevices; i++){
+    const fakemem_device_t *device = &fakemem_devices[i];
+    if(address >= device->start && address < device->start + device->size){
+      return device;
     }
   }
-  // Handle hardware interrupt vectors
-  switch(addr) {
-    case 0xFFFE: // IRQ/BRK vector (low byte)
-    case 0xFFFF: // IRQ/BRK vector (high byte)
-      //break_flag = 1; // Set break flag when IRQ/BRK vector is read
-      return_data = 0x00;
-      break;
-  }
-  fakemem_access_data = return_data; // Update display with memory data read  
-  return return_data; // Placeholder for read function
-}
-//-----------------------------------------------------------------------------
-void write6502(uint16_t addr, uint8_t byte)
-{
-  // Handle fake6522 access
-  if((addr & 0xff00)  == 0x6000){
-    fakemem_access_mode = 2;
-    fakemem_access_address = addr; // Update display with memory address being written
-    fakemem_access_data = byte; // Update display with memory data written
-    fake6522_write(addr, byte); // Call fake6522 access function
-    return; // Exit after handling fake6522 access
-  }
-  // Handle callable memory reads
-  if((addr & 0xff00)  == FAKEMEM_CALLABLE_START){
-    if(fakemem_callables[addr & 0xFF].write != 0){
-      fakemem_access_mode = 2;
-      fakemem_access_address = addr; // Update display with memory address being written
-      fakemem_access_data = byte; // Update display with memory data written
-      fakemem_callables[addr & 0xFF].write(addr, byte);
-      return; // Call the write function if it exists
+  return NULL;
+}
+//-----------------------------------------------------------------------------
+// Device at addr, or NULL for memory, with *end cut down to where that ends
+static const fakemem_device_t *fakemem_run(uint32_t addr, uint32_t *end){
+  const fakemem_device_t *found = NULL;
+  for(int i = 0; i < fakemem_ndevices; i++){
+    const fakemem_device_t *device = &fakemem_devices[i];
+    if(addr >= device->start && addr < device->start + device->size){
+      found = device;
+      if(device->start + device->size < *end) *end = device->start + device->size;
+    } else if(device->start > addr && device->start < *end){
+      *end = device->start;
     }
   }
-  fakemem_access_mode = 2;
-  fakemem_access_address = addr; // Update display with memory address being written
-  fakemem_access_data = byte; // Update display with memory data written
-  fakemem[addr] = byte; // Write to fake memory  
+  return found;
 }
 //-----------------------------------------------------------------------------
-void fakemem_set_callable_read(uint16_t address, uint8_t (*read)(uint16_t)){
-  fakemem_callables[address].read = read;
+// Memory is copied page by page, devices with a block callback get their
+// part of the range in one call
+void fakemem_read_block(uint16_t address, uint8_t *data, uint32_t len){
+  uint32_t addr = address, end = addr + len;
+  if(end > 0x10000) end = 0x10000;
+  while(addr < end){
+    uint32_t next = (addr | 0xFF) + 1 < end ? (addr | 0xFF) + 1 : end;
+    const fakemem_device_t *device = fakemem_run(addr, &next);
+    if(device != NULL && device->read_block != NULL){
+      device->read_block(device->ctx, addr, data, next - addr);
+    } else {
+      memcpy(data, fakemem_memory(addr >> 8) + (addr & 0xFF), next - addr);
+    }
+    data += next - addr;
+    addr = next;
+  }
 }
 //-----------------------------------------------------------------------------
-void fakemem_set_callable_write(uint16_t address, void (*write)(uint16_t, uint8_t)){
-  fakemem_callables[address].write = write;
+void fakemem_write_block(uint16_t address, const uint8_t *data, uint32_t len){
+  uint32_t addr = address, end = addr + len;
+  if(end > 0x10000) end = 0x10000;
+  while(addr < end){
+    uint32_t next = (addr | 0xFF) + 1 < end ? (addr | 0xFF) + 1 : end;
+    const fakemem_device_t *device = fakemem_run(addr, &next);
+    if(device != NULL && device->write_block != NULL){
+      device->write_block(device->ctx, addr, data, next - addr);
+    } else {
+      memcpy(fakemem_memory(addr >> 8) + (addr & 0xFF), data, next - addr);
+    }
+    data += next - addr;
+    addr = next;
+  }
 }
 //-----------------------------------------------------------------------------
-void fakemem_set_callable_read_block(uint16_t address, uint8_t size, uint8_t (*read)(uint16_t)){
-  for(int i = 0; i < size; i++){
-    fakemem_set_callable_read(address + i, read);
+// One load for memory pages, the handler for devices
+uint8_t fakemem_read(void *ctx, uint16_t addr){
+  const fakemem_page_t *page = &fakemem_pages[addr >> 8];
+  uint8_t return_data;
+  if(page->read != NULL){
+    return_data = page->read[addr & 0xFF];
+  } else {
+    return_data = page->read_handler(page->ctx, addr);
   }
+  return return_data;
 }
 //-----------------------------------------------------------------------------
-void fakemem_set_callable_write_block(uint16_t address, uint8_t size, void (*write)(uint16_t, uint8_t)){
-  for(int i = 0; i < size; i++){
-    fakemem_set_callable_write(address + i, write);
+void fakemem_write(void *ctx, uint16_t addr, uint8_t byte){
+  const fakemem_page_t *page = &fakemem_pages[addr >> 8];
+  if(page->write != NULL){
+    page->write[addr & 0xFF] = byte;
+  } else {
+    page->write_handler(page->ctx, addr, byte);
   }
 }
+//-----------------------------------------------------------------------------
+uint8_t fakemem_read_latched(void *ctx, uint16_t addr){
+  uint8_t return_data = fakemem_read(ctx, addr);
+  fakemem_access.mode = FAKEMEM_ACCESS_READ;
+  fakemem_access.address = addr; // Update display with memory address being read
+  fakemem_access.data = return_data; // Update display with memory data read
+  return return_data;
+}
+//-----------------------------------------------------------------------------
+void fakemem_write_latched(void *ctx, uint16_t addr, uint8_t byte){
+  fakemem_write(ctx, addr, byte);
+  fakemem_access.mode = FAKEMEM_ACCESS_WRITE;
+  fakemem_access.address = addr; // Update display with memory address being written
+  fakemem_access.data = byte; // Update display with memory data written
+}
@@ -7,28 +7,114 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "replay.h"
 
 
+// The memory map is global state. A host build that runs one machine per
+// thread defines FAKEMEM_THREAD_LOCAL to give every thread its own.
+#ifdef FAKEMEM_THREAD_LOCAL
+#define FAKEMEM_STORAGE _Thread_local
+#else
+#define FAKEMEM_STORAGE
+#endif
+
+// Handlers of a device page, the same shape as the bus of the CPU
+typedef uint8_t (*fakemem_read_t)(void *ctx, uint16_t address);
+typedef void (*fakemem_write_t)(void *ctx, uint16_t address, uint8_t value);
+
+// One of the 256 pages of the address space. Memory pages point at their 256
+// bytes and take a single load or store, device pages (read/write NULL) go
+// to the handlers. A read only page has no write pointer and ignores writes
+// in its handler.
 typedef struct {
-  uint8_t (*read)(uint16_t address); // Function pointer for reading memory
-  void (*write)(uint16_t address, uint8_t value); // Function pointer for writing memory
-} fakemem_callable_t;
+  uint8_t *read;
+  uint8_t *write;
+  fakemem_read_t read_handler;
+  fakemem_write_t write_handler;
+  void *ctx;
+} fakemem_page_t;
 
-// addresses between 0xF000 and 0xF0FF are reserved for callable memory
-#define FAKEMEM_CALLABLE_START 0xF000
-extern fakemem_callable_t fakemem_callables[];
-extern uint8_t fakemem[]; // Simulated memory for the 6502 CPU
+#define FAKEMEM_PAGES 256
+extern FAKEMEM_STORAGE fakemem_page_t fakemem_pages[FAKEMEM_PAGES];
+
+// A device on the bus at start .. start + size - 1. The handlers get the
+// full address and ctx, without one that direction goes to the memory
+// underneath. The optional block callbacks serve fakemem_read_block() and
+// fakemem_write_block() in one call, else those see the memory underneath.
+typedef struct {
+  uint16_t start;
+  uint32_t size;
+  fakemem_read_t read;
+  fakemem_write_t write;
+  void (*read_block)(void *ctx, uint16_t address, uint8_t *data, uint32_t len);
+  void (*write_block)(void *ctx, uint16_t address, const uint8_t *data, uint32_t len);
+  void *ctx;
+} fakemem_device_t;
 
-extern uint16_t fakemem_access_address;
-extern uint8_t fakemem_access_data;
-extern uint8_t fakemem_access_mode;
+// Pages 0 and 1 stay plain RAM, fakemem_add_device() refuses them, so fakemem
+// can be the lowpages of a core built with FAKE6502_DIRECT_LOW_PAGES
+#ifndef FAKEMEM_DEVICES_IN_LOW_PAGES
+#define FAKEMEM_LOW_PAGES_RAM 0x200
+#elif defined(FAKE6502_DIRECT_LOW_PAGES)
+#error "FAKE6502_DIRECT_LOW_PAGES needs pages 0 and 1 as plain RAM"
+#endif
+
+// The 6522 is always on the bus, everything else is added by the board
+#define FAKEMEM_VIA_START 0x6000
+#define FAKEMEM_VIA_SIZE 0x100
+#define FAKEMEM_MAX_DEVICES 32
+// Pages that hold more than one device, or a device and memory, get a table
+// of the device per address
+#define FAKEMEM_SHARED_PAGES 8
+extern FAKEMEM_STORAGE fakemem_device_t fakemem_devices[FAKEMEM_MAX_DEVICES];
+extern FAKEMEM_STORAGE uint8_t fakemem_ndevices;
+extern FAKEMEM_STORAGE uint8_t fakemem[1<<16]; // Simulated memory for the 6502 CPU
+
+// Last access seen by the latching bus callbacks below, for the MEMORY
+// ACCESS panel. The plain callbacks don't touch it, whoever wants to see an
+// access sets fakemem_access_request and the main loop runs one instruction
+// on the latching callbacks.
+#define FAKEMEM_ACCESS_NONE 0
+#define FAKEMEM_ACCESS_READ 1
+#define FAKEMEM_ACCESS_WRITE 2
+typedef struct {
+  uint16_t address;
+  uint8_t data;
+  uint8_t mode; // FAKEMEM_ACCESS_*
+} fakemem_access_t;
+extern FAKEMEM_STORAGE volatile fakemem_access_t fakemem_access;
+extern FAKEMEM_STORAGE volatile uint8_t fakemem_access_request;
+// Device reads are logged into this recording, or come from it while it
+// plays, if set
+extern FAKEMEM_STORAGE replay_t *fakemem_replay;
 
+// Clear the memory, set the reset vector and the memory map of the board
 void fakemem_init(uint16_t reset_vector);
-uint8_t read6502(uint16_t addr);
-void write6502(uint16_t addr, uint8_t byte);
-void fakemem_set_callable_read(uint16_t address, uint8_t (*read)(uint16_t));
-void fakemem_set_callable_write(uint16_t address, void (*write)(uint16_t, uint8_t));
-void fakemem_set_callable_read_block(uint16_t address, uint8_t size, uint8_t (*read)(uint16_t));
-void fakemem_set_callable_write_block(uint16_t address, uint8_t size, void (*write)(uint16_t, uint8_t));
+// Only the memory map of the board, for a memory that is already loaded
+void fakemem_map_init(void);
+// Put a copy of device on the bus and remap the pages it covers. -1 if it
+// overlaps another device or there is no room left.
+int fakemem_add_device(const fakemem_device_t *device);
+// Show count pages of memory from first on in place of their RAM, or the RAM
+// again for NULL. Devices on those pages stay in front. -1 for pages that
+// must stay RAM.
+int fakemem_map_overlay(uint8_t first, uint16_t count, uint8_t *memory);
+// Device at address, or NULL for memory
+const fakemem_device_t *fakemem_device_at(uint16_t address);
+// Host access to the memory as the 6502 sees it, without the side effects
+// of device registers
+void fakemem_read_block(uint16_t address, uint8_t *data, uint32_t len);
+void fakemem_write_block(uint16_t address, const uint8_t *data, uint32_t len);
+// count pages from first on memory, page by page. Read only if not writable.
+void fakemem_map_memory(uint8_t first, uint16_t count, uint8_t *memory, uint8_t writable);
+// count pages from first on a device, the handlers get the full address
+void fakemem_map_device(uint8_t first, uint16_t count, fakemem_read_t read,
+                        fakemem_write_t write, void *ctx);
+// Bus callbacks for cpu6502_bus_t, ctx is unused as there is one memory map
+uint8_t fakemem_read(void *ctx, uint16_t addr);
+void fakemem_write(void *ctx, uint16_t addr, uint8_t byte);
+// The same, and the access latched into fakemem_access
+uint8_t fakemem_read_latched(void *ctx, uint16_t addr);
+void fakemem_write_latched(void *ctx, uint16_t addr, uint8_t byte);
 
 #endif
\ No newline at end of file
@@ -206,40 +206,41 @@ void idisplay_task(){
 	uint8_t block_c = idisplay_create_block("C", 0, 13, 15);
 	while(1){
 		// Update Interrupt Request (IRQ) status
-		//idisplay_update_block_bool(block_irq, );
+		idisplay_update_block_bool(block_irq, (cpu6502.events & CPU6502_EVENT_IRQ) ? 1 : 0);
 		// Update Non-Maskable Interrupt (NMI) status
-		//idisplay_update_block_bool(block_nmi, );
+		idisplay_update_block_bool(block_nmi, (cpu6502.events & CPU6502_EVENT_NMI) ? 1 : 0);
 		// Update Accumulator
-		idisplay_update_block_value(block_a, *fake6502_a);
+		idisplay_update_block_value(block_a, cpu6502.a);
 		// Update Stack Pointer
-		idisplay_update_block_value(block_sp, *fake6502_sp);
+		idisplay_update_block_value(block_sp, cpu6502.sp);
 		// Update X Register
-		idisplay_update_block_value(block_x, *fake6502_x);
+		idisplay_update_block_value(block_x, cpu6502.x);
 		// Update Program Counter
-		idisplay_update_block_value(block_pc, *fake6502_pc);
+		idisplay_update_block_value(block_pc, cpu6502.pc);
 		// Update Y Register
-		idisplay_update_block_value(block_y, *fake6502_y);
-		// Update Memory Access Address
-		idisplay_update_block_value(block_address, fakemem_access_address);
+		idisplay_update_block_value(block_y, cpu6502.y);
+		// Update Memory Access Address, latched from one instruction per refresh
+		idisplay_update_block_value(block_address, fakemem_access.address);
 		// Update Memory Access Data
-		idisplay_update_block_value(block_data, fakemem_access_data);
+		idisplay_update_block_value(block_data, fakemem_access.data);
 		// Update Memory Access Read/Write
-		if(fakemem_access_mode == 1) {
+		if(fakemem_access.mode == FAKEMEM_ACCESS_READ) {
 			idisplay_update_block_label(block_rw, "R");
-		} else if(fakemem_access_mode == 2) {
+		} else if(fakemem_access.mode == FAKEMEM_ACCESS_WRITE) {
 			idisplay_update_block_label(block_rw, "W");
 		} else {
 			idisplay_update_block_label(block_rw, "-");
 		}
+		fakemem_access_request = 1; // Latch a fresh one for the next refresh
 		// Update Status Registers
 		{
-		idisplay_update_block_bool(block_n, (*fake6502_status & 0x80) ? 1 : 0);
-		idisplay_update_block_bool(block_v, (*fake6502_status & 0x40) ? 1 : 0);
-		idisplay_update_block_bool(block_b, (*fake6502_status & 0x10) ? 1 : 0);
-		idisplay_update_block_bool(block_d, (*fake6502_status & 0x08) ? 1 : 0);
-		idisplay_update_block_bool(block_i, (*fake6502_status & 0x04) ? 1 : 0);
-		idisplay_update_block_bool(block_z, (*fake6502_status & 0x02) ? 1 : 0);
-		idisplay_update_block_bool(block_c, (*fake6502_status & 0x01) ? 1 : 0); 
+		idisplay_update_block_bool(block_n, (cpu6502.status & 0x80) ? 1 : 0);
+		idisplay_update_block_bool(block_v, (cpu6502.status & 0x40) ? 1 : 0);
+		idisplay_update_block_bool(block_b, (cpu6502.status & 0x10) ? 1 : 0);
+		idisplay_update_block_bool(block_d, (cpu6502.status & 0x08) ? 1 : 0);
+		idisplay_update_block_bool(block_i, (cpu6502.status & 0x04) ? 1 : 0);
+		idisplay_update_block_bool(block_z, (cpu6502.status & 0x02) ? 1 : 0);
+		idisplay_update_block_bool(block_c, (cpu6502.status & 0x01) ? 1 : 0); 
 }
     vTaskDelay(1); 
 	}
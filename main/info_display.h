@@ -17,6 +17,8 @@
 #include "esp_spiffs.h"
 #include "p_array.h"
 #include "fake6502.h"
+#include "fakemem.h"
+#include "bitboard_6502.h"
 //-----------------------------------------------------------------------------
 
 #define COLOR1 0x000000 // #000000
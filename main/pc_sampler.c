@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// pc_sampler.c: Statistical PC profiler of the emulated 6502
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include "pc_sampler.h"
+
+#include <string.h>
+#include "esp_timer.h"
+
+//-----------------------------------------------------------------------------
+static uint32_t pc_sampler_buckets[PC_SAMPLER_BUCKETS];
+cpu6502_pchist_t pc_sampler_hist = { pc_sampler_buckets, PC_SAMPLER_DEFAULT_SHIFT };
+uint32_t pc_sampler_missed;
+
+static esp_timer_handle_t pc_sampler_timer;
+static cpu6502_t *pc_sampler_cpu;
+
+//-----------------------------------------------------------------------------
+// Only flags the request, the emulation loop counts the pc on its next
+// instruction. A request still pending means the CPU hasn't run since.
+static void pc_sampler_tick(void *arg){
+  if(!cpu6502_request_sample(pc_sampler_cpu)){
+    pc_sampler_missed++;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void pc_sampler_init(cpu6502_t *cpu){
+  const esp_timer_create_args_t timer_args = {
+    .callback = &pc_sampler_tick,
+    .name = "pc_sampler"
+  };
+  pc_sampler_cpu = cpu;
+  ESP_ERROR_CHECK(esp_timer_create(&timer_args, &pc_sampler_timer));
+  cpu->pchist = &pc_sampler_hist;
+  pc_sampler_start(PC_SAMPLER_DEFAULT_PERIOD_US, PC_SAMPLER_DEFAULT_SHIFT);
+}
+
+//-----------------------------------------------------------------------------
+esp_err_t pc_sampler_start(uint32_t period_us, uint8_t shift){
+  if(shift < PC_SAMPLER_MIN_SHIFT || shift > PC_SAMPLER_MAX_SHIFT){
+    return ESP_ERR_INVALID_ARG;
+  }
+  if(esp_timer_is_active(pc_sampler_timer)){
+    esp_timer_stop(pc_sampler_timer);
+  }
+  pc_sampler_hist.shift = shift;
+  pc_sampler_clear();
+  if(period_us == 0){
+    return ESP_OK;
+  }
+  return esp_timer_start_periodic(pc_sampler_timer, period_us);
+}
+
+//-----------------------------------------------------------------------------
+void pc_sampler_clear(void){
+  memset(pc_sampler_buckets, 0, sizeof(pc_sampler_buckets));
+  pc_sampler_missed = 0;
+}
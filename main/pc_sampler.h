@@ -0,0 +1,33 @@
+//-----------------------------------------------------------------------------
+// pc_sampler.h: Statistical PC profiler of the emulated 6502
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#ifndef PC_SAMPLER_H
+#define PC_SAMPLER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "fake6502.h"
+
+//-----------------------------------------------------------------------------
+// Bucket sizes from 16 (shift 4) to 256 (shift 8) bytes of address space
+#define PC_SAMPLER_MIN_SHIFT 4
+#define PC_SAMPLER_MAX_SHIFT 8
+#define PC_SAMPLER_BUCKETS (0x10000 >> PC_SAMPLER_MIN_SHIFT)
+
+// Sampling set up by pc_sampler_init(), cheap enough to leave running
+#define PC_SAMPLER_DEFAULT_PERIOD_US 1000
+#define PC_SAMPLER_DEFAULT_SHIFT 6
+
+// Histogram the samples are counted into, (0x10000 >> shift) buckets in use
+extern cpu6502_pchist_t pc_sampler_hist;
+// Samples taken while the 6502 was not running (stopped, WAI or idle sleep)
+extern uint32_t pc_sampler_missed;
+
+void pc_sampler_init(cpu6502_t *cpu);
+// Restart sampling every period_us with 1 << shift byte buckets, clears the
+// histogram. A period of 0 stops sampling.
+esp_err_t pc_sampler_start(uint32_t period_us, uint8_t shift);
+void pc_sampler_clear(void);
+
+#endif
@@ -0,0 +1,285 @@
+//-----------------------------------------------------------------------------
+// replay.c: Record and replay of the inputs of the emulated machine
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include "replay.h"
+
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+#define REPLAY_NONE 0xFFFFFFFF
+
+static replay_event_t *replay_event(const replay_t *r, uint32_t offset){
+  return (replay_event_t *)(r->buffer + offset);
+}
+
+static uint32_t replay_event_size(const replay_event_t *e){
+  uint32_t data = (e->kind == REPLAY_EVENT_WRITE) ? (e->count + 3) & ~3 : 0;
+  return sizeof(replay_event_t) + data;
+}
+
+//-----------------------------------------------------------------------------
+// New event at the end of the log, NULL once the log is full
+static replay_event_t *replay_append(replay_t *r, uint8_t kind, uint32_t data){
+  uint32_t size = sizeof(replay_event_t) + ((data + 3) & ~3);
+  if(r->closed || r->size - r->used < size){
+    if(!r->closed){
+      r->closed = 1;
+      r->end = r->cpu->instructions;
+    }
+    return NULL;
+  }
+  replay_event_t *e = replay_event(r, r->used);
+  memset(e, 0, sizeof(*e));
+  e->instructions = r->cpu->instructions;
+  e->kind = kind;
+  r->last = r->used;
+  r->used += size;
+  return e;
+}
+
+//-----------------------------------------------------------------------------
+// cpu6502_t.interrupthook while recording
+static void replay_interrupt(void *ctx, uint16_t vector){
+  replay_t *r = ctx;
+  if(r->mode != REPLAY_RECORD) return;
+  replay_event_t *e = replay_append(r, REPLAY_EVENT_INTERRUPT, 0);
+  if(e != NULL){
+    e->address = vector;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void replay_init(replay_t *r, cpu6502_t *cpu, uint8_t *memory, uint8_t *buffer, uint32_t size){
+  memset(r, 0, sizeof(*r));
+  r->cpu = cpu;
+  r->memory = memory;
+  r->buffer = buffer;
+  r->size = size & ~3;
+  r->last = REPLAY_NONE;
+}
+
+//-----------------------------------------------------------------------------
+void replay_record_start(replay_t *r){
+  r->used = 0;
+  r->last = REPLAY_NONE;
+  r->closed = 0;
+  r->start = r->cpu->instructions;
+  r->cpu->interruptctx = r;
+  r->cpu->interrupthook = replay_interrupt;
+  r->mode = REPLAY_RECORD;
+}
+
+//-----------------------------------------------------------------------------
+void replay_close(replay_t *r){
+  if(r->mode == REPLAY_RECORD && !r->closed){
+    r->closed = 1;
+    r->end = r->cpu->instructions;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void replay_stop(replay_t *r){
+  replay_close(r);
+  r->mode = REPLAY_OFF;
+  r->cpu->interrupthook = NULL;
+}
+
+//-----------------------------------------------------------------------------
+void replay_record_read(replay_t *r, uint16_t address, uint8_t value){
+  if(r->mode != REPLAY_RECORD || r->closed) return;
+  uint32_t now = r->cpu->instructions;
+  // A polling loop reads the same value at a fixed stride, one event covers it
+  if(r->last != REPLAY_NONE){
+    replay_event_t *e = replay_event(r, r->last);
+    if(e->kind == REPLAY_EVENT_READ && e->address == address && e->value == value){
+      if(e->count == 1){
+        e->stride = now - e->instructions;
+        e->count = 2;
+        return;
+      }
+      if(e->instructions + e->stride * e->count == now){
+        e->count++;
+        return;
+      }
+    }
+  }
+  replay_event_t *e = replay_append(r, REPLAY_EVENT_READ, 0);
+  if(e != NULL){
+    e->address = address;
+    e->value = value;
+    e->count = 1;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void replay_record_skip(replay_t *r, uint32_t ticks){
+  if(r->mode != REPLAY_RECORD || ticks == 0) return;
+  replay_event_t *e = replay_append(r, REPLAY_EVENT_SKIP, 0);
+  if(e != NULL){
+    e->count = ticks;
+  }
+}
+
+//-----------------------------------------------------------------------------
+void replay_host_write(replay_t *r, uint16_t address, const uint8_t *data, uint32_t len){
+  if(len > 0x10000u - address){
+    len = 0x10000u - address;
+  }
+  if(r->mode == REPLAY_RECORD){
+    replay_event_t *e = replay_append(r, REPLAY_EVENT_WRITE, len);
+    if(e != NULL){
+      e->address = address;
+      e->count = len;
+      memcpy(e + 1, data, len);
+    }
+  }
+  memcpy(&r->memory[address], data, len);
+  cpu6502_invalidate(r->cpu, address, len); // Drop stale decoded code
+}
+
+//-----------------------------------------------------------------------------
+uint8_t replay_play_read(replay_t *r, uint16_t address){
+  replay_event_t *e = replay_event(r, r->cursor);
+  if(r->cursor >= r->used || e->kind != REPLAY_EVENT_READ || e->address != address ||
+     e->instructions + e->stride * r->played != r->cpu->instructions){
+    r->diverged++;
+    return 0xFF; // Open bus
+  }
+  if(++r->played == e->count){
+    r->cursor += sizeof(*e);
+    r->played = 0;
+  }
+  return e->value;
+}
+
+//-----------------------------------------------------------------------------
+uint32_t replay_end(const replay_t *r){
+  return r->closed ? r->end : r->cpu->instructions;
+}
+
+//-----------------------------------------------------------------------------
+// Apply the events due before the next instruction. Returns the instructions
+// to run until the next one is due, at most budget, 1 after an interrupt so
+// its line can be released as soon as it was taken.
+static uint32_t replay_apply(replay_t *r, uint32_t budget){
+  cpu6502_t *cpu = r->cpu;
+  while(r->cursor < r->used){
+    replay_event_t *e = replay_event(r, r->cursor);
+    if(e->kind == REPLAY_EVENT_READ || e->instructions != cpu->instructions) break;
+    switch(e->kind){
+      case REPLAY_EVENT_WRITE:
+        memcpy(&r->memory[e->address], e + 1, e->count);
+        cpu6502_invalidate(cpu, e->address, e->count);
+      break;
+      case REPLAY_EVENT_INTERRUPT:
+        if(e->address == 0){
+          cpu->waiting = 0;
+        } else if(e->address == 0xFFFA){
+          nmi6502(cpu);
+          budget = 1;
+        } else {
+          cpu6502_irq_assert(cpu, REPLAY_IRQ_SOURCE);
+          budget = 1;
+        }
+      break;
+      case REPLAY_EVENT_SKIP:
+        cpu->clockticks6502 += e->count;
+      break;
+    }
+    r->cursor += replay_event_size(e);
+  }
+  // Reads are played by the bus, only the other events split the run
+  for(uint32_t at = r->cursor; at < r->used; ){
+    replay_event_t *e = replay_event(r, at);
+    if(e->kind != REPLAY_EVENT_READ){
+      if(e->instructions - cpu->instructions < budget){
+        budget = e->instructions - cpu->instructions;
+      }
+      break;
+    }
+    at += sizeof(*e);
+  }
+  return budget;
+}
+
+//-----------------------------------------------------------------------------
+int replay_play(replay_t *r, uint32_t target){
+  cpu6502_t *cpu = r->cpu;
+  if(r->mode == REPLAY_PLAY || !r->closed || cpu->instructions != r->start ||
+     target - r->start > r->end - r->start){
+    return -1;
+  }
+  // Only the log drives the machine, not the live interrupt sources or a
+  // stop meant for the run before
+  cpu6502_cancel_stop(cpu);
+  uint32_t lines = cpu->events & CPU6502_EVENT_IRQ;
+  __atomic_fetch_and(&cpu->events, ~CPU6502_EVENT_IRQ, __ATOMIC_RELAXED);
+  uint8_t nbreakpoints = cpu->nbreakpoints;
+  uint8_t idledetect = cpu->idledetect;
+  cpu->nbreakpoints = 0;
+  cpu->idledetect = 0;
+  uint8_t mode = r->mode;
+  r->mode = REPLAY_PLAY;
+  r->cursor = 0;
+  r->played = 0;
+  r->diverged = 0;
+
+  int res = 0;
+  while(cpu->instructions != target){
+    uint32_t before = cpu->instructions;
+    uint32_t cursor = r->cursor;
+    uint32_t budget = replay_apply(r, target - cpu->instructions);
+    cpu6502_stop_t reason = run6502(cpu, budget);
+    cpu6502_irq_deassert(cpu, REPLAY_IRQ_SOURCE);
+    if(cpu->instructions == before && r->cursor == cursor && reason != CPU6502_STOP_REQUEST){
+      res = -1; // Waits in WAI, but the log has no interrupt for it
+      break;
+    }
+  }
+
+  // Keep what was played, a recording carries on from here. A failed play
+  // keeps the whole log, closed, to be played again from the checkpoint.
+  if(mode == REPLAY_RECORD && res == 0){
+    if(r->played > 0){
+      replay_event(r, r->cursor)->count = r->played;
+      r->cursor += sizeof(replay_event_t);
+    }
+    r->used = r->cursor;
+    r->last = REPLAY_NONE;
+    r->closed = 0;
+    cpu->interruptctx = r; // The checkpoint may have come without the hook
+    cpu->interrupthook = replay_interrupt;
+  }
+  r->mode = mode;
+  cpu->nbreakpoints = nbreakpoints;
+  cpu->idledetect = idledetect;
+  __atomic_fetch_or(&cpu->events, lines, __ATOMIC_RELAXED);
+  return res < 0 ? res : (int)r->diverged;
+}
+
+//-----------------------------------------------------------------------------
+int replay_load(replay_t *r, const replay_header_t *header, const uint8_t *events){
+  if(header->magic != REPLAY_MAGIC || header->version != REPLAY_VERSION ||
+     header->size > r->size){
+    return -1;
+  }
+  replay_stop(r);
+  memcpy(r->buffer, events, header->size);
+  r->used = header->size;
+  r->last = REPLAY_NONE;
+  r->start = header->start;
+  r->closed = 1; // Nothing is known past the end of the download
+  r->end = header->end;
+  return 0;
+}
+
+//-----------------------------------------------------------------------------
+void replay_get_header(const replay_t *r, replay_header_t *header){
+  memset(header, 0, sizeof(*header));
+  header->magic = REPLAY_MAGIC;
+  header->version = REPLAY_VERSION;
+  header->start = r->start;
+  header->end = replay_end(r);
+  header->size = r->used;
+}
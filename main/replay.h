@@ -0,0 +1,103 @@
+//-----------------------------------------------------------------------------
+// replay.h: Record and replay of the inputs of the emulated machine
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include "fake6502.h"
+
+//-----------------------------------------------------------------------------
+// Everything the 6502 can't predict from its memory is logged against
+// cpu6502_t.instructions: device reads, memory written by the host, the
+// interrupts taken and the ticks credited for idle sleeps. From a checkpoint
+// of the machine taken when the log started, playing the log repeats the run
+// exactly. Nothing here depends on ESP-IDF, so a host build replays the logs
+// downloaded from the board.
+#define REPLAY_MAGIC 0x52353642 // "B65R"
+#define REPLAY_VERSION 1
+#define REPLAY_IRQ_SOURCE CPU6502_IRQ_SOURCE(23) // Driven while playing
+
+typedef enum {
+  REPLAY_OFF = 0,
+  REPLAY_RECORD,
+  REPLAY_PLAY,
+} replay_mode_t;
+
+typedef enum {
+  REPLAY_EVENT_READ = 1,  // Device read, a run of equal reads at a fixed stride
+  REPLAY_EVENT_WRITE,     // Host wrote count bytes at address, they follow
+  REPLAY_EVENT_INTERRUPT, // Interrupt through the vector at address taken,
+                          // address 0 when a WAI ended
+  REPLAY_EVENT_SKIP,      // count ticks credited for an idle sleep
+} replay_event_kind_t;
+
+// Events are logged in the order they happened. An event with a key of n
+// happened before instruction n ran, a read while it ran.
+typedef struct {
+  uint32_t instructions; // Key, of the first read of a run
+  uint8_t kind;          // replay_event_kind_t
+  uint8_t value;         // READ: value the device returned
+  uint16_t address;
+  uint32_t count;        // READ: reads in the run, WRITE: data bytes, SKIP: ticks
+  uint32_t stride;       // READ: instructions from one read of the run to the next
+} replay_event_t;
+
+// A downloaded log is this header followed by size bytes of events, all
+// little endian
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t reserved;
+  uint32_t start; // cpu6502_t.instructions at the checkpoint
+  uint32_t end;   // Last instruction count the events cover
+  uint32_t size;
+} replay_header_t;
+
+typedef struct {
+  cpu6502_t *cpu;
+  uint8_t *memory;       // The 64 KiB host writes go to
+  uint8_t *buffer;       // Events, 4 byte aligned
+  uint32_t size;
+  uint32_t used;
+  uint32_t last;         // Offset of the newest event, UINT32_MAX if none
+  uint32_t start;        // Instructions at the checkpoint
+  uint32_t end;          // Instructions the log ends at once closed
+  volatile uint8_t mode; // replay_mode_t
+  uint8_t closed;        // Set when an event didn't fit or recording stopped
+  uint32_t cursor;       // Offset of the next event while playing
+  uint32_t played;       // Reads of the run at the cursor already played
+  uint32_t diverged;     // Reads the log didn't expect while playing
+} replay_t;
+
+void replay_init(replay_t *r, cpu6502_t *cpu, uint8_t *memory, uint8_t *buffer, uint32_t size);
+// Start an empty log at the current state of the CPU, which the caller keeps
+// as the checkpoint
+void replay_record_start(replay_t *r);
+void replay_stop(replay_t *r);
+// End the log at the current instruction, before the machine is taken back
+// to the checkpoint. A recording resumes after replay_play().
+void replay_close(replay_t *r);
+// Inputs, each logged only while recording
+void replay_record_read(replay_t *r, uint16_t address, uint8_t value);
+void replay_record_skip(replay_t *r, uint32_t ticks);
+// Copy data into memory as the host does, logged while recording
+void replay_host_write(replay_t *r, uint16_t address, const uint8_t *data, uint32_t len);
+// Value of a device read while playing
+uint8_t replay_play_read(replay_t *r, uint16_t address);
+// Last instruction count the log can be played to
+uint32_t replay_end(const replay_t *r);
+// With the log closed and the machine back at the checkpoint, play the log
+// up to just before instruction target. A recording goes on from there, the
+// events after it are dropped, any other log is kept to be played again.
+// Returns -1 if the log doesn't cover target or the run didn't follow the
+// log, which leaves the log as it was, else the number of reads the log
+// didn't expect.
+int replay_play(replay_t *r, uint32_t target);
+// Header describing the log as it is now
+void replay_get_header(const replay_t *r, replay_header_t *header);
+// Take over a downloaded log, to be played from its checkpoint
+int replay_load(replay_t *r, const replay_header_t *header, const uint8_t *events);
+
+#endif
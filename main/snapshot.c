@@ -0,0 +1,161 @@
+//-----------------------------------------------------------------------------
+// snapshot.c: Save-states of the whole emulated machine in flash
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include "snapshot.h"
+
+#include <string.h>
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+#include "bitboard_6502.h"
+#include "fakemem.h"
+
+//-----------------------------------------------------------------------------
+static const esp_partition_t *snapshot_partition(const char *partition){
+  return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition);
+}
+
+//-----------------------------------------------------------------------------
+esp_err_t snapshot_save(const char *partition, cpu6502_t *cpu, uint16_t flags){
+  const esp_partition_t *part = snapshot_partition(partition);
+  if(part == NULL){
+    return ESP_ERR_NOT_FOUND;
+  }
+  snapshot_machine_t machine = {
+    .clockticks = cpu->clockticks6502,
+    .clockgoal = cpu->clockgoal6502,
+    .instructions = cpu->instructions,
+    .pc = cpu->pc,
+    .sp = cpu->sp,
+    .a = cpu->a,
+    .x = cpu->x,
+    .y = cpu->y,
+    .status = cpu->status,
+    .waiting = cpu->waiting,
+    .nmi = (cpu->events & CPU6502_EVENT_NMI) != 0,
+    .led = io_led_state
+  };
+  fake6522_get_state(&machine.via);
+  memcpy(machine.banks, emu_bank.selected, sizeof(machine.banks));
+  snapshot_header_t header = {
+    .magic = SNAPSHOT_MAGIC,
+    .version = SNAPSHOT_VERSION,
+    .flags = flags,
+    .size = sizeof(machine) + 0x10000
+  };
+  header.crc = esp_rom_crc32_le(0, (const uint8_t *)&machine, sizeof(machine));
+  header.crc = esp_rom_crc32_le(header.crc, fakemem, 0x10000);
+
+  uint32_t erase_size = (SNAPSHOT_IMAGE_SIZE + part->erase_size - 1) / part->erase_size * part->erase_size;
+  esp_err_t res = esp_partition_erase_range(part, 0, erase_size);
+  if(res == ESP_OK){
+    res = esp_partition_write(part, sizeof(header), &machine, sizeof(machine));
+  }
+  if(res == ESP_OK){
+    res = esp_partition_write(part, sizeof(header) + sizeof(machine), fakemem, 0x10000);
+  }
+  // Header last, so an interrupted save leaves no valid image behind
+  if(res == ESP_OK){
+    res = esp_partition_write(part, 0, &header, sizeof(header));
+  }
+  return res;
+}
+
+//-----------------------------------------------------------------------------
+esp_err_t snapshot_restore(const char *partition, cpu6502_t *cpu, uint16_t required_flags){
+  static uint8_t buffer[512];
+  const esp_partition_t *part = snapshot_partition(partition);
+  snapshot_header_t header;
+  snapshot_machine_t machine;
+  if(part == NULL){
+    return ESP_ERR_NOT_FOUND;
+  }
+  esp_err_t res = esp_partition_read(part, 0, &header, sizeof(header));
+  if(res != ESP_OK){
+    return res;
+  }
+  if(header.magic != SNAPSHOT_MAGIC || (header.flags & required_flags) != required_flags){
+    return ESP_ERR_NOT_FOUND;
+  }
+  if(header.version != SNAPSHOT_VERSION || header.size != sizeof(machine) + 0x10000){
+    return ESP_ERR_INVALID_VERSION;
+  }
+  // Check the whole image before anything of the machine is overwritten
+  uint32_t crc = 0;
+  for(uint32_t offset = 0; offset < header.size; offset += sizeof(buffer)){
+    uint32_t len = header.size - offset < sizeof(buffer) ? header.size - offset : sizeof(buffer);
+    res = esp_partition_read(part, sizeof(header) + offset, buffer, len);
+    if(res != ESP_OK){
+      return res;
+    }
+    crc = esp_rom_crc32_le(crc, buffer, len);
+  }
+  if(crc != header.crc){
+    return ESP_ERR_INVALID_CRC;
+  }
+  res = esp_partition_read(part, sizeof(header), &machine, sizeof(machine));
+  if(res == ESP_OK){
+    res = esp_partition_read(part, sizeof(header) + sizeof(machine), fakemem, 0x10000);
+  }
+  if(res != ESP_OK){
+    return res;
+  }
+
+  cpu->clockticks6502 = machine.clockticks;
+  cpu->clockgoal6502 = machine.clockgoal;
+  cpu->instructions = machine.instructions;
+  cpu->pc = machine.pc;
+  cpu->sp = machine.sp;
+  cpu->a = machine.a;
+  cpu->x = machine.x;
+  cpu->y = machine.y;
+  cpu->status = machine.status;
+  cpu->waiting = machine.waiting;
+  __atomic_fetch_and(&cpu->events, ~CPU6502_EVENT_NMI, __ATOMIC_RELAXED);
+  if(machine.nmi){
+    nmi6502(cpu);
+  }
+  cpu6502_invalidate(cpu, 0, 0x10000); // Code decoded from the old memory
+#ifdef FAKE6502_CALLGRAPH
+  if(cpu->callgraph){
+    cpu->callgraph->depth = 0; // Calls of the old run never return here
+  }
+#endif
+  fake6522_set_state(&machine.via);
+  io_write(NULL, IO_LED_ADDRESS, machine.led);
+  for(int i = 0; i < emu_bank.nwindows; i++){
+    fakebank_select(&emu_bank, i, machine.banks[i]);
+  }
+  return ESP_OK;
+}
+
+//-----------------------------------------------------------------------------
+esp_err_t snapshot_read(const char *partition, uint32_t offset, void *data, uint32_t len){
+  const esp_partition_t *part = snapshot_partition(partition);
+  if(part == NULL){
+    return ESP_ERR_NOT_FOUND;
+  }
+  if(offset > part->size || len > part->size - offset){
+    return ESP_ERR_INVALID_SIZE;
+  }
+  return esp_partition_read(part, offset, data, len);
+}
+
+//-----------------------------------------------------------------------------
+esp_err_t snapshot_write(const char *partition, uint32_t offset, const void *data, uint32_t len){
+  const esp_partition_t *part = snapshot_partition(partition);
+  if(part == NULL){
+    return ESP_ERR_NOT_FOUND;
+  }
+  if(offset > part->size || len > part->size - offset){
+    return ESP_ERR_INVALID_SIZE;
+  }
+  if(offset == 0){
+    esp_err_t res = esp_partition_erase_range(part, 0, part->size);
+    if(res != ESP_OK){
+      return res;
+    }
+  }
+  return esp_partition_write(part, offset, data, len);
+}
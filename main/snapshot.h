@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// snapshot.h: Save-states of the whole emulated machine in flash
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "fake6502.h"
+#include "fake6522.h"
+#include "fakebank.h"
+
+//-----------------------------------------------------------------------------
+#define SNAPSHOT_PARTITION "snapshot" // Data partitions in partitions.csv
+#define SNAPSHOT_CHECKPOINT_PARTITION "replay" // Start of a replay recording
+#define SNAPSHOT_MAGIC 0x53353642     // "B65S"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_FLAG_BOOT 0x0001     // Resumed by app_main instead of a reset
+
+// Image layout: snapshot_header_t, snapshot_machine_t, then the 64 KiB of
+// fakemem. All fields are little endian. The extended memory is too large
+// for the image, only the blocks selected in the bank windows are saved.
+// Blocks the program changed after the save stay changed on a restore.
+typedef struct {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t flags;
+  uint32_t size; // Bytes after the header
+  uint32_t crc;  // CRC-32 of those bytes
+} snapshot_header_t;
+
+typedef struct {
+  uint32_t clockticks;
+  uint32_t clockgoal;
+  uint32_t instructions;
+  uint16_t pc;
+  uint8_t sp, a, x, y, status;
+  uint8_t waiting; // Stopped in WAI
+  uint8_t nmi;     // NMI edge latched but not taken yet
+  fake6522_state_t via;
+  uint8_t led;     // Last value written to the LED device
+  uint8_t banks[FAKEBANK_MAX_WINDOWS]; // Block shown in each bank window
+  uint8_t reserved[2];
+} snapshot_machine_t;
+
+#define SNAPSHOT_IMAGE_SIZE (sizeof(snapshot_header_t) + sizeof(snapshot_machine_t) + 0x10000)
+
+// Save the stopped machine to one of the partitions above. flags are
+// SNAPSHOT_FLAG_* bits.
+esp_err_t snapshot_save(const char *partition, cpu6502_t *cpu, uint16_t flags);
+// Resume the machine from flash if the image is valid and has all of the
+// required flags, nothing is changed otherwise
+esp_err_t snapshot_restore(const char *partition, cpu6502_t *cpu, uint16_t required_flags);
+// Raw access to the image for transfers, writing at offset 0 erases it
+esp_err_t snapshot_read(const char *partition, uint32_t offset, void *data, uint32_t len);
+esp_err_t snapshot_write(const char *partition, uint32_t offset, const void *data, uint32_t len);
+
+#endif
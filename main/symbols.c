@@ -0,0 +1,41 @@
+//-----------------------------------------------------------------------------
+// symbols.c: Routine names of the loaded 6502 program, uploaded by the host
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#include "symbols.h"
+
+#include <string.h>
+
+//-----------------------------------------------------------------------------
+static symbol_t symbols[SYMBOLS_MAX];
+static uint32_t symbols_count;
+
+//-----------------------------------------------------------------------------
+void symbols_clear(void){
+  symbols_count = 0;
+}
+
+//-----------------------------------------------------------------------------
+esp_err_t symbols_add(uint16_t address, const char *name, uint32_t len){
+  if(symbols_count >= SYMBOLS_MAX){
+    return ESP_ERR_NO_MEM;
+  }
+  if(len > SYMBOL_NAME_MAX - 1){
+    len = SYMBOL_NAME_MAX - 1;
+  }
+  symbol_t *symbol = &symbols[symbols_count++];
+  symbol->address = address;
+  memcpy(symbol->name, name, len);
+  symbol->name[len] = '\0';
+  return ESP_OK;
+}
+
+//-----------------------------------------------------------------------------
+const char *symbols_find(uint16_t address){
+  for(uint32_t i = 0; i < symbols_count; i++){
+    if(symbols[i].address == address){
+      return symbols[i].name;
+    }
+  }
+  return NULL;
+}
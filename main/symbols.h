@@ -0,0 +1,26 @@
+//-----------------------------------------------------------------------------
+// symbols.h: Routine names of the loaded 6502 program, uploaded by the host
+// 17.10.2026 github.com/SMDHuman
+//-----------------------------------------------------------------------------
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+//-----------------------------------------------------------------------------
+#define SYMBOLS_MAX 256
+#define SYMBOL_NAME_MAX 24 // Longer names are cut, terminator included
+
+typedef struct {
+  uint16_t address;
+  char name[SYMBOL_NAME_MAX];
+} symbol_t;
+
+void symbols_clear(void);
+// Add a name of len bytes, not terminated, for address
+esp_err_t symbols_add(uint16_t address, const char *name, uint32_t len);
+// Name at exactly this address, or NULL
+const char *symbols_find(uint16_t address);
+
+#endif
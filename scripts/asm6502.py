@@ -0,0 +1,195 @@
+# --------------------------------------------------------------------------
+# asm6502.py: Minimal two pass 6502 assembler for the benchmark programs
+# 17.10.2026 github.com/SMDHuman
+# --------------------------------------------------------------------------
+# Syntax is a small subset of ca65: "label:", "name = expr", ".org expr",
+# ".byte"/".word" lists, ".include "file"", "; comments" and the usual
+# operand forms. Numbers are $hex, %binary or decimal, <expr and >expr take
+# the low and high byte and * is the address of the current line. The output
+# is the raw bytes from the lowest address on, gaps filled with zeros.
+import argparse
+import os
+import re
+import sys
+from opcodes6502 import OPCODES, LENGTHS
+
+# Opcode per (mnemonic, addressing mode), the documented one where an
+# undocumented NOP shares the name
+ENCODINGS = {}
+for opcode, key in enumerate(OPCODES):
+  ENCODINGS.setdefault(key, opcode)
+ENCODINGS[("NOP", "imp")] = 0xEA
+
+BRANCHES = {"BPL", "BMI", "BVC", "BVS", "BCC", "BCS", "BNE", "BEQ"}
+
+class AsmError(Exception):
+  pass
+
+def evaluate(expr, symbols, pc, strict):
+  # Value of expr, None in the first pass when a symbol isn't known yet
+  text = expr.strip()
+  if(text.startswith("<")):
+    value = evaluate(text[1:], symbols, pc, strict)
+    return None if value is None else value & 0xFF
+  if(text.startswith(">")):
+    value = evaluate(text[1:], symbols, pc, strict)
+    return None if value is None else (value >> 8) & 0xFF
+  def symbol(match):
+    name = match.group(0)
+    if(name not in symbols):
+      if(strict):
+        raise AsmError(f"unknown symbol '{name}'")
+      raise KeyError(name)
+    return str(symbols[name])
+  text = re.sub(r"\$([0-9A-Fa-f]+)", lambda m: str(int(m.group(1), 16)), text)
+  text = re.sub(r"%([01]+)", lambda m: str(int(m.group(1), 2)), text)
+  text = re.sub(r"'(.)'", lambda m: str(ord(m.group(1))), text)
+  text = re.sub(r"^\*", str(pc), text) # Only at the start, else it multiplies
+  try:
+    text = re.sub(r"[A-Za-z_][A-Za-z0-9_]*", symbol, text)
+  except KeyError:
+    return None
+  if(not re.fullmatch(r"[0-9+\-*/()&|^~<> ]*", text)):
+    raise AsmError(f"bad expression '{expr}'")
+  return int(eval(text.replace("/", "//")))
+
+def parse_operand(mnemonic, operand):
+  # (addressing mode class, expression) of an operand
+  op = operand.strip()
+  if(op == ""):
+    return "imp", None
+  if(op.upper() == "A"):
+    return "acc", None
+  if(op.startswith("#")):
+    return "imm", op[1:]
+  m = re.fullmatch(r"\((.*)\)\s*,\s*[Yy]", op)
+  if(m):
+    return "indy", m.group(1)
+  m = re.fullmatch(r"\((.*),\s*[Xx]\)", op)
+  if(m):
+    return "indx", m.group(1)
+  m = re.fullmatch(r"\((.*)\)", op)
+  if(m and mnemonic == "JMP"):
+    return "ind", m.group(1)
+  m = re.fullmatch(r"(.*),\s*([XxYy])", op)
+  if(m):
+    return "x" if m.group(2) in "Xx" else "y", m.group(1)
+  return "addr", op
+
+def choose_mode(mnemonic, kind, value):
+  # Zero page form when the value is known to fit and the opcode exists
+  if(mnemonic in BRANCHES):
+    return "rel"
+  short, long = {"addr": ("zp", "abs"), "x": ("zpx", "absx"), "y": ("zpy", "absy")}.get(kind, (kind, kind))
+  if(value is not None and value < 0x100 and (mnemonic, short) in ENCODINGS):
+    return short
+  if((mnemonic, long) in ENCODINGS):
+    return long
+  return short
+
+def split_line(line):
+  line = re.sub(r";.*", "", line).strip()
+  label = None
+  m = re.match(r"([A-Za-z_][A-Za-z0-9_]*):\s*(.*)", line)
+  if(m):
+    label, line = m.group(1), m.group(2)
+  return label, line.strip()
+
+def read_source(path):
+  # Lines of path with the .include files expanded, as (file, line, text)
+  lines = []
+  with open(path) as f:
+    for number, raw in enumerate(f.read().splitlines(), 1):
+      m = re.fullmatch(r'\s*\.include\s+"(.*)"\s*(;.*)?', raw, re.IGNORECASE)
+      if(m):
+        lines += read_source(os.path.join(os.path.dirname(path), m.group(1)))
+      else:
+        lines.append((path, number, raw))
+  return lines
+
+def assemble(lines):
+  symbols = {}
+  modes = {}
+  for strict in (False, True):
+    pc, out, listing = None, {}, []
+    for number, (path, line, raw) in enumerate(lines):
+      listing.append((pc, raw))
+      try:
+        label, text = split_line(raw)
+        if(label is not None):
+          if(pc is None):
+            raise AsmError("label before .org")
+          if(not strict and label in symbols):
+            raise AsmError(f"'{label}' defined twice")
+          symbols[label] = pc
+        if(text == ""):
+          continue
+        m = re.fullmatch(r"([A-Za-z_][A-Za-z0-9_]*)\s*=\s*(.*)", text)
+        if(m):
+          value = evaluate(m.group(2), symbols, pc, strict)
+          if(value is None):
+            raise AsmError("constants must be defined before use")
+          symbols[m.group(1)] = value
+          continue
+        word, _, rest = text.partition(" ")
+        word = word.upper()
+        if(word == ".ORG"):
+          pc = evaluate(rest, symbols, pc, True)
+          continue
+        if(word in (".BYTE", ".WORD")):
+          size = 1 if word == ".BYTE" else 2
+          for item in rest.split(","):
+            value = evaluate(item, symbols, pc, strict) or 0
+            for i in range(size):
+              out[pc + i] = (value >> (8 * i)) & 0xFF
+            pc += size
+          continue
+        if(pc is None):
+          raise AsmError("code before .org")
+        kind, expr = parse_operand(word, rest)
+        value = evaluate(expr, symbols, pc, strict) if expr is not None else None
+        if(strict):
+          mode = modes[number]
+        else:
+          mode = modes[number] = choose_mode(word, kind, value)
+        if((word, mode) not in ENCODINGS):
+          raise AsmError(f"no {word} with {mode} addressing")
+        out[pc] = ENCODINGS[(word, mode)]
+        length = LENGTHS[mode]
+        if(strict and mode == "rel"):
+          offset = value - (pc + 2)
+          if(offset < -128 or offset > 127):
+            raise AsmError("branch out of range")
+          value = offset & 0xFF
+        if(strict and length > 1 and value > (0xFF if length == 2 else 0xFFFF)):
+          raise AsmError(f"operand ${value:X} too large")
+        for i in range(1, length):
+          out[pc + i] = ((value or 0) >> (8 * (i - 1))) & 0xFF
+        pc += length
+      except AsmError as e:
+        raise AsmError(f"{path}:{line}: {e}: {raw.strip()}")
+  if(not out):
+    return 0, b"", []
+  origin = min(out)
+  return origin, bytes(out.get(a, 0) for a in range(origin, max(out) + 1)), listing
+
+# --------------------------------------------------------------------------
+if(__name__ == "__main__"):
+  parser = argparse.ArgumentParser(description="Assemble a 6502 source into a raw binary")
+  parser.add_argument("source", type=str, help="Assembly source file")
+  parser.add_argument("-o", "--output", type=str, required=True, help="Binary to write")
+  parser.add_argument("-l", "--listing", type=str, default=None,
+                      help="Listing to write, the address of each source line")
+  args = parser.parse_args()
+  try:
+    origin, code, listing = assemble(read_source(args.source))
+  except AsmError as e:
+    print(e, file=sys.stderr)
+    sys.exit(1)
+  with open(args.output, "wb") as f:
+    f.write(code)
+  if(args.listing is not None):
+    with open(args.listing, "w") as f:
+      for pc, raw in listing:
+        f.write(("     " if pc is None else f"{pc:04X} ") + raw + "\n")
+  print(f"{args.output}: {len(code)} bytes at ${origin:04X}")
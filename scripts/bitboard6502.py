@@ -1,8 +1,10 @@
 # --------------------------------------------------------------------------
 # 
 # --------------------------------------------------------------------------
-import time, os, sys, struct, datetime
+import time, os, sys, struct, datetime, re, threading
 from serial_slip import Serial_SLIP
+from opcodes6502 import OPCODES, MODES
+from trace6502 import decode_trace, format_trace
 import argparse
 # --------------------------------------------------------------------------
 
@@ -17,8 +19,102 @@ CMD_START_EMU = 6
 CMD_STOP_EMU = 7
 CMD_STEP_EMU = 8
 CMD_GET_INST_COUNT = 9
+CMD_SET_BREAKPOINT = 10
+CMD_CLEAR_BREAKPOINTS = 11
+CMD_GET_FUSION_COUNTS = 12
+CMD_GET_PROFILE = 13
+CMD_SET_PC_SAMPLING = 14
+CMD_GET_PC_SAMPLES = 15
+CMD_LOAD_SYMBOLS = 16
+CMD_GET_CALLGRAPH = 17
+CMD_GET_TRACE = 18
+CMD_SNAPSHOT_SAVE = 19
+CMD_SNAPSHOT_RESTORE = 20
+CMD_SNAPSHOT_READ = 21
+CMD_SNAPSHOT_WRITE = 22
+CMD_REPLAY_RECORD = 23
+CMD_REPLAY_STEP_BACK = 24
+CMD_REPLAY_READ = 25
+CMD_SET_PERF_LOG = 26
+CMD_WRITE_BANK = 27
+
+SNAPSHOT_FLAG_BOOT = 0x0001
+
+# Superinstructions in the order CMD_GET_FUSION_COUNTS reports them
+FUSION_NAMES = ["DEX/BNE", "DEY/BNE", "LDA abs,X/STA abs,Y", "INC zp/BNE", "CMP #imm/BEQ"]
+
+def print_profile(data):
+  # Mode count, a (count, ticks, penalty) entry per mode, then
+  # (opcode, count, ticks, penalty) records for the executed opcodes
+  nmodes = data[0]
+  modes = struct.unpack(f"<{nmodes * 3}I", data[1:1 + nmodes * 12])
+  records = [struct.unpack("<B3I", data[i:i + 13]) for i in range(1 + nmodes * 12, len(data), 13)]
+  total = sum(modes[i * 3 + 1] for i in range(nmodes)) or 1
+  print(f"{'opcode':>14} {'count':>10} {'ticks':>12} {'%':>6} {'penalty':>10}")
+  for opcode, count, ticks, penalty in sorted(records, key=lambda r: r[2], reverse=True):
+    name, mode = OPCODES[opcode]
+    print(f"{opcode:02X} {name} {mode:<7} {count:>10} {ticks:>12} {100 * ticks / total:>6.2f} {penalty:>10}")
+  print(f"{'mode':>14} {'count':>10} {'ticks':>12} {'%':>6} {'penalty':>10}")
+  for i in range(nmodes):
+    count, ticks, penalty = modes[i * 3:i * 3 + 3]
+    if(count):
+      print(f"{MODES[i]:>14} {count:>10} {ticks:>12} {100 * ticks / total:>6.2f} {penalty:>10}")
+
+def print_pc_samples(data, top):
+  # Bucket shift, samples missed while the 6502 was not running, then
+  # (bucket, count) records of the non-empty buckets
+  shift, missed = struct.unpack("<BI", data[:5])
+  records = [struct.unpack("<HI", data[i:i + 6]) for i in range(5, len(data), 6)]
+  total = sum(count for _, count in records)
+  print(f"{total} samples in {1 << shift} byte ranges, {missed} while not running")
+  for bucket, count in sorted(records, key=lambda r: r[1], reverse=True)[:top]:
+    start = bucket << shift
+    print(f"${start:04X}-${start + (1 << shift) - 1:04X} {count:>10} {100 * count / (total or 1):>6.2f}%")
+
+def load_symbols(path):
+  # Reads the exports of an ld65 map file (-m) or the labels of a VICE label
+  # file (ld65 -Ln), one name per address. Returns [(address, name)].
+  symbols = {}
+  with open(path, "r", errors="replace") as f:
+    text = f.read()
+  vice = re.findall(r"^al\s+(?:C:)?([0-9A-Fa-f]+)\s+\.(\S+)", text, re.M)
+  if(vice):
+    entries = [(int(value, 16), name) for value, name in vice]
+  else:
+    entries = []
+    for section in re.findall(r"Exports list by (?:name|value):\n-+\n(.*?)(?:\n\n|\Z)", text, re.S):
+      entries += [(int(value, 16), name)
+                  for name, value in re.findall(r"(\S+)\s+([0-9A-F]{6})\s+[A-Z]+", section)]
+  for address, name in entries:
+    # Linker generated segment bounds and cheap local labels are no routines
+    if(address > 0xFFFF or name.startswith("__") or name.startswith("@")):
+      continue
+    symbols.setdefault(address, name)
+  return sorted(symbols.items())
+
+def print_callgraph(data, top):
+  # Dropped call count, then (entry, calls, inclusive, exclusive, name
+  # length, name) records
+  dropped = struct.unpack("<I", data[:4])[0]
+  routines = []
+  i = 4
+  while(i + 15 <= len(data)):
+    entry, calls, inclusive, exclusive, name_len = struct.unpack("<H3IB", data[i:i + 15])
+    name = data[i + 15:i + 15 + name_len].decode("utf-8", errors="replace")
+    routines.append((name or f"${entry:04X}", calls, inclusive, exclusive))
+    i += 15 + name_len
+  total = sum(r[3] for r in routines) or 1
+  print(f"{'routine':>24} {'calls':>10} {'inclusive':>12} {'exclusive':>12} {'excl %':>7}")
+  for name, calls, inclusive, exclusive in sorted(routines, key=lambda r: r[3], reverse=True)[:top]:
+    print(f"{name[:24]:>24} {calls:>10} {inclusive:>12} {exclusive:>12} {100 * exclusive / total:>6.2f}%")
+  if(dropped):
+    print(f"{dropped} calls not tracked, the routine table or call stack was full")
 
 last_inst_count = 0
+# Set when the device answered a command, for transfers that must not send
+# the next packet before the previous one was handled
+command_done = threading.Event()
+quiet_acks = False
 def receive_cb():
   global last_inst_count
   while(dev.in_wait()):
@@ -28,8 +124,11 @@ def receive_cb():
     tag, data = data[0], data[1:]
     if(tag == CMD_RSP_ERROR):
       print("Error: ", data)
+      command_done.set()
     elif(tag == CMD_RSP_PONG):
-      print("Pong received")
+      if(not quiet_acks):
+        print("Pong received")
+      command_done.set()
     elif(tag == CMD_LOG):
       dt = datetime.datetime.now().strftime("%H:%M:%S.%f")[:-3]
       print(f"[{dt}][Log]: ", data.decode('utf-8'), end = "")
@@ -37,6 +136,32 @@ def receive_cb():
       inst_count = struct.unpack("<I", data)[0]
       print(f"Instruction per second: {inst_count - last_inst_count} (Total: {inst_count})")
       last_inst_count = inst_count
+    elif(tag == CMD_GET_FUSION_COUNTS):
+      counts = struct.unpack(f"<{len(data) // 4}I", data)
+      for name, count in zip(FUSION_NAMES, counts):
+        print(f"{name:>20}: {count}")
+    elif(tag == CMD_GET_PROFILE):
+      print_profile(data)
+    elif(tag == CMD_GET_PC_SAMPLES):
+      print_pc_samples(data, args.top)
+    elif(tag == CMD_GET_CALLGRAPH):
+      print_callgraph(data, args.top)
+    elif(tag == CMD_GET_TRACE):
+      size, head, wrapped = struct.unpack("<IIB", data[:9])
+      records = decode_trace(data[9:], head, wrapped)
+      print(f"{len(records)} instructions traced, oldest first")
+      print("\n".join(format_trace(records)))
+    elif(tag == CMD_SNAPSHOT_READ):
+      with open(args.file, "wb") as f:
+        f.write(data)
+      print(f"Saved {len(data)} byte snapshot to '{args.file}'")
+    elif(tag == CMD_REPLAY_READ):
+      # Checkpoint image, then the replay header and the events
+      image_size = 16 + struct.unpack("<I", data[8:12])[0]
+      magic, version, _, start, end, size = struct.unpack("<IHHIII", data[image_size:image_size + 20])
+      with open(args.file, "wb") as f:
+        f.write(data)
+      print(f"Saved recording of instructions {start} to {end} ({size} bytes of events) to '{args.file}'")
     else:
       print("Unknown command received:", tag)
 
@@ -44,16 +169,38 @@ def receive_cb():
 if(__name__ == "__main__"):
   parser = argparse.ArgumentParser(description="BitBoard6502 Serial Interface")
   parser.add_argument("command", type=str, nargs="?", default="ping",
-                      choices=["ping", "write", "start", "stop", "step"],
+                      choices=["ping", "write", "start", "stop", "step",
+                               "break", "clearbreak", "fusions", "profile",
+                               "sample", "hotspots", "symbols", "callgraph", "trace",
+                               "save", "restore", "download", "upload",
+                               "record", "stepback", "recording", "perf", "bank"],
                       help="Command to execute")
   parser.add_argument("-p", "--port", required=True, type=str, 
                       help="Serial port to connect to")
   parser.add_argument("-b", "--baudrate", type=int, default=115200, 
                       help="Baud rate for serial communication")
   parser.add_argument("-f", "--file", type=str, default=None, 
-                      help="File to load into the emulator (optional)")
-  parser.add_argument("-a", "--write_address", type=int, default=0x8000,
-                      help="Write address (default: 0x8000)")
+                      help="File to load into the emulator, or the ld65 map / VICE label file of 'symbols'")
+  parser.add_argument("-a", "--write_address", type=lambda x: int(x, 0), default=0x8000,
+                      help="Write address (default: 0x8000), also the breakpoint address")
+  parser.add_argument("--offset", type=lambda x: int(x, 0), default=0,
+                      help="Offset into the extended memory for 'bank' (default: 0)")
+  parser.add_argument("-c", "--clear", action="store_true",
+                      help="Clear the profile counters or PC samples after reading them")
+  parser.add_argument("--period", type=int, default=1000,
+                      help="PC sample period in microseconds, 0 stops sampling (default: 1000)")
+  parser.add_argument("--bucket", type=int, default=64, choices=[16, 32, 64, 128, 256],
+                      help="Bytes of address space per PC sample bucket (default: 64)")
+  parser.add_argument("--boot", action="store_true",
+                      help="Save the snapshot as the one the board resumes at power up")
+  parser.add_argument("--freeze", action="store_true",
+                      help="Keep the instruction trace frozen after downloading it")
+  parser.add_argument("--stop", action="store_true",
+                      help="Stop the replay recording or the speed log instead of starting it")
+  parser.add_argument("-n", "--count", type=int, default=1,
+                      help="Instructions to step back (default: 1)")
+  parser.add_argument("--top", type=int, default=20,
+                      help="Number of hot PC ranges or routines to print (default: 20)")
   args = parser.parse_args()
   # --------------------------------------------------------------------------
 
@@ -105,6 +252,148 @@ if(__name__ == "__main__"):
       print("Stepping emulator...")
       dev.write(CMD_STEP_EMU)
       dev.write_end()
+    case "break":
+      print(f"Setting breakpoint at {hex(args.write_address)}...")
+      dev.write(CMD_SET_BREAKPOINT)
+      dev.write(struct.pack("<H", args.write_address))
+      dev.write_end()
+    case "clearbreak":
+      print("Clearing breakpoints...")
+      dev.write(CMD_CLEAR_BREAKPOINTS)
+      dev.write_end()
+    case "fusions":
+      print("Requesting superinstruction counts...")
+      dev.write(CMD_GET_FUSION_COUNTS)
+      dev.write_end()
+    case "profile":
+      print("Requesting opcode profile (needs a FAKE6502_PROFILE build)...")
+      dev.write(CMD_GET_PROFILE)
+      dev.write(1 if args.clear else 0)
+      dev.write_end()
+    case "sample":
+      print(f"Sampling PC every {args.period} us into {args.bucket} byte ranges...")
+      dev.write(CMD_SET_PC_SAMPLING)
+      dev.write(struct.pack("<IB", args.period, args.bucket.bit_length() - 1))
+      dev.write_end()
+    case "hotspots":
+      print("Requesting PC samples...")
+      dev.write(CMD_GET_PC_SAMPLES)
+      dev.write(1 if args.clear else 0)
+      dev.write_end()
+    case "symbols":
+      if args.file is None or not os.path.isfile(args.file):
+        print("Error: No symbol file specified.")
+        sys.exit(1)
+      symbols = load_symbols(args.file)
+      print(f"Uploading {len(symbols)} symbols from '{args.file}'...")
+      # Packets stay well below the 1024 byte SLIP buffer of the device
+      packet, first = b"", True
+      for symbol in symbols + [None]:
+        if(symbol is None or len(packet) > 768):
+          dev.write(CMD_LOAD_SYMBOLS)
+          dev.write(1 if first else 0)
+          dev.write(packet)
+          dev.write_end()
+          packet, first = b"", False
+          time.sleep(0.5)  # Sleep to avoid overwhelming the device
+        if(symbol is not None):
+          encoded = symbol[1].encode("utf-8")[:23]
+          packet += struct.pack("<HB", symbol[0], len(encoded)) + encoded
+    case "callgraph":
+      print("Requesting call graph (needs a FAKE6502_CALLGRAPH build)...")
+      dev.write(CMD_GET_CALLGRAPH)
+      dev.write(1 if args.clear else 0)
+      dev.write_end()
+    case "trace":
+      print("Requesting instruction trace (needs a FAKE6502_TRACE build)...")
+      dev.write(CMD_GET_TRACE)
+      dev.write(1 if args.freeze else 0)
+      dev.write_end()
+    case "save":
+      print("Saving snapshot to flash" + (" as the boot snapshot..." if args.boot else "..."))
+      dev.write(CMD_SNAPSHOT_SAVE)
+      dev.write(struct.pack("<H", SNAPSHOT_FLAG_BOOT if args.boot else 0))
+      dev.write_end()
+    case "restore":
+      print("Restoring snapshot from flash...")
+      dev.write(CMD_SNAPSHOT_RESTORE)
+      dev.write_end()
+    case "download":
+      if args.file is None:
+        print("Error: No file specified for the snapshot.")
+        sys.exit(1)
+      print("Downloading snapshot...")
+      dev.write(CMD_SNAPSHOT_READ)
+      dev.write_end()
+    case "upload":
+      if args.file is None or not os.path.isfile(args.file):
+        print("Error: No snapshot file specified.")
+        sys.exit(1)
+      with open(args.file, "rb") as f:
+        image = f.read()
+      print(f"Uploading {len(image)} byte snapshot, 'restore' resumes it...")
+      quiet_acks = True
+      maxpacket_size = 768  # Stays below the 1024 byte SLIP buffer of the device
+      for offset in range(0, len(image), maxpacket_size):
+        command_done.clear()
+        dev.write(CMD_SNAPSHOT_WRITE)
+        dev.write(struct.pack("<I", offset))
+        dev.write(image[offset:offset + maxpacket_size])
+        dev.write_end()
+        # The first packet erases the partition, which takes a while
+        if not command_done.wait(5):
+          print(f"Error: No answer to the packet at offset {offset}")
+          sys.exit(1)
+      quiet_acks = False
+      print("Upload done")
+    case "record":
+      if args.stop:
+        print("Stopping replay recording...")
+      else:
+        print("Recording inputs from a new checkpoint...")
+      dev.write(CMD_REPLAY_RECORD)
+      dev.write(0 if args.stop else 1)
+      dev.write_end()
+    case "stepback":
+      print(f"Stepping back {args.count} instructions...")
+      dev.write(CMD_REPLAY_STEP_BACK)
+      dev.write(struct.pack("<I", args.count))
+      dev.write_end()
+    case "recording":
+      if args.file is None:
+        print("Error: No file specified for the recording.")
+        sys.exit(1)
+      print("Downloading replay recording...")
+      dev.write(CMD_REPLAY_READ)
+      dev.write_end()
+    case "perf":
+      if args.stop:
+        print("Stopping the speed log...")
+      else:
+        print("Logging instructions/s, cycles/s and ns/instruction every second...")
+      dev.write(CMD_SET_PERF_LOG)
+      dev.write(0 if args.stop else 1)
+      dev.write_end()
+    case "bank":
+      if args.file is None or not os.path.isfile(args.file):
+        print("Error: No file specified for the extended memory.")
+        sys.exit(1)
+      with open(args.file, "rb") as f:
+        data = f.read()
+      print(f"Loading {len(data)} bytes into the extended memory at offset {hex(args.offset)}...")
+      quiet_acks = True
+      maxpacket_size = 768  # Stays below the 1024 byte SLIP buffer of the device
+      for i in range(0, len(data), maxpacket_size):
+        command_done.clear()
+        dev.write(CMD_WRITE_BANK)
+        dev.write(struct.pack("<I", args.offset + i))
+        dev.write(data[i:i + maxpacket_size])
+        dev.write_end()
+        if not command_done.wait(5):
+          print(f"Error: No answer to the packet at offset {args.offset + i}")
+          sys.exit(1)
+      quiet_acks = False
+      print("Bank load done")
   
   #...
   last_inst_count_time = 0
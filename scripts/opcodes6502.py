@@ -0,0 +1,96 @@
+# --------------------------------------------------------------------------
+# opcodes6502.py: 6502 opcode table of the emulator, for the host tools
+# 17.10.2026 github.com/SMDHuman
+# --------------------------------------------------------------------------
+# Mirrors main/fake6502_opcodes.h. Undocumented opcodes are NOPs with the
+# addressing mode of the instruction they replace, 0xCB is the 65C02 WAI.
+
+# Addressing modes in cpu6502_mode_t order
+MODES = ["imp", "acc", "imm", "zp", "zpx", "zpy", "rel",
+         "abs", "absx", "absy", "ind", "indx", "indy"]
+
+# Instruction length per addressing mode
+LENGTHS = {"imp": 1, "acc": 1, "imm": 2, "zp": 2, "zpx": 2, "zpy": 2, "rel": 2,
+           "abs": 3, "absx": 3, "absy": 3, "ind": 3, "indx": 2, "indy": 2}
+
+# (mnemonic, addressing mode) per opcode
+OPCODES = [
+  ("BRK", "imp"), ("ORA", "indx"), ("NOP", "imp"), ("NOP", "indx"),
+  ("NOP", "zp"), ("ORA", "zp"), ("ASL", "zp"), ("NOP", "zp"),
+  ("PHP", "imp"), ("ORA", "imm"), ("ASL", "acc"), ("NOP", "imm"),
+  ("NOP", "abs"), ("ORA", "abs"), ("ASL", "abs"), ("NOP", "abs"),
+  ("BPL", "rel"), ("ORA", "indy"), ("NOP", "imp"), ("NOP", "indy"),
+  ("NOP", "zpx"), ("ORA", "zpx"), ("ASL", "zpx"), ("NOP", "zpx"),
+  ("CLC", "imp"), ("ORA", "absy"), ("NOP", "imp"), ("NOP", "absy"),
+  ("NOP", "absx"), ("ORA", "absx"), ("ASL", "absx"), ("NOP", "absx"),
+  ("JSR", "abs"), ("AND", "indx"), ("NOP", "imp"), ("NOP", "indx"),
+  ("BIT", "zp"), ("AND", "zp"), ("ROL", "zp"), ("NOP", "zp"),
+  ("PLP", "imp"), ("AND", "imm"), ("ROL", "acc"), ("NOP", "imm"),
+  ("BIT", "abs"), ("AND", "abs"), ("ROL", "abs"), ("NOP", "abs"),
+  ("BMI", "rel"), ("AND", "indy"), ("NOP", "imp"), ("NOP", "indy"),
+  ("NOP", "zpx"), ("AND", "zpx"), ("ROL", "zpx"), ("NOP", "zpx"),
+  ("SEC", "imp"), ("AND", "absy"), ("NOP", "imp"), ("NOP", "absy"),
+  ("NOP", "absx"), ("AND", "absx"), ("ROL", "absx"), ("NOP", "absx"),
+  ("RTI", "imp"), ("EOR", "indx"), ("NOP", "imp"), ("NOP", "indx"),
+  ("NOP", "zp"), ("EOR", "zp"), ("LSR", "zp"), ("NOP", "zp"),
+  ("PHA", "imp"), ("EOR", "imm"), ("LSR", "acc"), ("NOP", "imm"),
+  ("JMP", "abs"), ("EOR", "abs"), ("LSR", "abs"), ("NOP", "abs"),
+  ("BVC", "rel"), ("EOR", "indy"), ("NOP", "imp"), ("NOP", "indy"),
+  ("NOP", "zpx"), ("EOR", "zpx"), ("LSR", "zpx"), ("NOP", "zpx"),
+  ("CLI", "imp"), ("EOR", "absy"), ("NOP", "imp"), ("NOP", "absy"),
+  ("NOP", "absx"), ("EOR", "absx"), ("LSR", "absx"), ("NOP", "absx"),
+  ("RTS", "imp"), ("ADC", "indx"), ("NOP", "imp"), ("NOP", "indx"),
+  ("NOP", "zp"), ("ADC", "zp"), ("ROR", "zp"), ("NOP", "zp"),
+  ("PLA", "imp"), ("ADC", "imm"), ("ROR", "acc"), ("NOP", "imm"),
+  ("JMP", "ind"), ("ADC", "abs"), ("ROR", "abs"), ("NOP", "abs"),
+  ("BVS", "rel"), ("ADC", "indy"), ("NOP", "imp"), ("NOP", "indy"),
+  ("NOP", "zpx"), ("ADC", "zpx"), ("ROR", "zpx"), ("NOP", "zpx"),
+  ("SEI", "imp"), ("ADC", "absy"), ("NOP", "imp"), ("NOP", "absy"),
+  ("NOP", "absx"), ("ADC", "absx"), ("ROR", "absx"), ("NOP", "absx"),
+  ("NOP", "imm"), ("STA", "indx"), ("NOP", "imm"), ("NOP", "indx"),
+  ("STY", "zp"), ("STA", "zp"), ("STX", "zp"), ("NOP", "zp"),
+  ("DEY", "imp"), ("NOP", "imm"), ("TXA", "imp"), ("NOP", "imm"),
+  ("STY", "abs"), ("STA", "abs"), ("STX", "abs"), ("NOP", "abs"),
+  ("BCC", "rel"), ("STA", "indy"), ("NOP", "imp"), ("NOP", "indy"),
+  ("STY", "zpx"), ("STA", "zpx"), ("STX", "zpy"), ("NOP", "zpy"),
+  ("TYA", "imp"), ("STA", "absy"), ("TXS", "imp"), ("NOP", "absy"),
+  ("NOP", "absx"), ("STA", "absx"), ("NOP", "absy"), ("NOP", "absy"),
+  ("LDY", "imm"), ("LDA", "indx"), ("LDX", "imm"), ("NOP", "indx"),
+  ("LDY", "zp"), ("LDA", "zp"), ("LDX", "zp"), ("NOP", "zp"),
+  ("TAY", "imp"), ("LDA", "imm"), ("TAX", "imp"), ("NOP", "imm"),
+  ("LDY", "abs"), ("LDA", "abs"), ("LDX", "abs"), ("NOP", "abs"),
+  ("BCS", "rel"), ("LDA", "indy"), ("NOP", "imp"), ("NOP", "indy"),
+  ("LDY", "zpx"), ("LDA", "zpx"), ("LDX", "zpy"), ("NOP", "zpy"),
+  ("CLV", "imp"), ("LDA", "absy"), ("TSX", "imp"), ("NOP", "absy"),
+  ("LDY", "absx"), ("LDA", "absx"), ("LDX", "absy"), ("NOP", "absy"),
+  ("CPY", "imm"), ("CMP", "indx"), ("NOP", "imm"), ("NOP", "indx"),
+  ("CPY", "zp"), ("CMP", "zp"), ("DEC", "zp"), ("NOP", "zp"),
+  ("INY", "imp"), ("CMP", "imm"), ("DEX", "imp"), ("WAI", "imp"),
+  ("CPY", "abs"), ("CMP", "abs"), ("DEC", "abs"), ("NOP", "abs"),
+  ("BNE", "rel"), ("CMP", "indy"), ("NOP", "imp"), ("NOP", "indy"),
+  ("NOP", "zpx"), ("CMP", "zpx"), ("DEC", "zpx"), ("NOP", "zpx"),
+  ("CLD", "imp"), ("CMP", "absy"), ("NOP", "imp"), ("NOP", "absy"),
+  ("NOP", "absx"), ("CMP", "absx"), ("DEC", "absx"), ("NOP", "absx"),
+  ("CPX", "imm"), ("SBC", "indx"), ("NOP", "imm"), ("NOP", "indx"),
+  ("CPX", "zp"), ("SBC", "zp"), ("INC", "zp"), ("NOP", "zp"),
+  ("INX", "imp"), ("SBC", "imm"), ("NOP", "imp"), ("SBC", "imm"),
+  ("CPX", "abs"), ("SBC", "abs"), ("INC", "abs"), ("NOP", "abs"),
+  ("BEQ", "rel"), ("SBC", "indy"), ("NOP", "imp"), ("NOP", "indy"),
+  ("NOP", "zpx"), ("SBC", "zpx"), ("INC", "zpx"), ("NOP", "zpx"),
+  ("SED", "imp"), ("SBC", "absy"), ("NOP", "imp"), ("NOP", "absy"),
+  ("NOP", "absx"), ("SBC", "absx"), ("INC", "absx"), ("NOP", "absx"),
+]
+
+# Operand formats per addressing mode, {0} is the operand value
+FORMATS = {"imp": "", "acc": "A", "imm": "#${0:02X}", "zp": "${0:02X}",
+           "zpx": "${0:02X},X", "zpy": "${0:02X},Y", "rel": "${0:04X}",
+           "abs": "${0:04X}", "absx": "${0:04X},X", "absy": "${0:04X},Y",
+           "ind": "(${0:04X})", "indx": "(${0:02X},X)", "indy": "(${0:02X}),Y"}
+
+def disassemble(pc, code):
+  # Text of the instruction whose opcode and operand bytes are code, at pc
+  name, mode = OPCODES[code[0]]
+  value = int.from_bytes(bytes(code[1:LENGTHS[mode]]), "little")
+  if(mode == "rel"):
+    value = (pc + 2 + (value - 256 if value & 0x80 else value)) & 0xFFFF
+  return f"{name} {FORMATS[mode].format(value)}".rstrip()
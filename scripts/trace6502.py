@@ -0,0 +1,68 @@
+# --------------------------------------------------------------------------
+# trace6502.py: Decoder of the instruction trace of a FAKE6502_TRACE build
+# 17.10.2026 github.com/SMDHuman
+# --------------------------------------------------------------------------
+# Mirrors the record format described at cpu6502_trace_t in main/fake6502.h
+from opcodes6502 import OPCODES, LENGTHS, disassemble
+
+TRACE_CHUNK = 256
+TRACE_PC_NEXT = 0
+TRACE_PC_REL = 1
+TRACE_PC_ABS = 2
+TRACE_END = 3
+REGISTERS = ["A", "X", "Y", "SP", "P"]
+
+def decode_chunk(chunk):
+  # Yields (pc, code, registers) per record, the first record is a full one
+  pc, regs, i = None, [0] * 5, 0
+  while(i < len(chunk)):
+    header = chunk[i]
+    kind = header & 3
+    i += 1
+    if(kind == TRACE_END):
+      return
+    if(kind == TRACE_PC_REL):
+      delta = chunk[i]
+      pc = (pc + (delta - 256 if delta & 0x80 else delta)) & 0xFFFF
+      i += 1
+    elif(kind == TRACE_PC_ABS):
+      pc = chunk[i] | (chunk[i + 1] << 8)
+      i += 2
+    length = LENGTHS[OPCODES[chunk[i]][1]]
+    code = list(chunk[i:i + length])
+    i += length
+    for r in range(5):
+      if(header & (0x04 << r)):
+        regs[r] = chunk[i]
+        i += 1
+    yield pc, code, list(regs)
+    pc = (pc + length) & 0xFFFF
+
+def decode_trace(buffer, head, wrapped):
+  # Records of a downloaded ring buffer, oldest first. The chunk holding head
+  # is only valid up to head, what follows it there is an overwritten chunk.
+  chunks = []
+  current = head - head % TRACE_CHUNK
+  if(wrapped):
+    start = current + TRACE_CHUNK if head % TRACE_CHUNK else current
+    for offset in range(start, len(buffer), TRACE_CHUNK):
+      chunks.append(buffer[offset:offset + TRACE_CHUNK])
+    for offset in range(0, current, TRACE_CHUNK):
+      chunks.append(buffer[offset:offset + TRACE_CHUNK])
+  else:
+    for offset in range(0, current, TRACE_CHUNK):
+      chunks.append(buffer[offset:offset + TRACE_CHUNK])
+  chunks.append(buffer[current:head])
+  records = []
+  for chunk in chunks:
+    records += decode_chunk(chunk)
+  return records
+
+def format_trace(records):
+  # One disassembled line per instruction with the registers it started with
+  lines = []
+  for pc, code, regs in records:
+    hexcode = " ".join(f"{b:02X}" for b in code)
+    state = " ".join(f"{name}={value:02X}" for name, value in zip(REGISTERS, regs))
+    lines.append(f"{pc:04X}  {hexcode:<8}  {disassemble(pc, code):<14}  {state}")
+  return lines